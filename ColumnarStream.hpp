@@ -0,0 +1,395 @@
+#ifndef COLUMNARSTREAM_HPP
+#define COLUMNARSTREAM_HPP
+
+#include <vector>
+#include <algorithm>
+#include "Stream.hpp"
+using namespace std;
+
+
+// Колоночный файл: заголовок, блоки записей, каталог блоков с зонами (min/max/число) и концевик с адресом каталога
+// Фильтр по диапазону пропускает блоки, зона которых не пересекается с диапазоном, не читая их.
+// NaN не входит ни в зону, ни в какой диапазон; у блока из одних NaN зона - NaN и фильтр его пропускает
+template <typename T>
+struct ColumnChunk {
+    uint64_t offset;
+    uint64_t first;
+    uint64_t count;
+    T min;
+    T max;
+};
+
+struct ColumnarTrailer {
+    uint64_t directoryOffset;
+    uint64_t chunkCount;
+    uint64_t recordCount;
+    char magic[8];
+};
+
+
+// Класс потока для записи колоночного файла
+template <typename T>
+class ColumnarWriteOnlyStream: public WritableStream<T> {
+    static_assert(is_arithmetic<T>::value, "Колоночный формат поддерживается только для числовых типов!");
+    protected:
+        ofstream fileStream;
+        vector<T> chunk;
+        vector<ColumnChunk<T>> directory;
+        size_t chunkSize;
+        uint64_t offset;
+
+        void WriteRaw(const void *data, size_t size) {
+            fileStream.write(static_cast<const char*>(data), static_cast<streamsize>(size));
+            if (!fileStream.good()) throw runtime_error("Ошибка записи в файл");
+            offset += size;
+        }
+
+        void WriteNumber(uint64_t value) {
+            SwapLittleEndian(&value, 1);
+            WriteRaw(&value, sizeof(value));
+        }
+
+        void WriteValue(T value) {
+            SwapLittleEndian(&value, 1);
+            WriteRaw(&value, sizeof(value));
+        }
+
+        void FlushChunk() {
+            if (chunk.empty()) return;
+            ColumnChunk<T> info;
+            info.offset = offset;
+            info.first = directory.empty() ? 0 : directory.back().first+directory.back().count;
+            info.count = chunk.size();
+            bool empty = true;
+            for (const T &value : chunk) {
+                if (value != value) continue;
+                if (empty || value < info.min) info.min = value;
+                if (empty || info.max < value) info.max = value;
+                empty = false;
+            }
+            if (empty) info.min = info.max = chunk[0];
+            SwapLittleEndian(chunk.data(), chunk.size());
+            WriteRaw(chunk.data(), chunk.size()*sizeof(T));
+            directory.push_back(info);
+            chunk.clear();
+        }
+    public:
+        static constexpr size_t DEFAULT_CHUNK_SIZE = 65536;
+
+        // Конструкторы
+        ~ColumnarWriteOnlyStream() override { try { Close(); } catch (...) {} }
+
+        explicit ColumnarWriteOnlyStream(const string &filename, size_t chunkRecords = DEFAULT_CHUNK_SIZE):
+            Stream<T>(), chunkSize(chunkRecords), offset(0) {
+            if (chunkRecords == 0) throw invalid_argument("Размер блока должен быть положительным!");
+            fileStream.open(filename, ios::binary | ios::trunc);
+            if (!fileStream.is_open()) throw runtime_error("Невозможно открыть файл: " + filename);
+            BinaryStreamHeader header;
+            memcpy(header.magic, "LZCOLM1", 8);
+            header.typeTag = BinaryTypeTag<T>();
+            header.recordWidth = sizeof(T);
+            SwapLittleEndian(&header.typeTag, 1);
+            SwapLittleEndian(&header.recordWidth, 1);
+            WriteRaw(&header, sizeof(header));
+            chunk.reserve(chunkSize);
+        }
+
+        // Операции
+        void Open() override {
+            if (this->isOpen) return;
+            if (!fileStream.is_open()) throw runtime_error("Не удалось открыть поток для записи: файл закрыт!");
+            this->isOpen = true;
+        }
+
+        // Запись последнего блока и каталога; без Close файл не читается
+        void Close() override {
+            if (!this->isOpen) return;
+            this->isOpen = false;
+            this->position = 0;
+            FlushChunk();
+            ColumnarTrailer trailer;
+            trailer.directoryOffset = offset;
+            trailer.chunkCount = directory.size();
+            trailer.recordCount = directory.empty() ? 0 : directory.back().first+directory.back().count;
+            for (const auto &info : directory) {
+                WriteNumber(info.offset);
+                WriteNumber(info.first);
+                WriteNumber(info.count);
+                WriteValue(info.min);
+                WriteValue(info.max);
+            }
+            WriteNumber(trailer.directoryOffset);
+            WriteNumber(trailer.chunkCount);
+            WriteNumber(trailer.recordCount);
+            WriteRaw("LZCOLF1", 8);
+            fileStream.close();
+        }
+
+        size_t Write(const T &item) override {
+            if (!this->isOpen) throw runtime_error("Поток не открыт!");
+            chunk.push_back(item);
+            if (chunk.size() == chunkSize) FlushChunk();
+            this->position++;
+            return this->position;
+        }
+
+        using WritableStream<T>::WriteBlock;
+
+        // Блок дописывается в текущий блок файла кусками до его заполнения
+        size_t WriteBlock(const T *items, size_t count) override {
+            if (!this->isOpen) throw runtime_error("Поток не открыт!");
+            for (size_t done = 0; done < count;) {
+                size_t take = min(count-done, chunkSize-chunk.size());
+                chunk.insert(chunk.end(), items+done, items+done+take);
+                done += take;
+                if (chunk.size() == chunkSize) FlushChunk();
+            }
+            this->position += count;
+            return this->position;
+        }
+
+        size_t WriteAll(shared_ptr<Sequence<T>> seq) override {
+            return this->WriteAllInBlocks(seq);
+        }
+};
+
+
+// Класс потока для чтения колоночного файла; позиция - номер записи в файле
+template <typename T>
+class ColumnarReadOnlyStream: public ReadableStream<T> {
+    static_assert(is_arithmetic<T>::value, "Колоночный формат поддерживается только для числовых типов!");
+    protected:
+        mutable ifstream fileStream;
+        vector<ColumnChunk<T>> directory;
+        uint64_t recordCount;
+        mutable vector<T> buffer;
+        mutable size_t loadedChunk;
+        mutable size_t chunksLoaded;
+        // Результат последнего поиска: позиция, с которой искали, и найденная запись
+        mutable size_t searchedFrom;
+        mutable size_t nextMatch;
+        bool filtered;
+        T low;
+        T high;
+
+        template <typename U>
+        U ReadRaw() const {
+            U value;
+            if (!fileStream.read(reinterpret_cast<char*>(&value), sizeof(U))) throw runtime_error("Повреждённый колоночный файл!");
+            SwapLittleEndian(&value, 1);
+            return value;
+        }
+
+        size_t ChunkOf(size_t index) const {
+            auto it = upper_bound(directory.begin(), directory.end(), static_cast<uint64_t>(index),
+                [](uint64_t record, const ColumnChunk<T> &info) { return record < info.first; });
+            return static_cast<size_t>(it-directory.begin())-1;
+        }
+
+        void LoadChunk(size_t index) const {
+            if (index == loadedChunk) return;
+            const ColumnChunk<T> &info = directory[index];
+            buffer.resize(info.count);
+            fileStream.clear();
+            fileStream.seekg(static_cast<streamoff>(info.offset));
+            if (!fileStream.read(reinterpret_cast<char*>(buffer.data()), static_cast<streamsize>(info.count*sizeof(T)))) {
+                throw runtime_error("Ошибка чтения файла");
+            }
+            SwapLittleEndian(buffer.data(), buffer.size());
+            loadedChunk = index;
+            chunksLoaded++;
+        }
+
+        // Сравнения ложны для NaN, поэтому NaN не попадает в диапазон, а блок с зоной NaN не читается
+        bool InRange(const T &value) const {
+            return !filtered || (low <= value && value <= high);
+        }
+
+        // Зона блока пересекается с диапазоном фильтра
+        bool MayMatch(const ColumnChunk<T> &info) const {
+            return !filtered || (low <= info.max && info.min <= high);
+        }
+
+        // Каталог должен покрывать записи подряд с нуля, а блоки - лежать подряд между заголовком и каталогом
+        void ValidateDirectory(uint64_t directoryOffset) const {
+            uint64_t first = 0, offset = sizeof(BinaryStreamHeader);
+            for (const auto &info : directory) {
+                if (info.first != first || info.offset != offset || info.count == 0 ||
+                    info.count > (directoryOffset-offset)/sizeof(T)) {
+                    throw runtime_error("Повреждённый каталог колоночного файла!");
+                }
+                first += info.count;
+                offset += info.count*sizeof(T);
+            }
+            if (first != recordCount || offset != directoryOffset) throw runtime_error("Повреждённый каталог колоночного файла!");
+        }
+
+        // Номер ближайшей подходящей записи не раньше index; recordCount - таких нет
+        size_t Scan(size_t index) const {
+            while (index < recordCount) {
+                size_t current = ChunkOf(index);
+                const ColumnChunk<T> &info = directory[current];
+                size_t end = static_cast<size_t>(info.first+info.count);
+                if (!MayMatch(info)) {
+                    index = end;
+                    continue;
+                }
+                LoadChunk(current);
+                for (; index < end; index++) {
+                    if (InRange(buffer[index-info.first])) return index;
+                }
+            }
+            return static_cast<size_t>(recordCount);
+        }
+
+        // Найденная от позиции запись запоминается до смены позиции или фильтра, её блок остаётся загруженным
+        size_t FindNext() const {
+            if (searchedFrom == this->position) return nextMatch;
+            nextMatch = Scan(this->position);
+            searchedFrom = this->position;
+            return nextMatch;
+        }
+
+        void ResetSearch() { searchedFrom = SIZE_MAX; }
+    public:
+        // Конструкторы
+        ~ColumnarReadOnlyStream() override { try { Close(); } catch (...) {} }
+
+        explicit ColumnarReadOnlyStream(const string &filename):
+            Stream<T>(), recordCount(0), loadedChunk(SIZE_MAX), chunksLoaded(0),
+            searchedFrom(SIZE_MAX), nextMatch(0), filtered(false), low(), high() {
+            fileStream.open(filename, ios::binary);
+            if (!fileStream.is_open()) throw runtime_error("Невозможно открыть файл: " + filename);
+            BinaryStreamHeader header;
+            if (!fileStream.read(reinterpret_cast<char*>(&header), sizeof(header)) || memcmp(header.magic, "LZCOLM1", 8) != 0) {
+                throw runtime_error("Файл не является колоночным: " + filename);
+            }
+            SwapLittleEndian(&header.typeTag, 1);
+            SwapLittleEndian(&header.recordWidth, 1);
+            if (header.typeTag != BinaryTypeTag<T>() || header.recordWidth != sizeof(T)) {
+                throw runtime_error("Несовместимый тип записей колоночного файла: " + filename);
+            }
+            fileStream.seekg(0, ios::end);
+            uint64_t fileSize = static_cast<uint64_t>(fileStream.tellg());
+            if (fileSize < sizeof(header)+sizeof(ColumnarTrailer)) throw runtime_error("Колоночный файл не завершён: " + filename);
+            fileStream.seekg(-static_cast<streamoff>(sizeof(ColumnarTrailer)), ios::end);
+            uint64_t directoryOffset = ReadRaw<uint64_t>();
+            uint64_t chunkCount = ReadRaw<uint64_t>();
+            recordCount = ReadRaw<uint64_t>();
+            char magic[8];
+            if (!fileStream.read(magic, 8) || memcmp(magic, "LZCOLF1", 8) != 0) {
+                throw runtime_error("Колоночный файл не завершён: " + filename);
+            }
+            // Каталог занимает ровно место между своим адресом и концевиком
+            const uint64_t ENTRY_SIZE = 3*sizeof(uint64_t)+2*sizeof(T);
+            uint64_t tail = fileSize-sizeof(ColumnarTrailer);
+            if (directoryOffset < sizeof(header) || directoryOffset > tail || chunkCount != (tail-directoryOffset)/ENTRY_SIZE ||
+                (tail-directoryOffset) % ENTRY_SIZE != 0) {
+                throw runtime_error("Повреждённый концевик колоночного файла: " + filename);
+            }
+            fileStream.seekg(static_cast<streamoff>(directoryOffset));
+            directory.resize(chunkCount);
+            for (auto &info : directory) {
+                info.offset = ReadRaw<uint64_t>();
+                info.first = ReadRaw<uint64_t>();
+                info.count = ReadRaw<uint64_t>();
+                info.min = ReadRaw<T>();
+                info.max = ReadRaw<T>();
+            }
+            ValidateDirectory(directoryOffset);
+        }
+
+        // Декомпозиция
+        bool IsCanSeek() const override { return true; }
+
+        bool IsCanGoBack() const override { return true; }
+
+        bool IsEndOfStream() const override {
+            return !this->isOpen || FindNext() >= recordCount;
+        }
+
+        size_t GetRecordCount() const { return static_cast<size_t>(recordCount); }
+
+        size_t GetChunkCount() const { return directory.size(); }
+
+        const ColumnChunk<T>& GetChunk(size_t index) const {
+            if (index >= directory.size()) throw out_of_range("Некорректный номер блока!");
+            return directory[index];
+        }
+
+        // Число прочитанных с диска блоков (для оценки эффективности фильтра)
+        size_t GetChunksLoaded() const { return chunksLoaded; }
+
+        T Peek() const override {
+            if (!this->isOpen) throw runtime_error("Поток не открыт!");
+            size_t index = FindNext();
+            if (index >= recordCount) throw runtime_error("Достигнут конец потока!");
+            return buffer[index-directory[loadedChunk].first];
+        }
+
+        T Read() override {
+            if (!this->isOpen) throw runtime_error("Поток не открыт!");
+            size_t index = FindNext();
+            if (index >= recordCount) throw runtime_error("Достигнут конец потока!");
+            this->position = index+1;
+            return buffer[index-directory[loadedChunk].first];
+        }
+
+        using ReadableStream<T>::ReadBlock;
+
+        // Без фильтра записи копируются из блока целиком, с фильтром - только подходящие
+        size_t ReadBlock(T *out, size_t count) override {
+            if (!this->isOpen) throw runtime_error("Поток не открыт!");
+            size_t filled = 0;
+            while (filled < count) {
+                size_t index = FindNext();
+                if (index >= recordCount) break;
+                const ColumnChunk<T> &info = directory[loadedChunk];
+                size_t take = filtered ? 1 : min(count-filled, static_cast<size_t>(info.first+info.count)-index);
+                copy(&buffer[index-info.first], &buffer[index-info.first]+take, out+filled);
+                filled += take;
+                this->position = index+take;
+            }
+            return filled;
+        }
+
+        // Переход к записи по каталогу блоков: читается только блок с этой записью
+        size_t Seek(size_t index) override {
+            if (!this->isOpen) throw runtime_error("Поток не открыт!");
+            if (index > recordCount) throw out_of_range("Индекс за пределами потока!");
+            this->position = index;
+            ResetSearch();
+            return this->position;
+        }
+
+        // Операции
+        // Чтение только значений из [from, to]; блоки вне диапазона пропускаются целиком
+        void SetRange(T from, T to) {
+            if (!(from <= to)) throw invalid_argument("Некорректный диапазон фильтра!");
+            filtered = true;
+            low = from;
+            high = to;
+            ResetSearch();
+        }
+
+        void ClearRange() {
+            filtered = false;
+            ResetSearch();
+        }
+
+        void Open() override {
+            if (this->isOpen) return;
+            if (!fileStream.is_open()) throw runtime_error("Не удалось открыть поток: файл закрыт!");
+            this->isOpen = true;
+        }
+
+        void Close() override {
+            if (!this->isOpen) return;
+            fileStream.close();
+            this->isOpen = false;
+            this->position = 0;
+            ResetSearch();
+        }
+};
+
+#endif // COLUMNARSTREAM_HPP
@@ -0,0 +1,407 @@
+#ifndef COMPRESSEDSTREAM_HPP
+#define COMPRESSEDSTREAM_HPP
+
+#include <map>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
+#include <vector>
+#include <algorithm>
+#include "StreamEncoder.hpp"
+using namespace std;
+
+
+// Сжатый файл: заголовок, блоки сериализованных строк (каждый сжат своим кодеком), индекс блоков и концевик
+// Блок режется по границе записи, поэтому любой блок распаковывается независимо от остальных
+struct CompressedBlock {
+    uint64_t offset;
+    uint64_t storedSize;
+    uint64_t rawSize;
+    uint64_t first;
+    uint64_t count;
+    BlockCodec codec;
+};
+
+struct CompressedTrailer {
+    uint64_t indexOffset;
+    uint64_t blockCount;
+    uint64_t recordCount;
+    char magic[8];
+};
+
+struct CompressedStreamHeader {
+    char magic[8];
+    uint64_t blockSize;
+};
+
+
+// Класс потока для записи сжатого файла
+template <typename T>
+class CompressedWriteOnlyStream: public WritableStream<T> {
+    protected:
+        ofstream fileStream;
+        shared_ptr<Serializer<T>> serializer;
+        BlockCodec codec;
+        size_t blockSize;
+        string block;
+        size_t blockRecords;
+        vector<CompressedBlock> index;
+        uint64_t offset;
+
+        void WriteRaw(const void *data, size_t size) {
+            fileStream.write(static_cast<const char*>(data), static_cast<streamsize>(size));
+            if (!fileStream.good()) throw runtime_error("Ошибка записи в файл");
+            offset += size;
+        }
+
+        void WriteNumber(uint64_t value) {
+            SwapLittleEndian(&value, 1);
+            WriteRaw(&value, sizeof(value));
+        }
+
+        // Блок, который кодек не уменьшил, хранится без сжатия
+        void FlushBlock() {
+            if (blockRecords == 0) return;
+            CompressedBlock info;
+            info.offset = offset;
+            info.rawSize = block.size();
+            info.first = index.empty() ? 0 : index.back().first+index.back().count;
+            info.count = blockRecords;
+            info.codec = codec;
+            string encoded = StreamEncoder::EncodeBlock(codec, block);
+            if (encoded.size() >= block.size()) {
+                info.codec = BlockCodec::None;
+                encoded = move(block);
+            }
+            info.storedSize = encoded.size();
+            WriteRaw(encoded.data(), encoded.size());
+            index.push_back(info);
+            block = string();
+            block.reserve(blockSize);
+            blockRecords = 0;
+        }
+    public:
+        static constexpr size_t DEFAULT_BLOCK_SIZE = 65536;
+
+        // Конструкторы
+        ~CompressedWriteOnlyStream() override { try { Close(); } catch (...) {} }
+
+        CompressedWriteOnlyStream(const string &filename, shared_ptr<Serializer<T>> ser,
+                                  BlockCodec blockCodec = BlockCodec::LZ, size_t blockBytes = DEFAULT_BLOCK_SIZE):
+            Stream<T>(), serializer(ser), codec(blockCodec), blockSize(blockBytes), blockRecords(0), offset(0) {
+            if (!ser) throw runtime_error("Сериализатор не может быть пустым!");
+            if (blockBytes == 0) throw invalid_argument("Размер блока должен быть положительным!");
+            fileStream.open(filename, ios::binary | ios::trunc);
+            if (!fileStream.is_open()) throw runtime_error("Невозможно открыть файл: " + filename);
+            CompressedStreamHeader header;
+            memcpy(header.magic, "LZBLKH1", 8);
+            header.blockSize = blockSize;
+            SwapLittleEndian(&header.blockSize, 1);
+            WriteRaw(&header, sizeof(header));
+            block.reserve(blockSize);
+        }
+
+        // Декомпозиция
+        size_t GetBlockCount() const { return index.size(); }
+
+        // Операции
+        void Open() override {
+            if (this->isOpen) return;
+            if (!fileStream.is_open()) throw runtime_error("Не удалось открыть поток для записи: файл закрыт!");
+            this->isOpen = true;
+        }
+
+        // Запись последнего блока и индекса; без Close файл не читается
+        void Close() override {
+            if (!this->isOpen) return;
+            this->isOpen = false;
+            this->position = 0;
+            FlushBlock();
+            CompressedTrailer trailer;
+            trailer.indexOffset = offset;
+            trailer.blockCount = index.size();
+            trailer.recordCount = index.empty() ? 0 : index.back().first+index.back().count;
+            for (const auto &info : index) {
+                WriteNumber(info.offset);
+                WriteNumber(info.storedSize);
+                WriteNumber(info.rawSize);
+                WriteNumber(info.first);
+                WriteNumber(info.count);
+                WriteRaw(&info.codec, 1);
+            }
+            WriteNumber(trailer.indexOffset);
+            WriteNumber(trailer.blockCount);
+            WriteNumber(trailer.recordCount);
+            WriteRaw("LZBLKF1", 8);
+            fileStream.close();
+        }
+
+        size_t Write(const T &item) override {
+            return WriteBlock(&item, 1);
+        }
+
+        using WritableStream<T>::WriteBlock;
+
+        size_t WriteBlock(const T *items, size_t count) override {
+            if (!this->isOpen) throw runtime_error("Поток не открыт!");
+            for (size_t i = 0; i < count; i++) {
+                block += serializer->Serialize(items[i]);
+                block += '\n';
+                blockRecords++;
+                if (block.size() >= blockSize) FlushBlock();
+            }
+            this->position += count;
+            return this->position;
+        }
+
+        size_t WriteAll(shared_ptr<Sequence<T>> seq) override {
+            return this->WriteAllInBlocks(seq);
+        }
+};
+
+
+// Класс потока для чтения сжатого файла; позиция - номер записи
+// При readAhead > 0 следующие блоки распаковываются заранее общим пулом потоков,
+// поэтому десериализатор в этом режиме должен допускать вызовы из разных потоков
+template <typename T>
+class CompressedReadOnlyStream: public ReadableStream<T> {
+    protected:
+        // Распаковка блока, запущенная заранее; cancelled - результат больше не нужен
+        struct PendingBlock {
+            atomic<bool> done{false};
+            atomic<bool> cancelled{false};
+            vector<T> records;
+            exception_ptr error;
+            mutex lock;
+            condition_variable finished;
+
+            void Finish() {
+                lock_guard<mutex> guard(lock);
+                done = true;
+                finished.notify_all();
+            }
+        };
+
+        MappedFile file;
+        shared_ptr<Deserializer<T>> deserializer;
+        vector<CompressedBlock> index;
+        uint64_t recordCount;
+        size_t readAhead;
+        mutable vector<T> records;
+        mutable size_t loadedBlock;
+        mutable atomic<size_t> blocksDecoded;
+        mutable map<size_t, shared_ptr<PendingBlock>> pending;
+        mutable vector<shared_ptr<PendingBlock>> abandoned;
+
+        template <typename U>
+        U ReadRaw(size_t &cursor) const {
+            U value;
+            if (cursor+sizeof(U) > file.GetSize()) throw runtime_error("Повреждённый сжатый файл!");
+            memcpy(&value, file.GetData()+cursor, sizeof(U));
+            cursor += sizeof(U);
+            SwapLittleEndian(&value, 1);
+            return value;
+        }
+
+        size_t BlockOf(size_t record) const {
+            auto it = upper_bound(index.begin(), index.end(), static_cast<uint64_t>(record),
+                [](uint64_t value, const CompressedBlock &info) { return value < info.first; });
+            return static_cast<size_t>(it-index.begin())-1;
+        }
+
+        void DecodeBlock(size_t number, vector<T> &out) const {
+            const CompressedBlock &info = index[number];
+            string raw = StreamEncoder::DecodeBlock(info.codec, file.GetData()+info.offset,
+                                                    static_cast<size_t>(info.storedSize), static_cast<size_t>(info.rawSize));
+            out.clear();
+            out.reserve(static_cast<size_t>(info.count));
+            size_t start = 0;
+            while (start < raw.size()) {
+                size_t end = raw.find('\n', start);
+                if (end == string::npos) end = raw.size();
+                out.push_back(deserializer->Deserialize(raw.substr(start, end-start)));
+                start = end+1;
+            }
+            if (out.size() != info.count) throw runtime_error("Повреждённый сжатый блок!");
+            blocksDecoded++;
+        }
+
+        // Пока в пуле есть задачи, ожидающий поток помогает их выполнять, а затем засыпает до окончания распаковки
+        static void Wait(PendingBlock &slot) {
+            ThreadPool &pool = GetSharedThreadPool();
+            while (!slot.done) {
+                if (pool.RunPending()) continue;
+                unique_lock<mutex> guard(slot.lock);
+                slot.finished.wait(guard, [&slot]() { return slot.done.load(); });
+            }
+        }
+
+        // Запуск распаковки блоков, следующих за number; ставшие ненужными задачи отменяются
+        void ScheduleAhead(size_t number) const {
+            for (auto it = pending.begin(); it != pending.end();) {
+                if (it->first > number && it->first <= number+readAhead) {
+                    ++it;
+                    continue;
+                }
+                it->second->cancelled = true;
+                abandoned.push_back(it->second);
+                it = pending.erase(it);
+            }
+            abandoned.erase(remove_if(abandoned.begin(), abandoned.end(),
+                [](const shared_ptr<PendingBlock> &slot) { return slot->done.load(); }), abandoned.end());
+            for (size_t next = number+1; next <= number+readAhead && next < index.size(); next++) {
+                if (pending.count(next)) continue;
+                auto slot = make_shared<PendingBlock>();
+                pending[next] = slot;
+                GetSharedThreadPool().Submit([this, slot, next]() {
+                    if (!slot->cancelled) {
+                        try {
+                            DecodeBlock(next, slot->records);
+                        } catch (...) {
+                            slot->error = current_exception();
+                        }
+                    }
+                    slot->Finish();
+                });
+            }
+        }
+
+        void LoadBlock(size_t number) const {
+            if (number == loadedBlock) return;
+            auto it = pending.find(number);
+            if (it != pending.end()) {
+                shared_ptr<PendingBlock> slot = it->second;
+                pending.erase(it);
+                Wait(*slot);
+                if (slot->error) rethrow_exception(slot->error);
+                records = move(slot->records);
+            } else {
+                DecodeBlock(number, records);
+            }
+            loadedBlock = number;
+            if (readAhead) ScheduleAhead(number);
+        }
+
+        void WaitAll() const {
+            for (auto &entry : pending) {
+                entry.second->cancelled = true;
+                Wait(*entry.second);
+            }
+            for (auto &slot : abandoned) Wait(*slot);
+            pending.clear();
+            abandoned.clear();
+        }
+    public:
+        // Конструкторы
+        ~CompressedReadOnlyStream() override { try { Close(); WaitAll(); } catch (...) {} }
+
+        CompressedReadOnlyStream(const string &filename, shared_ptr<Deserializer<T>> deser, size_t readAheadBlocks = 0):
+            Stream<T>(), file(filename), deserializer(deser), recordCount(0), readAhead(readAheadBlocks),
+            loadedBlock(SIZE_MAX), blocksDecoded(0) {
+            if (!deser) throw runtime_error("Десериализатор не может быть пустым!");
+            CompressedStreamHeader header;
+            if (file.GetSize() < sizeof(header)+sizeof(CompressedTrailer)) throw runtime_error("Файл не является сжатым: " + filename);
+            memcpy(&header, file.GetData(), sizeof(header));
+            if (memcmp(header.magic, "LZBLKH1", 8) != 0) throw runtime_error("Файл не является сжатым: " + filename);
+            size_t cursor = file.GetSize()-sizeof(CompressedTrailer);
+            uint64_t indexOffset = ReadRaw<uint64_t>(cursor);
+            uint64_t blockCount = ReadRaw<uint64_t>(cursor);
+            recordCount = ReadRaw<uint64_t>(cursor);
+            if (memcmp(file.GetData()+cursor, "LZBLKF1", 8) != 0) throw runtime_error("Сжатый файл не завершён: " + filename);
+            cursor = static_cast<size_t>(indexOffset);
+            index.resize(static_cast<size_t>(blockCount));
+            for (auto &info : index) {
+                info.offset = ReadRaw<uint64_t>(cursor);
+                info.storedSize = ReadRaw<uint64_t>(cursor);
+                info.rawSize = ReadRaw<uint64_t>(cursor);
+                info.first = ReadRaw<uint64_t>(cursor);
+                info.count = ReadRaw<uint64_t>(cursor);
+                info.codec = static_cast<BlockCodec>(ReadRaw<uint8_t>(cursor));
+                if (info.offset+info.storedSize > indexOffset) throw runtime_error("Повреждённый сжатый файл!");
+            }
+        }
+
+        // Декомпозиция
+        bool IsCanSeek() const override { return true; }
+
+        bool IsCanGoBack() const override { return true; }
+
+        bool IsEndOfStream() const override {
+            return !this->isOpen || this->position >= recordCount;
+        }
+
+        size_t GetRecordCount() const { return static_cast<size_t>(recordCount); }
+
+        size_t GetBlockCount() const { return index.size(); }
+
+        const CompressedBlock& GetBlock(size_t number) const {
+            if (number >= index.size()) throw out_of_range("Некорректный номер блока!");
+            return index[number];
+        }
+
+        // Число распакованных блоков, включая распакованные заранее
+        size_t GetBlocksDecoded() const { return blocksDecoded; }
+
+        T Peek() const override {
+            if (!this->isOpen) throw runtime_error("Поток не открыт!");
+            if (this->position >= recordCount) throw runtime_error("Достигнут конец потока!");
+            size_t number = BlockOf(this->position);
+            LoadBlock(number);
+            return records[this->position-index[number].first];
+        }
+
+        T Read() override {
+            if (!this->isOpen) throw runtime_error("Поток не открыт!");
+            if (this->position >= recordCount) throw runtime_error("Достигнут конец потока!");
+            size_t number = BlockOf(this->position);
+            LoadBlock(number);
+            return move(records[this->position++ - index[number].first]);
+        }
+
+        using ReadableStream<T>::ReadBlock;
+
+        // Записи переносятся из распакованных блоков без поэлементных проверок
+        size_t ReadBlock(T *out, size_t count) override {
+            if (!this->isOpen) throw runtime_error("Поток не открыт!");
+            size_t filled = 0;
+            while (filled < count && this->position < recordCount) {
+                size_t number = BlockOf(this->position);
+                LoadBlock(number);
+                const CompressedBlock &info = index[number];
+                size_t offset = this->position-static_cast<size_t>(info.first);
+                size_t take = min(count-filled, static_cast<size_t>(info.count)-offset);
+                move(records.begin()+offset, records.begin()+offset+take, out+filled);
+                filled += take;
+                this->position += take;
+            }
+            return filled;
+        }
+
+        // Переход к записи по индексу блоков: распаковывается только блок с этой записью, при первом чтении
+        size_t Seek(size_t record) override {
+            if (!this->isOpen) throw runtime_error("Поток не открыт!");
+            if (record > recordCount) throw out_of_range("Индекс за пределами потока!");
+            // Прочитанные элементы блока перемещены в Read, поэтому при возврате назад блок распаковывается заново
+            if (record < this->position) loadedBlock = SIZE_MAX;
+            this->position = record;
+            return this->position;
+        }
+
+        // Операции
+        void Open() override {
+            if (this->isOpen) return;
+            if (!file.IsOpen()) throw runtime_error("Не удалось открыть поток: файл закрыт!");
+            this->isOpen = true;
+        }
+
+        void Close() override {
+            if (!this->isOpen) return;
+            this->isOpen = false;
+            this->position = 0;
+            WaitAll();
+            records.clear();
+            loadedBlock = SIZE_MAX;
+        }
+};
+
+#endif // COMPRESSEDSTREAM_HPP
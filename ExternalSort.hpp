@@ -0,0 +1,320 @@
+#ifndef EXTERNALSORT_HPP
+#define EXTERNALSORT_HPP
+
+#include <mutex>
+#include <chrono>
+#include <thread>
+#include <atomic>
+#include <vector>
+#include <cstdio>
+#include "Stream.hpp"
+#include "sequences/LoserTree.hpp"
+using namespace std;
+
+
+// Внешняя сортировка потоков, не помещающихся в память.
+// Фаза серий: источник читается в один из двух буферов по memoryBytes/2; заполненный буфер сортируется
+// параллельно по блокам и сбрасывается во временный двоичный файл в фоновом потоке, пока читается следующий.
+// Фаза слияния: серии сливаются деревом проигравших не более чем по fanIn за проход; выходные пакеты
+// пишутся отдельным потоком, поэтому слияние не ждёт записи. Сортировка неустойчива.
+// Источник читается один раз: ещё не читавшийся ReadOnlyStream без индексатора (файл, генератор) переводится
+// в потоковый режим, иначе он кешировал бы каждую прочитанную запись; вернуться назад по нему после сортировки нельзя
+
+// Счётчики последней сортировки
+struct ExternalSortStatistics {
+    size_t items;
+    size_t runs;
+    size_t mergePasses;
+    double runSeconds;
+    double mergeSeconds;
+};
+
+template <typename T>
+class ExternalSorter {
+    private:
+        using Compare = function<bool(const T&, const T&)>;
+        using Tree = LoserTree<T, Compare>;
+
+        // Курсор по отсортированному блоку в памяти
+        struct MemoryCursor {
+            const T *current;
+            const T *end;
+
+            bool Next(T &out) {
+                if (current == end) return false;
+                out = *current++;
+                return true;
+            }
+        };
+
+        // Курсор по серии во временном файле, чтение блоками
+        struct FileCursor {
+            unique_ptr<BinaryReadOnlyStream<T>> stream;
+            vector<T> block;
+            size_t position = 0;
+            size_t filled = 0;
+
+            FileCursor(const string &filename, size_t blockSize): stream(make_unique<BinaryReadOnlyStream<T>>(filename)), block(blockSize) {
+                stream->Open();
+            }
+
+            bool Next(T &out) {
+                if (position == filled) {
+                    filled = stream->ReadBlock(block.data(), block.size());
+                    position = 0;
+                    if (filled == 0) return false;
+                }
+                out = move(block[position++]);
+                return true;
+            }
+        };
+
+        // Фоновая запись пакетов в приёмник; очередь не длиннее lag пакетов
+        class BlockWriter {
+            private:
+                WritableStream<T> &target;
+                SpscQueue<vector<T>> queue;
+                atomic<bool> failed;
+                exception_ptr error;
+                thread worker;
+
+                void WriterLoop() {
+                    try {
+                        vector<T> block;
+                        while (queue.Pop(block, failed)) {
+                            target.WriteBlock(block.data(), block.size());
+                            block.clear();
+                        }
+                    } catch (...) {
+                        error = current_exception();
+                        failed = true;
+                        queue.Wake();
+                    }
+                }
+            public:
+                BlockWriter(WritableStream<T> &stream, size_t lag): target(stream), queue(lag), failed(false) {
+                    worker = thread([this]() { WriterLoop(); });
+                }
+
+                ~BlockWriter() {
+                    queue.Close();
+                    if (worker.joinable()) worker.join();
+                }
+
+                // Ожидание места в очереди; ошибка записи передаётся вызывающему
+                void Push(vector<T> &block) {
+                    if (!queue.Push(block, failed)) Finish();
+                }
+
+                // Дожидается записи всех пакетов; ошибка записи передаётся вызывающему
+                void Finish() {
+                    queue.Close();
+                    if (worker.joinable()) worker.join();
+                    if (error) rethrow_exception(error);
+                }
+        };
+
+        // Временные файлы удаляются при любом завершении сортировки
+        struct TempFiles {
+            vector<string> names;
+
+            ~TempFiles() {
+                for (const auto &name : names) remove(name.c_str());
+            }
+        };
+
+        size_t memoryBytes;
+        string tempDirectory;
+        size_t fanIn;
+        size_t threads;
+        Compare less;
+        ExternalSortStatistics statistics;
+
+        size_t GetRunCapacity() const { return max<size_t>(1, memoryBytes/sizeof(T)/2); }
+
+        // Буфер курсора слияния: память делится между fanIn входами и пакетами в очереди записи
+        size_t GetMergeBlockSize() const {
+            return max<size_t>(MIN_MERGE_BLOCK, memoryBytes/sizeof(T)/(fanIn+OUTPUT_LAG+1));
+        }
+
+        string CreateTempName(TempFiles &files) {
+            static atomic<size_t> counter(0);
+            string name = tempDirectory + "/lzsort_" + to_string(chrono::steady_clock::now().time_since_epoch().count())
+                          + "_" + to_string(counter++) + ".run";
+            files.names.push_back(name);
+            return name;
+        }
+
+        // k-путевое слияние курсоров; пакеты по blockSize элементов передаются в фоновую запись
+        template <typename Cursor>
+        void Merge(vector<Cursor> &cursors, WritableStream<T> &target) {
+            size_t blockSize = GetMergeBlockSize();
+            BlockWriter writer(target, OUTPUT_LAG);
+            Tree tree(cursors.size(), less);
+            T head;
+            for (size_t i = 0; i < cursors.size(); i++) {
+                if (cursors[i].Next(head)) tree.Set(i, move(head));
+            }
+            tree.Build();
+            vector<T> block;
+            block.reserve(blockSize);
+            while (!tree.IsEmpty()) {
+                size_t source = tree.Top();
+                block.push_back(move(tree.TopKey()));
+                if (cursors[source].Next(head)) tree.Replace(move(head));
+                else tree.Pop();
+                if (block.size() == blockSize) {
+                    writer.Push(block);
+                    block = vector<T>();
+                    block.reserve(blockSize);
+                }
+            }
+            if (!block.empty()) writer.Push(block);
+            writer.Finish();
+        }
+
+        // Параллельная сортировка блоков буфера и запись их слияния
+        void SortAndWrite(vector<T> &items, size_t count, WritableStream<T> &target) {
+            size_t chunks = GetChunkCount(count, threads);
+            vector<MemoryCursor> cursors(chunks);
+            ParallelFor(count, chunks, [&](size_t chunk, size_t from, size_t to) {
+                sort(items.begin()+from, items.begin()+to, less);
+                cursors[chunk] = {items.data()+from, items.data()+to};
+            });
+            if (chunks == 1) {
+                target.WriteBlock(items.data(), count);
+                return;
+            }
+            Merge(cursors, target);
+        }
+
+        void SpillRun(vector<T> &items, size_t count, const string &filename) {
+            BinaryWriteOnlyStream<T> run(filename);
+            run.Open();
+            SortAndWrite(items, count, run);
+            run.Close();
+        }
+
+        void MergeFiles(const vector<string> &runs, WritableStream<T> &target) {
+            size_t blockSize = GetMergeBlockSize();
+            vector<FileCursor> cursors;
+            cursors.reserve(runs.size());
+            for (const auto &run : runs) cursors.emplace_back(run, blockSize);
+            Merge(cursors, target);
+        }
+
+        static size_t Fill(ReadableStream<T> &source, vector<T> &buffer) {
+            size_t filled = 0;
+            while (filled < buffer.size()) {
+                size_t count = source.ReadBlock(buffer.data()+filled, buffer.size()-filled);
+                if (count == 0) break;
+                filled += count;
+            }
+            return filled;
+        }
+    public:
+        static constexpr size_t DEFAULT_MEMORY_BYTES = size_t(256) << 20;
+        static constexpr size_t DEFAULT_FAN_IN = 64;
+        static constexpr size_t MIN_MERGE_BLOCK = 256;
+        static constexpr size_t OUTPUT_LAG = 4;
+
+        // Конструкторы
+        // memoryBytes - память под буферы серий и слияния, tempDirectory - каталог временных файлов серий,
+        // fanIn - наибольшее число серий в одном слиянии
+        explicit ExternalSorter(size_t memory = DEFAULT_MEMORY_BYTES, const string &directory = ".", size_t maxFanIn = DEFAULT_FAN_IN,
+                                Compare compare = std::less<T>(), size_t threadCount = 0):
+            memoryBytes(memory), tempDirectory(directory), fanIn(maxFanIn), threads(threadCount), less(compare), statistics() {
+            static_assert(is_trivially_copyable<T>::value, "Внешняя сортировка поддерживается только для тривиально копируемых типов!");
+            if (memory < 2*sizeof(T)) throw invalid_argument("Слишком маленький бюджет памяти!");
+            if (maxFanIn < 2) throw invalid_argument("В слиянии должно участвовать не меньше двух серий!");
+            if (!compare) throw invalid_argument("Не задан порядок сортировки!");
+        }
+
+        // Декомпозиция
+        const ExternalSortStatistics& GetStatistics() const { return statistics; }
+
+        // Операции
+        // Сортировка открытого источника до конца в открытый приёмник; возвращает число записанных элементов
+        size_t Sort(shared_ptr<ReadableStream<T>> source, shared_ptr<WritableStream<T>> sink) {
+            if (!source || !sink) throw invalid_argument("Пустой поток!");
+            if (!source->IsOpen() || !sink->IsOpen()) throw runtime_error("Поток не открыт!");
+            if (auto stream = dynamic_pointer_cast<ReadOnlyStream<T>>(source)) {
+                auto data = stream->GetData();
+                if (data && !data->IsIndexAddressable() && !data->IsStreaming() && data->GetMaterializedCount() == 0) stream->SetStreaming(true);
+            }
+            statistics = ExternalSortStatistics();
+            TempFiles files;
+            vector<string> runs;
+            vector<T> buffers[2] = {vector<T>(GetRunCapacity()), vector<T>()};
+            size_t current = 0;
+            thread spiller;
+            exception_ptr spillError;
+            auto waitSpill = [&]() {
+                if (spiller.joinable()) spiller.join();
+                if (spillError) rethrow_exception(spillError);
+            };
+
+            auto start = chrono::steady_clock::now();
+            try {
+                while (true) {
+                    size_t filled = Fill(*source, buffers[current]);
+                    if (filled == 0) break;
+                    statistics.items += filled;
+                    statistics.runs++;
+                    // Всё поместилось в один буфер: временные файлы не нужны
+                    if (runs.empty() && (filled < buffers[current].size() || source->IsEndOfStream())) {
+                        SortAndWrite(buffers[current], filled, *sink);
+                        statistics.runSeconds = chrono::duration<double>(chrono::steady_clock::now()-start).count();
+                        return filled;
+                    }
+                    waitSpill();
+                    runs.push_back(CreateTempName(files));
+                    spiller = thread([this, &buffers, &spillError, current, filled, name = runs.back()]() {
+                        try {
+                            SpillRun(buffers[current], filled, name);
+                        } catch (...) {
+                            spillError = current_exception();
+                        }
+                    });
+                    current ^= 1;
+                    if (buffers[current].empty()) buffers[current].resize(GetRunCapacity());
+                }
+                waitSpill();
+            } catch (...) {
+                if (spiller.joinable()) spiller.join();
+                throw;
+            }
+            vector<T>().swap(buffers[0]);
+            vector<T>().swap(buffers[1]);
+            statistics.runSeconds = chrono::duration<double>(chrono::steady_clock::now()-start).count();
+
+            start = chrono::steady_clock::now();
+            // Промежуточные проходы, пока серий больше fanIn
+            while (runs.size() > fanIn) {
+                vector<string> merged;
+                for (size_t from = 0; from < runs.size(); from += fanIn) {
+                    vector<string> group(runs.begin()+from, runs.begin()+min(runs.size(), from+fanIn));
+                    if (group.size() == 1) {
+                        merged.push_back(group[0]);
+                        continue;
+                    }
+                    merged.push_back(CreateTempName(files));
+                    BinaryWriteOnlyStream<T> output(merged.back());
+                    output.Open();
+                    MergeFiles(group, output);
+                    output.Close();
+                    for (const auto &run : group) remove(run.c_str());
+                }
+                runs.swap(merged);
+                statistics.mergePasses++;
+            }
+            if (!runs.empty()) {
+                MergeFiles(runs, *sink);
+                statistics.mergePasses++;
+            }
+            statistics.mergeSeconds = chrono::duration<double>(chrono::steady_clock::now()-start).count();
+            return statistics.items;
+        }
+};
+
+#endif // EXTERNALSORT_HPP
@@ -0,0 +1,522 @@
+#ifndef FILEIO_HPP
+#define FILEIO_HPP
+
+#include <string>
+#include <vector>
+#include <mutex>
+#include <chrono>
+#include <cerrno>
+#include <cstring>
+#include <cstdint>
+#include <stdexcept>
+#include <condition_variable>
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#define FILEIO_HAS_IO_URING 1
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+// linux/fs.h определяет макрос BLOCK_SIZE, совпадающий с именами констант классов
+#ifdef BLOCK_SIZE
+#undef BLOCK_SIZE
+#endif
+#endif
+#endif
+#include "Parallel.hpp"
+using namespace std;
+
+
+// Размер и время последнего изменения файла: по ним проверяется актуальность производных файлов (индексов)
+struct FileStamp {
+    uint64_t size = 0;
+    int64_t modified = 0;
+
+    bool operator==(const FileStamp &other) const { return size == other.size && modified == other.modified; }
+    bool operator!=(const FileStamp &other) const { return !(*this == other); }
+};
+
+inline FileStamp GetFileStamp(const string &filename) {
+    FileStamp stamp;
+#ifdef _WIN32
+    WIN32_FILE_ATTRIBUTE_DATA info;
+    if (!GetFileAttributesExA(filename.c_str(), GetFileExInfoStandard, &info)) throw runtime_error("Невозможно получить свойства файла: " + filename);
+    stamp.size = (static_cast<uint64_t>(info.nFileSizeHigh) << 32) | info.nFileSizeLow;
+    stamp.modified = static_cast<int64_t>((static_cast<uint64_t>(info.ftLastWriteTime.dwHighDateTime) << 32) | info.ftLastWriteTime.dwLowDateTime);
+#else
+    struct stat info;
+    if (stat(filename.c_str(), &info) != 0) throw runtime_error("Невозможно получить свойства файла: " + filename);
+    stamp.size = static_cast<uint64_t>(info.st_size);
+    stamp.modified = static_cast<int64_t>(info.st_mtime)*1000000000;
+#if defined(__linux__)
+    stamp.modified += info.st_mtim.tv_nsec;
+#elif defined(__APPLE__)
+    stamp.modified += info.st_mtimespec.tv_nsec;
+#endif
+#endif
+    return stamp;
+}
+
+
+// Класс отображения файла в память (только чтение)
+class MappedFile {
+    private:
+        const char *data;
+        size_t size;
+#ifdef _WIN32
+        HANDLE file;
+        HANDLE mapping;
+#else
+        int fd;
+#endif
+    public:
+        // Конструкторы
+        MappedFile(): data(nullptr), size(0),
+#ifdef _WIN32
+            file(INVALID_HANDLE_VALUE), mapping(nullptr) {}
+#else
+            fd(-1) {}
+#endif
+
+        explicit MappedFile(const string &filename): MappedFile() { Open(filename); }
+
+        ~MappedFile() { Close(); }
+
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+
+        // Декомпозиция
+        bool IsOpen() const {
+#ifdef _WIN32
+            return file != INVALID_HANDLE_VALUE;
+#else
+            return fd >= 0;
+#endif
+        }
+        const char* GetData() const { return data; }
+        size_t GetSize() const { return size; }
+
+        // Операции
+        void Open(const string &filename) {
+            Close();
+#ifdef _WIN32
+            file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+            if (file == INVALID_HANDLE_VALUE) throw runtime_error("Невозможно открыть файл: " + filename);
+            LARGE_INTEGER fileSize;
+            if (!GetFileSizeEx(file, &fileSize)) {
+                Close();
+                throw runtime_error("Невозможно получить размер файла: " + filename);
+            }
+            size = static_cast<size_t>(fileSize.QuadPart);
+            if (size == 0) return;
+            mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+            if (!mapping) {
+                Close();
+                throw runtime_error("Невозможно отобразить файл в память: " + filename);
+            }
+            data = static_cast<const char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+            if (!data) {
+                Close();
+                throw runtime_error("Невозможно отобразить файл в память: " + filename);
+            }
+#else
+            fd = ::open(filename.c_str(), O_RDONLY);
+            if (fd < 0) throw runtime_error("Невозможно открыть файл: " + filename);
+            struct stat info;
+            if (fstat(fd, &info) != 0) {
+                Close();
+                throw runtime_error("Невозможно получить размер файла: " + filename);
+            }
+            size = static_cast<size_t>(info.st_size);
+            if (size == 0) return;
+            void *address = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (address == MAP_FAILED) {
+                Close();
+                throw runtime_error("Невозможно отобразить файл в память: " + filename);
+            }
+            data = static_cast<const char*>(address);
+#endif
+        }
+
+        void Close() {
+#ifdef _WIN32
+            if (data) UnmapViewOfFile(data);
+            if (mapping) CloseHandle(mapping);
+            if (file != INVALID_HANDLE_VALUE) CloseHandle(file);
+            mapping = nullptr;
+            file = INVALID_HANDLE_VALUE;
+#else
+            if (data) munmap(const_cast<char*>(data), size);
+            if (fd >= 0) ::close(fd);
+            fd = -1;
+#endif
+            data = nullptr;
+            size = 0;
+        }
+};
+
+
+#ifdef FILEIO_HAS_IO_URING
+// Минимальная обёртка над io_uring (без liburing): только позиционная запись и разбор завершений
+class IoUring {
+    private:
+        int ringFd;
+        void *sqRing;
+        void *cqRing;
+        size_t sqRingSize;
+        size_t cqRingSize;
+        io_uring_sqe *sqes;
+        size_t sqesSize;
+        unsigned *sqTail;
+        unsigned *sqMask;
+        unsigned *sqArray;
+        unsigned *cqHead;
+        unsigned *cqTail;
+        unsigned *cqMask;
+        io_uring_cqe *cqes;
+
+        static unsigned* Field(void *base, unsigned offset) {
+            return reinterpret_cast<unsigned*>(static_cast<char*>(base)+offset);
+        }
+
+        int Enter(unsigned submit, unsigned wait, unsigned flags) {
+            int result;
+            do {
+                result = static_cast<int>(syscall(__NR_io_uring_enter, ringFd, submit, wait, flags, nullptr, 0));
+            } while (result < 0 && errno == EINTR);
+            return result;
+        }
+    public:
+        IoUring(): ringFd(-1), sqRing(MAP_FAILED), cqRing(MAP_FAILED), sqRingSize(0), cqRingSize(0), sqes(nullptr), sqesSize(0) {}
+
+        ~IoUring() {
+            if (sqes) munmap(sqes, sqesSize);
+            if (cqRing != MAP_FAILED && cqRing != sqRing) munmap(cqRing, cqRingSize);
+            if (sqRing != MAP_FAILED) munmap(sqRing, sqRingSize);
+            if (ringFd >= 0) ::close(ringFd);
+        }
+
+        IoUring(const IoUring&) = delete;
+        IoUring& operator=(const IoUring&) = delete;
+
+        // false - ядро не поддерживает io_uring или системный вызов запрещён
+        bool Init(unsigned entries) {
+            io_uring_params params;
+            memset(&params, 0, sizeof(params));
+            ringFd = static_cast<int>(syscall(__NR_io_uring_setup, entries, &params));
+            if (ringFd < 0) return false;
+            sqRingSize = params.sq_off.array+params.sq_entries*sizeof(unsigned);
+            cqRingSize = params.cq_off.cqes+params.cq_entries*sizeof(io_uring_cqe);
+            bool single = params.features & IORING_FEAT_SINGLE_MMAP;
+            if (single) sqRingSize = cqRingSize = max(sqRingSize, cqRingSize);
+            sqRing = mmap(nullptr, sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_SQ_RING);
+            if (sqRing == MAP_FAILED) return false;
+            cqRing = single ? sqRing : mmap(nullptr, cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_CQ_RING);
+            if (cqRing == MAP_FAILED) return false;
+            sqesSize = params.sq_entries*sizeof(io_uring_sqe);
+            void *entriesAddress = mmap(nullptr, sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_SQES);
+            if (entriesAddress == MAP_FAILED) return false;
+            sqes = static_cast<io_uring_sqe*>(entriesAddress);
+            sqTail = Field(sqRing, params.sq_off.tail);
+            sqMask = Field(sqRing, params.sq_off.ring_mask);
+            sqArray = Field(sqRing, params.sq_off.array);
+            cqHead = Field(cqRing, params.cq_off.head);
+            cqTail = Field(cqRing, params.cq_off.tail);
+            cqMask = Field(cqRing, params.cq_off.ring_mask);
+            cqes = reinterpret_cast<io_uring_cqe*>(static_cast<char*>(cqRing)+params.cq_off.cqes);
+            return true;
+        }
+
+        // Запись iov в fd по смещению offset; tag возвращается в завершении
+        void SubmitWrite(int fd, const iovec *iov, uint64_t offset, uint64_t tag) {
+            unsigned tail = *sqTail;
+            unsigned index = tail & *sqMask;
+            io_uring_sqe &entry = sqes[index];
+            memset(&entry, 0, sizeof(entry));
+            entry.opcode = IORING_OP_WRITEV;
+            entry.fd = fd;
+            entry.addr = reinterpret_cast<uint64_t>(iov);
+            entry.len = 1;
+            entry.off = offset;
+            entry.user_data = tag;
+            sqArray[index] = index;
+            __atomic_store_n(sqTail, tail+1, __ATOMIC_RELEASE);
+            if (Enter(1, 0, 0) < 0) throw runtime_error("Ошибка отправки запроса io_uring: " + string(strerror(errno)));
+        }
+
+        // Очередное завершение; при wait ожидает его появления
+        bool Reap(bool wait, uint64_t &tag, int &result) {
+            unsigned head = *cqHead;
+            while (head == __atomic_load_n(cqTail, __ATOMIC_ACQUIRE)) {
+                if (!wait) return false;
+                if (Enter(0, 1, IORING_ENTER_GETEVENTS) < 0) throw runtime_error("Ошибка ожидания io_uring: " + string(strerror(errno)));
+            }
+            const io_uring_cqe &entry = cqes[head & *cqMask];
+            tag = entry.user_data;
+            result = entry.res;
+            __atomic_store_n(cqHead, head+1, __ATOMIC_RELEASE);
+            return true;
+        }
+};
+#endif
+
+
+// Отложенная запись в файл: буферы пишутся асинхронно (io_uring или pwrite в общем пуле),
+// вызывающий поток блокируется только когда заняты все maxInFlight буферов
+class AsyncFileWriter {
+    private:
+        struct Slot {
+            string data;
+            uint64_t offset = 0;
+            size_t written = 0;
+#ifndef _WIN32
+            iovec chunk;
+#endif
+        };
+        vector<Slot> slots;
+        vector<size_t> freeSlots;
+        size_t maxInFlight;
+        uint64_t offset;
+        string failure;
+        mutex lock;
+        condition_variable completed;
+#ifdef _WIN32
+        HANDLE file;
+#else
+        int fd;
+#endif
+#ifdef FILEIO_HAS_IO_URING
+        unique_ptr<IoUring> ring;
+
+        void SubmitSlot(size_t index) {
+            Slot &slot = slots[index];
+            slot.chunk.iov_base = &slot.data[slot.written];
+            slot.chunk.iov_len = slot.data.size()-slot.written;
+            ring->SubmitWrite(fd, &slot.chunk, slot.offset+slot.written, index);
+        }
+
+        // Разбор одного завершения; недописанный остаток отправляется повторно
+        bool ReapOne(bool wait) {
+            uint64_t tag;
+            int result;
+            if (!ring->Reap(wait, tag, result)) return false;
+            Slot &slot = slots[tag];
+            if (result <= 0) {
+                if (failure.empty()) failure = result < 0 ? strerror(-result) : "запись не выполнена";
+            } else if (slot.written+result < slot.data.size()) {
+                slot.written += result;
+                SubmitSlot(tag);
+                return true;
+            }
+            slot.data.clear();
+            freeSlots.push_back(tag);
+            return true;
+        }
+#endif
+
+        // Синхронная позиционная запись для пула потоков
+        string WriteAt(const string &data, uint64_t position) {
+            size_t done = 0;
+            while (done < data.size()) {
+#ifdef _WIN32
+                OVERLAPPED place;
+                memset(&place, 0, sizeof(place));
+                place.Offset = static_cast<DWORD>(position+done);
+                place.OffsetHigh = static_cast<DWORD>((position+done) >> 32);
+                DWORD count = 0;
+                DWORD portion = static_cast<DWORD>(min<size_t>(data.size()-done, 1u << 30));
+                if (!WriteFile(file, data.data()+done, portion, &count, &place)) return "ошибка WriteFile";
+#else
+                ssize_t count = pwrite(fd, data.data()+done, data.size()-done, static_cast<off_t>(position+done));
+                if (count < 0 && errno == EINTR) continue;
+                if (count <= 0) return count < 0 ? strerror(errno) : "запись не выполнена";
+#endif
+                done += count;
+            }
+            return "";
+        }
+
+        // Как и ParallelFor, ожидающий поток помогает пулу, чтобы не заблокировать его из задачи.
+        // Когда в пуле не осталось задач, все отправленные записи уже выполняются, и ждать можно без опроса
+        template <typename Predicate>
+        void WaitCompleted(unique_lock<mutex> &guard, Predicate ready) {
+            ThreadPool &pool = GetSharedThreadPool();
+            while (!ready()) {
+                guard.unlock();
+                bool helped = pool.RunPending();
+                guard.lock();
+                if (!helped) completed.wait(guard, ready);
+            }
+        }
+
+        size_t AcquireSlot() {
+#ifdef FILEIO_HAS_IO_URING
+            if (ring) {
+                while (freeSlots.empty()) ReapOne(true);
+                size_t index = freeSlots.back();
+                freeSlots.pop_back();
+                return index;
+            }
+#endif
+            unique_lock<mutex> guard(lock);
+            WaitCompleted(guard, [this]() { return !freeSlots.empty(); });
+            size_t index = freeSlots.back();
+            freeSlots.pop_back();
+            return index;
+        }
+
+        void ThrowIfFailed() {
+            lock_guard<mutex> guard(lock);
+            if (!failure.empty()) {
+                string message = failure;
+                failure.clear();
+                throw runtime_error("Ошибка асинхронной записи: " + message);
+            }
+        }
+    public:
+        static constexpr size_t DEFAULT_IN_FLIGHT = 8;
+
+        // Конструкторы
+        AsyncFileWriter(): maxInFlight(0), offset(0),
+#ifdef _WIN32
+            file(INVALID_HANDLE_VALUE) {}
+#else
+            fd(-1) {}
+#endif
+
+        // useRing = false принудительно включает запасной путь через пул потоков
+        AsyncFileWriter(const string &filename, size_t inFlight = DEFAULT_IN_FLIGHT, bool useRing = true): AsyncFileWriter() {
+            Open(filename, inFlight, useRing);
+        }
+
+        ~AsyncFileWriter() { try { Close(); } catch (...) {} }
+
+        AsyncFileWriter(const AsyncFileWriter&) = delete;
+        AsyncFileWriter& operator=(const AsyncFileWriter&) = delete;
+
+        // Декомпозиция
+        bool IsOpen() const {
+#ifdef _WIN32
+            return file != INVALID_HANDLE_VALUE;
+#else
+            return fd >= 0;
+#endif
+        }
+
+        bool IsUsingRing() const {
+#ifdef FILEIO_HAS_IO_URING
+            return static_cast<bool>(ring);
+#else
+            return false;
+#endif
+        }
+
+        size_t GetMaxInFlight() const { return maxInFlight; }
+
+        uint64_t GetBytesSubmitted() const { return offset; }
+
+        // Операции
+        void Open(const string &filename, size_t inFlight = DEFAULT_IN_FLIGHT, bool useRing = true) {
+            Close();
+            if (inFlight == 0) throw invalid_argument("Число буферов в полёте должно быть положительным!");
+#ifdef _WIN32
+            (void)useRing;
+            file = CreateFileA(filename.c_str(), GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+            if (file == INVALID_HANDLE_VALUE) throw runtime_error("Невозможно открыть файл: " + filename);
+#else
+            fd = ::open(filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+            if (fd < 0) throw runtime_error("Невозможно открыть файл: " + filename);
+#ifdef FILEIO_HAS_IO_URING
+            if (useRing) {
+                ring = make_unique<IoUring>();
+                if (!ring->Init(static_cast<unsigned>(inFlight))) ring.reset();
+            }
+#else
+            (void)useRing;
+#endif
+#endif
+            maxInFlight = inFlight;
+            offset = 0;
+            failure.clear();
+            slots = vector<Slot>(inFlight);
+            freeSlots.clear();
+            for (size_t i = inFlight; i > 0; i--) freeSlots.push_back(i-1);
+        }
+
+        // Буфер переходит во владение записи; возврат сразу после постановки в очередь
+        void Write(string &&buffer) {
+            if (!IsOpen()) throw runtime_error("Файл не открыт!");
+            ThrowIfFailed();
+            if (buffer.empty()) return;
+            size_t index = AcquireSlot();
+            Slot &slot = slots[index];
+            slot.data = move(buffer);
+            slot.offset = offset;
+            slot.written = 0;
+            offset += slot.data.size();
+#ifdef FILEIO_HAS_IO_URING
+            if (ring) {
+                SubmitSlot(index);
+                while (ReapOne(false)) {}
+                return;
+            }
+#endif
+            GetSharedThreadPool().Submit([this, index]() {
+                Slot &task = slots[index];
+                string error = WriteAt(task.data, task.offset);
+                task.data.clear();
+                // Сигнал под мьютексом: иначе Flush может вернуться и писатель будет разрушен до notify_all
+                lock_guard<mutex> guard(lock);
+                if (!error.empty() && failure.empty()) failure = error;
+                freeSlots.push_back(index);
+                completed.notify_all();
+            });
+        }
+
+        // Ожидание завершения всех отправленных буферов
+        void Flush() {
+            if (!IsOpen()) return;
+#ifdef FILEIO_HAS_IO_URING
+            if (ring) {
+                while (freeSlots.size() < maxInFlight) ReapOne(true);
+                ThrowIfFailed();
+                return;
+            }
+#endif
+            unique_lock<mutex> guard(lock);
+            WaitCompleted(guard, [this]() { return freeSlots.size() == maxInFlight; });
+            guard.unlock();
+            ThrowIfFailed();
+        }
+
+        void Close() {
+            if (!IsOpen()) return;
+            string error;
+            try {
+                Flush();
+            } catch (const exception &e) {
+                error = e.what();
+            }
+#ifdef FILEIO_HAS_IO_URING
+            ring.reset();
+#endif
+#ifdef _WIN32
+            CloseHandle(file);
+            file = INVALID_HANDLE_VALUE;
+#else
+            ::close(fd);
+            fd = -1;
+#endif
+            if (!error.empty()) throw runtime_error(error);
+        }
+};
+
+#endif // FILEIO_HPP
@@ -3,8 +3,25 @@
 
 #include <memory>
 #include <functional>
+#include <fstream>
+#include <cstring>
+#include <cstdint>
+#include <algorithm>
+#include <stdexcept>
+#include <type_traits>
+#include <tuple>
+#include <deque>
+#include <vector>
+#include <utility>
+#include "FileIO.hpp"
+#include "Parallel.hpp"
 #include "sequences/Sequence.hpp"
 #include "sequences/DynamicArray.hpp"
+#include "sequences/DeltaIndex.hpp"
+#include "sequences/LoserTree.hpp"
+#include "sequences/Selection.hpp"
+#include "sequences/HashTable.hpp"
+#include "sequences/ArraySequence.hpp"
 using namespace std;
 
 
@@ -14,10 +31,13 @@ class Generator {
     private:
         function<T()> next;
         function<bool()> hasNext;
+        function<string()> saveState;
+        function<void(const string&)> loadState;
         
     public:
-        Generator(function<T()> func, function<bool()> flag = [](){ return true; }):
-            next(func), hasNext(flag) {}
+        Generator(function<T()> func, function<bool()> flag = [](){ return true; },
+                  function<string()> save = nullptr, function<void(const string&)> load = nullptr):
+            next(func), hasNext(flag), saveState(save), loadState(load) {}
 
         T GetNext() {
             return next();
@@ -34,6 +54,155 @@ class Generator {
             }
             return false;
         }
+
+        // Контрольные точки
+        bool IsCheckpointable() const {
+            return saveState && loadState;
+        }
+
+        string SaveState() const {
+            if (!saveState) throw runtime_error("Генератор не поддерживает контрольные точки!");
+            return saveState();
+        }
+
+        void LoadState(const string &state) {
+            if (!loadState) throw runtime_error("Генератор не поддерживает контрольные точки!");
+            loadState(state);
+        }
+};
+
+
+// Общий генератор копий последовательности: каждая копия читает его со своей позиции.
+// Элемент, выданный генератором одной копии, хранится, пока его не прочитают все отстающие копии,
+// но не больше MAX_BUFFER элементов: копия, отставшая сильнее, отключается от генератора и при
+// следующем чтении сообщает об ошибке. Так производная последовательность, прочитавшая генератор
+// далеко вперёд, не удерживает в памяти всё, что не прочитал её источник
+template <class T>
+class GeneratorTape {
+    private:
+        shared_ptr<Generator<T>> generator;
+        deque<T> buffer;
+        size_t start;
+        size_t produced;
+        vector<size_t> positions;
+
+        bool IsActive(size_t position) const { return position != FREE && position != EVICTED; }
+
+        // Освобождение элементов, которые уже прочитаны всеми копиями
+        void Trim() {
+            size_t lowest = produced;
+            for (size_t position : positions) {
+                if (IsActive(position)) lowest = min(lowest, position);
+            }
+            while (start < lowest && !buffer.empty()) {
+                buffer.pop_front();
+                start++;
+            }
+            if (buffer.empty()) start = max(start, lowest);
+        }
+
+        // Есть копия, которой ещё нужен последний выданный элемент
+        bool IsBehind() const {
+            for (size_t position : positions) {
+                if (IsActive(position) && position < produced) return true;
+            }
+            return false;
+        }
+
+        // Отключение самых отстающих копий, пока в буфере не освободится место
+        void Evict() {
+            while (buffer.size() >= MAX_BUFFER) {
+                for (size_t &position : positions) {
+                    if (position == start) position = EVICTED;
+                }
+                Trim();
+            }
+        }
+
+    public:
+        static constexpr size_t FREE = SIZE_MAX;
+        static constexpr size_t EVICTED = SIZE_MAX-1;
+        static constexpr size_t MAX_BUFFER = 10000;
+
+        // position - номер элемента, который генератор выдаст следующим
+        GeneratorTape(shared_ptr<Generator<T>> gen, size_t position): generator(gen), start(position), produced(position) {}
+
+        GeneratorTape(const GeneratorTape&) = delete;
+        GeneratorTape& operator=(const GeneratorTape&) = delete;
+
+        // Декомпозиция
+        size_t GetPosition(size_t reader) const { return positions[reader]; }
+
+        size_t GetReaderCount() const {
+            return static_cast<size_t>(count_if(positions.begin(), positions.end(), [this](size_t position) { return IsActive(position); }));
+        }
+
+        // Генератор находится ровно на позиции читателя (его состояние относится к этой позиции)
+        bool IsLeading(size_t reader) const { return positions[reader] == produced; }
+
+        bool IsEvicted(size_t reader) const { return positions[reader] == EVICTED; }
+
+        size_t GetBufferedCount() const { return buffer.size(); }
+
+        void Check(size_t reader) const {
+            if (positions[reader] == EVICTED) {
+                throw runtime_error("Элементы генератора для этой позиции уже освобождены: другая копия прочитала его слишком далеко вперёд!");
+            }
+        }
+
+        // Операции
+        // Копия отключённого читателя тоже отключена
+        size_t Register(size_t position) {
+            if (position != EVICTED && (position < start || position > produced)) throw runtime_error("Элементы генератора для этой позиции уже освобождены!");
+            for (size_t reader = 0; reader < positions.size(); reader++) {
+                if (positions[reader] == FREE) {
+                    positions[reader] = position;
+                    return reader;
+                }
+            }
+            positions.push_back(position);
+            return positions.size()-1;
+        }
+
+        void Unregister(size_t reader) {
+            positions[reader] = FREE;
+            Trim();
+        }
+
+        bool HasNext(size_t reader) const {
+            Check(reader);
+            return positions[reader] < produced || generator->HasNext();
+        }
+
+        T Next(size_t reader) {
+            Check(reader);
+            size_t position = positions[reader];
+            if (position < produced) {
+                T value = buffer[position-start];
+                positions[reader]++;
+                if (position == start) Trim();
+                return value;
+            }
+            T value = generator->GetNext();
+            produced++;
+            positions[reader]++;
+            if (IsBehind()) Evict();
+            if (IsBehind()) {
+                buffer.push_back(value);
+            } else {
+                buffer.clear();
+                start = produced;
+            }
+            return value;
+        }
+
+        // Генератор перезапущен с позиции position: допустимо, только если других читателей нет
+        void Restart(size_t reader, size_t position) {
+            if (GetReaderCount() > 1) throw runtime_error("Генератор используется другими копиями последовательности!");
+            buffer.clear();
+            start = produced = position;
+            positions[reader] = position;
+        }
 };
 
 
@@ -41,21 +210,35 @@ class Generator {
 class Cardinal {
     private:
         enum class Type { Finite, Infinite, Unknown };
+        static constexpr size_t UNBOUNDED = SIZE_MAX;
         Type type;
         size_t finite_value;
+        size_t lower_bound;
+        size_t upper_bound;
+
+        static size_t SaturatingAdd(size_t a, size_t b) {
+            return (a > UNBOUNDED-b) ? UNBOUNDED : a+b;
+        }
+
+        static size_t SaturatingSub(size_t a, size_t b) {
+            return (a > b) ? a-b : 0;
+        }
     public:
-        Cardinal(): type(Type::Unknown), finite_value(0) {}
+        Cardinal(): type(Type::Unknown), finite_value(0), lower_bound(0), upper_bound(UNBOUNDED) {}
 
         static Cardinal Finite(size_t value) {
             Cardinal c;
             c.type = Type::Finite;
             c.finite_value = value;
+            c.lower_bound = value;
+            c.upper_bound = value;
             return c;
         }
 
         static Cardinal Infinite() {
             Cardinal c;
             c.type = Type::Infinite;
+            c.lower_bound = UNBOUNDED;
             return c;
         }
 
@@ -63,18 +246,85 @@ class Cardinal {
             return Cardinal();
         }
 
+        // Неизвестная длина в пределах [lower, upper]
+        static Cardinal Bounded(size_t lower, size_t upper) {
+            if (lower > upper) throw invalid_argument("Нижняя граница длины больше верхней!");
+            if (lower == upper) return Finite(lower);
+            Cardinal c;
+            c.lower_bound = lower;
+            c.upper_bound = upper;
+            return c;
+        }
+
+        static Cardinal AtMost(size_t upper) {
+            return Bounded(0, upper);
+        }
+
         bool IsFinite() const { return type == Type::Finite; }
+        bool IsInfinite() const { return type == Type::Infinite; }
+        bool IsUnknown() const { return type == Type::Unknown; }
 
         size_t GetFiniteValue() const {
             if (!IsFinite()) throw runtime_error("Последовательность неизвестной длины или бесконечна!");
             return finite_value;
         }
 
+        // Границы длины
+        size_t GetLowerBound() const { return lower_bound; }
+
+        bool HasUpperBound() const { return type != Type::Infinite && upper_bound != UNBOUNDED; }
+
+        size_t GetUpperBound() const {
+            if (!HasUpperBound()) throw runtime_error("Длина последовательности не ограничена сверху!");
+            return upper_bound;
+        }
+
+        // Арифметика длин
+        Cardinal operator+(const Cardinal &other) const {
+            if (IsInfinite() || other.IsInfinite()) return Infinite();
+            if (IsFinite() && other.IsFinite()) return Finite(SaturatingAdd(finite_value, other.finite_value));
+            Cardinal c;
+            c.lower_bound = SaturatingAdd(lower_bound, other.lower_bound);
+            c.upper_bound = (HasUpperBound() && other.HasUpperBound()) ? SaturatingAdd(upper_bound, other.upper_bound) : UNBOUNDED;
+            return c;
+        }
+
+        // Не более count первых элементов
+        Cardinal Clamp(size_t count) const {
+            if (IsInfinite()) return Finite(count);
+            if (IsFinite()) return Finite(min(finite_value, count));
+            return Bounded(min(lower_bound, count), min(upper_bound, count));
+        }
+
+        // Без count первых элементов
+        Cardinal Skip(size_t count) const {
+            if (IsInfinite()) return Infinite();
+            if (IsFinite()) return Finite(SaturatingSub(finite_value, count));
+            return Bounded(SaturatingSub(lower_bound, count), HasUpperBound() ? SaturatingSub(upper_bound, count) : UNBOUNDED);
+        }
+
+        // Длина поэлементного объединения: не больше меньшей из длин
+        Cardinal Min(const Cardinal &other) const {
+            if (IsInfinite()) return other;
+            if (other.IsInfinite()) return *this;
+            if (IsFinite() && other.IsFinite()) return Finite(min(finite_value, other.finite_value));
+            return Bounded(min(lower_bound, other.lower_bound), min(upper_bound, other.upper_bound));
+        }
+
+        // Результат фильтрации: не больше исходной длины
+        Cardinal Filtered() const {
+            if (IsInfinite()) return Unknown();
+            return Bounded(0, IsFinite() ? finite_value : upper_bound);
+        }
+
         bool operator==(const Cardinal &other) const {
             if (type != other.type) return false;
             if (type == Type::Finite) {
                 return finite_value == other.finite_value;
             }
+            if (type == Type::Unknown) {
+                return lower_bound == other.lower_bound && upper_bound == other.upper_bound;
+            }
             return true;
         }
         
@@ -87,68 +337,330 @@ class Cardinal {
 // Основной класс ленивой последовательности
 template <typename T>
 class LazySequence: public Sequence<T> {
+    template <typename> friend class LazySequence;
     private:
         mutable DynamicArray<T> sequence;
+        mutable size_t materialized = 0;
+        bool streaming = false;
+        mutable size_t held = SIZE_MAX;
         shared_ptr<Generator<T>> generator;
+        mutable shared_ptr<GeneratorTape<T>> tape;
+        mutable size_t reader = SIZE_MAX;
+        function<T(size_t)> indexer;
+        bool concurrentIndexer = false;
         Cardinal length;
+        static constexpr size_t MAX_CACHE_SIZE = 10000;
+
+        // Заголовок файла снимка
+        struct SnapshotHeader {
+            char magic[8];
+            uint32_t elementSize;
+            uint32_t lengthType;
+            uint64_t lowerBound;
+            uint64_t upperBound;
+            uint64_t count;
+            uint64_t stateSize;
+        };
+
+        // Расширение ёмкости кеша с удвоением
+        void Reserve(size_t capacity) const {
+            size_t current = sequence.GetSize();
+            if (capacity <= current) return;
+            size_t newCapacity = current ? current : 16;
+            while (newCapacity < capacity) newCapacity *= 2;
+            if (length.HasUpperBound()) newCapacity = min(newCapacity, max(capacity, length.GetUpperBound()));
+            sequence.Resize(newCapacity);
+        }
+
+        // Генератор читается через общую с копиями ленту; лента создаётся при первом чтении или копировании
+        GeneratorTape<T>& Tape() const {
+            if (!tape) {
+                tape = make_shared<GeneratorTape<T>>(generator, materialized);
+                reader = tape->Register(materialized);
+            }
+            return *tape;
+        }
+
+        // Номер элемента, который генератор выдаст этой копии следующим
+        size_t GetGeneratorPosition() const {
+            return tape ? tape->GetPosition(reader) : materialized;
+        }
+
+        void ReleaseTape() {
+            if (tape) tape->Unregister(reader);
+            tape = nullptr;
+            reader = SIZE_MAX;
+        }
 
         // Кеширование
         void Cache(size_t index) const {
-            if (index < sequence.GetSize()) return;
-            const size_t MAX_CACHE_SIZE = 10000;
+            if (streaming) {
+                StreamTo(index);
+                return;
+            }
+            if (index < materialized) return;
             if (length.IsFinite()) {
                 if (index >= length.GetFiniteValue()) throw out_of_range("Индекс выходит за пределы последовательности!");
-            } else if (index >= MAX_CACHE_SIZE) throw out_of_range("Запрошенный индекс слишком велик для бесконечной последовательности!");
+            } else if (length.IsInfinite() && index >= MAX_CACHE_SIZE) throw out_of_range("Запрошенный индекс слишком велик для бесконечной последовательности!");
             
-            size_t old_size = sequence.GetSize();
-            size_t new_size = index+1;
-            if (!generator) {
+            if (!generator && indexer) {
+                Reserve(index+1);
+                for (size_t i = materialized; i <= index; i++) {
+                    sequence[i] = indexer(i);
+                    materialized = i+1;
+                }
+            } else if (!generator) {
                 if (length.IsFinite() && index < length.GetFiniteValue()) {
-                    const_cast<LazySequence<T>*>(this)->sequence.Resize(new_size);
-                    for (size_t i = old_size; i < new_size; i++) sequence[i] = T();
+                    Reserve(index+1);
+                    for (size_t i = materialized; i <= index; i++) sequence[i] = T();
+                    materialized = index+1;
                     return;
                 }
                 throw runtime_error("Отсутствует генератор и невозможно создать элементы!");
             } else {
-                const_cast<LazySequence<T>*>(this)->sequence.Resize(new_size);
-                for (size_t i = old_size; i < new_size; i++) {
-                    if (!generator->HasNext()) {
+                GeneratorTape<T> &source = Tape();
+                // Курсор по этой копии уже прочитал генератор дальше кеша
+                source.Check(reader);
+                if (source.GetPosition(reader) != materialized) throw runtime_error("Генератор не поддерживает произвольный доступ!");
+                for (size_t i = materialized; i <= index; i++) {
+                    if (!source.HasNext(reader)) {
+                        if (length.IsFinite()) throw runtime_error("Генератор произвел меньше элементов, чем ожидалось!");
+                        if (length.IsInfinite()) throw runtime_error("Генератор бесконечной последовательности неожиданно завершился!");
+                        throw out_of_range("Индекс выходит за пределы последовательности!");
+                    }
+                    T value = source.Next(reader);
+                    Reserve(i+1);
+                    sequence[i] = value;
+                    materialized = i+1;
+                }
+            }
+        }
+
+        // Потоковый режим: в кеше только один элемент с номером held, materialized - позиция генератора
+        void StreamTo(size_t index) const {
+            if (index == held) return;
+            if (length.IsFinite() && index >= length.GetFiniteValue()) throw out_of_range("Индекс выходит за пределы последовательности!");
+            if (indexer && (index != materialized || !generator)) {
+                sequence[0] = indexer(index);
+            } else if (generator && index >= materialized) {
+                GeneratorTape<T> &source = Tape();
+                for (; materialized <= index; materialized++) {
+                    if (!source.HasNext(reader)) {
                         if (length.IsFinite()) throw runtime_error("Генератор произвел меньше элементов, чем ожидалось!");
-                        else throw runtime_error("Генератор бесконечной последовательности неожиданно завершился!");
+                        if (length.IsInfinite()) throw runtime_error("Генератор бесконечной последовательности неожиданно завершился!");
+                        throw out_of_range("Индекс выходит за пределы последовательности!");
                     }
-                    sequence[i] = generator->GetNext();
+                    if (materialized < index) source.Next(reader);
+                    else sequence[0] = source.Next(reader);
                 }
+            } else if (!generator && length.IsFinite()) {
+                sequence[0] = T();
+            } else {
+                throw runtime_error("Потоковая последовательность не хранит уже прочитанные элементы!");
             }
+            held = index;
         }
+
+        // Прямой доступ по индексу без кеширования (для далёких индексов)
+        bool IsDirectAccess(size_t index) const {
+            if (!indexer || index < materialized) return false;
+            if (length.IsInfinite() && index >= MAX_CACHE_SIZE) return true;
+            return index-materialized >= MAX_CACHE_SIZE;
+        }
+
+        // Произвольный доступ без последовательной генерации: индексатор или полностью вычисленный кеш
+        bool IsRandomAccess() const {
+            return indexer || (!streaming && length.IsFinite() && materialized >= length.GetFiniteValue());
+        }
+
+        bool IsConcurrentAccess() const {
+            return concurrentIndexer || (!streaming && length.IsFinite() && materialized >= length.GetFiniteValue());
+        }
+
+        // Элемент из кеша или через индексатор, без записи в кеш
+        T Peek(size_t index) const {
+            if (!streaming && index < materialized) return sequence[index];
+            if (!indexer) return Get(index);
+            if (length.IsFinite() && index >= length.GetFiniteValue()) throw out_of_range("Индекс выходит за пределы последовательности!");
+            return indexer(index);
+        }
+
+        // Длина после поэлементного преобразования границ монотонной функцией
+        static Cardinal MapBounds(const Cardinal &len, function<size_t(size_t)> func) {
+            if (len.IsInfinite()) return Cardinal::Infinite();
+            if (len.IsFinite()) return Cardinal::Finite(func(len.GetFiniteValue()));
+            return Cardinal::Bounded(func(len.GetLowerBound()), len.HasUpperBound() ? func(len.GetUpperBound()) : SIZE_MAX);
+        }
+
+        // Генератор с упреждающим чтением одного элемента через fetch
+        template <typename U>
+        static shared_ptr<Generator<U>> CreateFetchGenerator(function<bool(U&)> fetch) {
+            auto lookahead = make_shared<U>();
+            auto ready = make_shared<bool>(false);
+            auto finished = make_shared<bool>(false);
+            auto advance = [fetch, lookahead, ready, finished]() -> bool {
+                if (!(*ready) && !(*finished)) {
+                    if (fetch(*lookahead)) *ready = true;
+                    else *finished = true;
+                }
+                return *ready;
+            };
+            return make_shared<Generator<U>>(
+                [lookahead, ready, advance]() -> U {
+                    if (!advance()) throw runtime_error("Нет больше элементов!");
+                    *ready = false;
+                    return move(*lookahead);
+                },
+                advance
+            );
+        }
+
+        // Следующая строка N-арного Zip: по одному элементу из каждого курсора
+        template <typename Row, typename Cursors, size_t... I>
+        static bool NextRow(Cursors &cursors, Row &out, index_sequence<I...>) {
+            return (get<I>(cursors).Next(get<I>(out)) && ...);
+        }
+
+        // N-арное поэлементное объединение, sources - указатели на LazySequence
+        template <typename... Ts>
+        static LazySequence<tuple<Ts...>>* ZipTuple(LazySequence<Ts>*... sources) {
+            using Row = tuple<Ts...>;
+            auto new_seq = new LazySequence<Row>();
+            auto copies = make_tuple(make_shared<LazySequence<Ts>>(*sources)...);
+            Cardinal len = Cardinal::Infinite();
+            ((len = len.Min(sources->length)), ...);
+            new_seq->length = len;
+            if ((sources->IsRandomAccess() && ...)) {
+                new_seq->indexer = [copies](size_t index) -> Row {
+                    return apply([index](const auto&... seq) { return Row{seq->Peek(index)...}; }, copies);
+                };
+                new_seq->concurrentIndexer = (sources->IsConcurrentAccess() && ...);
+                return new_seq;
+            }
+            using Cursors = tuple<typename LazySequence<Ts>::Cursor...>;
+            auto cursors = make_shared<Cursors>(apply([](const auto&... seq) { return Cursors{typename LazySequence<Ts>::Cursor(seq)...}; }, copies));
+            new_seq->generator = LazySequence<Row>::template CreateFetchGenerator<Row>([cursors](Row &out) -> bool {
+                return NextRow(*cursors, out, index_sequence_for<Ts...>());
+            });
+            return new_seq;
+        }
+
+        // Кольцевой буфер скользящего окна
+        struct RingWindow {
+            DynamicArray<T> items;
+            size_t head = 0;
+            bool started = false;
+            RingWindow(size_t size): items(size) {}
+        };
     public:
+        // Последовательное чтение копии: новые элементы генератора не запоминаются, курсор продвигает
+        // позицию копии в общем генераторе, поэтому другие копии и исходная последовательность не меняются
+        class Cursor {
+            private:
+                shared_ptr<LazySequence<T>> source;
+                size_t position;
+            public:
+                Cursor(shared_ptr<LazySequence<T>> seq): source(seq), position(0) {}
+
+                size_t GetPosition() const { return position; }
+
+                bool Next(T &out) {
+                    const Cardinal &len = source->length;
+                    if (len.IsFinite() && position >= len.GetFiniteValue()) return false;
+                    // Потоковый источник сам выбирает между генератором и индексатором
+                    if (source->streaming) {
+                        try {
+                            out = source->Get(position);
+                        } catch (const out_of_range&) {
+                            if (len.IsUnknown()) return false;
+                            throw;
+                        }
+                        position++;
+                        return true;
+                    }
+                    if (position < source->materialized) {
+                        out = source->sequence[position++];
+                        return true;
+                    }
+                    // Генератор дешевле индексатора, пока чтение идёт подряд
+                    if (source->generator && position == source->GetGeneratorPosition()) {
+                        GeneratorTape<T> &tape = source->Tape();
+                        if (!tape.HasNext(source->reader)) {
+                            if (len.IsFinite()) throw runtime_error("Генератор произвел меньше элементов, чем ожидалось!");
+                            if (len.IsInfinite()) throw runtime_error("Генератор бесконечной последовательности неожиданно завершился!");
+                            return false;
+                        }
+                        out = tape.Next(source->reader);
+                    } else if (source->indexer) {
+                        try {
+                            out = source->indexer(position);
+                        } catch (const out_of_range&) {
+                            if (len.IsUnknown()) return false;
+                            throw;
+                        }
+                    } else if (source->generator) {
+                        source->Tape().Check(source->reader);
+                        throw runtime_error("Генератор не поддерживает произвольный доступ!");
+                    } else if (len.IsFinite()) {
+                        out = T();
+                    } else {
+                        throw runtime_error("Отсутствует генератор и невозможно создать элементы!");
+                    }
+                    position++;
+                    return true;
+                }
+
+                // Пропуск count элементов: O(1) для кеша и индексатора
+                void Advance(size_t count) {
+                    const Cardinal &len = source->length;
+                    size_t target = (position > SIZE_MAX-count) ? SIZE_MAX : position+count;
+                    if (len.IsFinite()) target = min(target, len.GetFiniteValue());
+                    if (source->indexer || target <= source->materialized) {
+                        position = target;
+                        return;
+                    }
+                    position = max(position, source->materialized);
+                    T skipped;
+                    while (position < target && Next(skipped)) {}
+                }
+        };
+
         // Конструкторы
-        ~LazySequence() override = default;
+        ~LazySequence() override { ReleaseTape(); }
 
         LazySequence(): length(Cardinal::Finite(0)) {}
 
-        LazySequence(T *items, size_t count): sequence(items, count), length(Cardinal::Finite(count)) {}
+        LazySequence(T *items, size_t count): sequence(items, count), materialized(count), length(Cardinal::Finite(count)) {}
 
-        LazySequence(const DynamicArray<T> &arr): sequence(arr), length(Cardinal::Finite(arr.GetSize())) {}
+        LazySequence(const DynamicArray<T> &arr): sequence(arr), materialized(arr.GetSize()), length(Cardinal::Finite(arr.GetSize())) {}
 
-        LazySequence(shared_ptr<DynamicArray<T>> arr): sequence(*arr), length(Cardinal::Finite(arr->GetSize())) {}
+        LazySequence(shared_ptr<DynamicArray<T>> arr): sequence(*arr), materialized(arr->GetSize()), length(Cardinal::Finite(arr->GetSize())) {}
 
-        LazySequence(const Sequence<T> &seq): sequence(seq.GetLength()), length(Cardinal::Finite(seq.GetLength())) {
+        LazySequence(const Sequence<T> &seq): sequence(seq.GetLength()), materialized(seq.GetLength()), length(Cardinal::Finite(seq.GetLength())) {
             for (size_t i = 0; i < seq.GetLength(); i++) sequence[i] = seq.Get(i);
         }
 
-        LazySequence(shared_ptr<Sequence<T>> seq): sequence(seq->GetLength()), length(Cardinal::Finite(seq->GetLength())) {
+        LazySequence(shared_ptr<Sequence<T>> seq): sequence(seq->GetLength()), materialized(seq->GetLength()), length(Cardinal::Finite(seq->GetLength())) {
             for (size_t i = 0; i < seq->GetLength(); i++) sequence[i] = seq->Get(i);
         }
 
-        LazySequence(Sequence<T> *seq): sequence(seq->GetLength()), length(Cardinal::Finite(seq->GetLength())) {
+        LazySequence(Sequence<T> *seq): sequence(seq->GetLength()), materialized(seq->GetLength()), length(Cardinal::Finite(seq->GetLength())) {
             for (size_t i = 0; i < seq->GetLength(); i++) sequence[i] = seq->Get(i);
         }
 
-        LazySequence(function<T(DynamicArray<T>*)> func, Sequence<T> *seq): sequence(seq->GetLength()), length(Cardinal::Infinite()) {
+        LazySequence(function<T(DynamicArray<T>*)> func, Sequence<T> *seq):
+            sequence(seq->GetLength()), materialized(seq->GetLength()), length(Cardinal::Infinite()) {
             for (size_t i = 0; i < seq->GetLength(); i++) sequence[i] = seq->Get(i);
+            // Генератор хранит собственную историю: func получает все предыдущие элементы, ёмкость растёт удвоением
+            auto history = make_shared<DynamicArray<T>>(sequence);
             generator = make_shared<Generator<T>>(
-                [this, func]() {
-                    return func(&sequence);
+                [history, func]() {
+                    T value = func(history.get());
+                    size_t count = history->GetSize();
+                    if (count == history->GetCapacity()) history->Reserve(count ? 2*count : 16);
+                    history->Resize(count+1);
+                    (*history)[count] = value;
+                    return value;
                 },
                 []() { return true; }
             );
@@ -156,9 +668,31 @@ class LazySequence: public Sequence<T> {
 
         LazySequence(shared_ptr<Generator<T>> gen, Cardinal len = Cardinal::Infinite()): sequence(0), generator(gen), length(len) {}
 
-        LazySequence(const LazySequence<T> &other): sequence(other.sequence), generator(other.generator), length(other.length) {}
+        // Источник с независимым вычислением i-го элемента (func должна быть потокобезопасной)
+        LazySequence(function<T(size_t)> func, Cardinal len = Cardinal::Infinite()):
+            sequence(0), indexer(func), concurrentIndexer(true), length(len) {}
+
+        LazySequence(shared_ptr<Generator<T>> gen, function<T(size_t)> func, Cardinal len = Cardinal::Infinite()):
+            sequence(0), generator(gen), indexer(func), concurrentIndexer(true), length(len) {}
 
-        LazySequence(LazySequence<T> &&other) noexcept: sequence(move(other.sequence)), generator(move(other.generator)), length(move(other.length)) {}
+        // Копия читает общий генератор со своей позиции
+        LazySequence(const LazySequence<T> &other):
+            sequence(other.sequence), materialized(other.materialized), streaming(other.streaming), held(other.held),
+            generator(other.generator), indexer(other.indexer), concurrentIndexer(other.concurrentIndexer), length(other.length) {
+            if (generator) {
+                other.Tape();
+                tape = other.tape;
+                reader = tape->Register(other.GetGeneratorPosition());
+            }
+        }
+
+        LazySequence(LazySequence<T> &&other) noexcept:
+            sequence(move(other.sequence)), materialized(other.materialized), streaming(other.streaming), held(other.held),
+            generator(move(other.generator)), tape(move(other.tape)), reader(other.reader), indexer(move(other.indexer)),
+            concurrentIndexer(other.concurrentIndexer), length(move(other.length)) {
+            other.tape = nullptr;
+            other.reader = SIZE_MAX;
+        }
 
         // Декомпозиция
         size_t GetLength() const override {
@@ -168,24 +702,105 @@ class LazySequence: public Sequence<T> {
 
         T Get(size_t index) const override {
             if (length.IsFinite() && length.GetFiniteValue() == 0 && index == 0) throw out_of_range("Последовательность пуста!");
+            if (IsDirectAccess(index)) {
+                if (length.IsFinite() && index >= length.GetFiniteValue()) throw out_of_range("Индекс выходит за пределы последовательности!");
+                return indexer(index);
+            }
             Cache(index);
-            return sequence.Get(index);
+            return sequence[streaming ? 0 : index];
         }
 
         T GetFirst() const override {
             if (length.IsFinite() && length.GetFiniteValue() == 0) throw out_of_range("Последовательность пуста!");
-            Cache(0);
-            return sequence.Get(0);
+            return Get(0);
         }
 
         T GetLast() const override {
             if (!length.IsFinite()) throw runtime_error("Последовательность неизвестной длины или бесконечна!");
-            Cache(length.GetFiniteValue()-1);
-            return sequence.Get(length.GetFiniteValue()-1);
+            return Get(length.GetFiniteValue()-1);
+        }
+
+        Cardinal GetCardinal() const {
+            return length;
+        }
+
+        bool IsIndexAddressable() const {
+            return static_cast<bool>(indexer);
         }
 
         size_t GetMaterializedCount() const {
-            return sequence.GetSize();
+            return materialized;
+        }
+
+        bool IsStreaming() const {
+            return streaming;
+        }
+
+        // Элементы общего генератора, которые хранятся для отстающих копий этой последовательности
+        size_t GetBufferedCount() const {
+            return tape ? tape->GetBufferedCount() : 0;
+        }
+
+        // Снимок состояния
+        void SaveSnapshot(const string &filename) const {
+            static_assert(is_trivially_copyable<T>::value, "Снимок поддерживается только для тривиально копируемых типов!");
+            if (streaming) throw runtime_error("Потоковая последовательность не хранит элементы для снимка!");
+            size_t count = materialized;
+            bool complete = length.IsFinite() && count >= length.GetFiniteValue();
+            string state;
+            if (generator && !complete) {
+                if (!generator->IsCheckpointable()) throw runtime_error("Генератор не поддерживает контрольные точки!");
+                if (tape && (GetGeneratorPosition() != materialized || !tape->IsLeading(reader))) {
+                    throw runtime_error("Состояние генератора не соответствует вычисленным элементам!");
+                }
+                state = generator->SaveState();
+            }
+            SnapshotHeader header;
+            memcpy(header.magic, "LZSNAP2", 8);
+            header.elementSize = sizeof(T);
+            header.lengthType = length.IsFinite() ? 0 : (length.IsInfinite() ? 1 : 2);
+            header.lowerBound = length.GetLowerBound();
+            header.upperBound = length.HasUpperBound() ? length.GetUpperBound() : SIZE_MAX;
+            header.count = count;
+            header.stateSize = state.size();
+            ofstream file(filename, ios::binary | ios::trunc);
+            if (!file.is_open()) throw runtime_error("Невозможно открыть файл: " + filename);
+            file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+            if (count) file.write(reinterpret_cast<const char*>(&sequence[0]), count*sizeof(T));
+            file.write(state.data(), state.size());
+            if (!file.good()) throw runtime_error("Ошибка записи в файл");
+        }
+
+        static shared_ptr<LazySequence<T>> LoadSnapshot(const string &filename, shared_ptr<Generator<T>> gen = nullptr) {
+            static_assert(is_trivially_copyable<T>::value, "Снимок поддерживается только для тривиально копируемых типов!");
+            MappedFile file(filename);
+            SnapshotHeader header;
+            if (file.GetSize() < sizeof(header)) throw runtime_error("Повреждённый файл снимка: " + filename);
+            memcpy(&header, file.GetData(), sizeof(header));
+            if (memcmp(header.magic, "LZSNAP2", 8) != 0 || header.elementSize != sizeof(T)) {
+                throw runtime_error("Несовместимый файл снимка: " + filename);
+            }
+            // Размеры из заголовка сравниваются с остатком файла по частям: их сумма может переполниться
+            uint64_t payload = file.GetSize()-sizeof(header);
+            if (header.count > payload/sizeof(T) || header.stateSize != payload-header.count*sizeof(T) || header.lengthType > 2 ||
+                (header.lengthType == 0 && header.count > header.lowerBound) ||
+                (header.lengthType == 2 && (header.lowerBound > header.upperBound || header.count > header.upperBound))) {
+                throw runtime_error("Повреждённый файл снимка: " + filename);
+            }
+            auto result = make_shared<LazySequence<T>>();
+            if (header.lengthType == 0) result->length = Cardinal::Finite(header.lowerBound);
+            else if (header.lengthType == 1) result->length = Cardinal::Infinite();
+            else result->length = Cardinal::Bounded(header.lowerBound, header.upperBound);
+            const char *items = file.GetData()+sizeof(header);
+            result->sequence = DynamicArray<T>(header.count);
+            if (header.count) memcpy(&result->sequence[0], items, header.count*sizeof(T));
+            result->materialized = header.count;
+            if (header.stateSize) {
+                if (!gen) throw runtime_error("Для продолжения снимка требуется генератор!");
+                gen->LoadState(string(items+header.count*sizeof(T), header.stateSize));
+            }
+            result->generator = gen;
+            return result;
         }
 
         // Перегрузка операторов
@@ -195,20 +810,102 @@ class LazySequence: public Sequence<T> {
 
         const T& operator[](size_t index) const override {
             Cache(index);
-            if (index < sequence.GetSize()) return sequence[index];
+            if (streaming) return sequence[0];
+            if (index < materialized) return sequence[index];
             throw out_of_range("Индекс за пределами последовательности");
         }
 
         LazySequence& operator=(LazySequence<T> &&other) noexcept {
             if (this != &other) {
                 sequence = move(other.sequence);
+                materialized = other.materialized;
+                streaming = other.streaming;
+                held = other.held;
+                ReleaseTape();
                 generator = move(other.generator);
+                tape = move(other.tape);
+                reader = other.reader;
+                other.tape = nullptr;
+                other.reader = SIZE_MAX;
+                indexer = move(other.indexer);
+                concurrentIndexer = other.concurrentIndexer;
                 length = move(other.length);
             }
             return *this;
         }
         
         // Операции
+        // Потоковый режим для однопроходных потребителей: хранится только последний прочитанный элемент,
+        // чтение назад возможно лишь через индексатор
+        void SetStreaming(bool enabled) {
+            if (enabled == streaming) return;
+            if (!enabled) {
+                if (materialized > 0 || held != SIZE_MAX) throw runtime_error("Нельзя выключить потоковый режим после начала чтения!");
+                sequence = DynamicArray<T>();
+            } else {
+                DynamicArray<T> slot(1);
+                if (materialized > 0) slot[0] = move(sequence[materialized-1]);
+                held = materialized > 0 ? materialized-1 : SIZE_MAX;
+                sequence = move(slot);
+            }
+            streaming = enabled;
+        }
+
+        // Элемент с передачей владения: в потоковом режиме ячейка освобождается без копирования
+        T Extract(size_t index) const {
+            if (!streaming) return Get(index);
+            if (IsDirectAccess(index)) return Get(index);
+            StreamTo(index);
+            held = SIZE_MAX;
+            return move(sequence[0]);
+        }
+
+        // Копирование до count элементов с позиции from в буфер: кеш дополняется одним проходом и копируется целиком.
+        // Возвращает число скопированных элементов (меньше count у конца последовательности)
+        size_t CopyTo(size_t from, T *out, size_t count) const {
+            if (count == 0) return 0;
+            if (streaming) {
+                size_t copied = 0;
+                try {
+                    for (; copied < count; copied++) out[copied] = Extract(from+copied);
+                } catch (const out_of_range&) {}
+                return copied;
+            }
+            size_t end = from+count;
+            if (length.IsFinite()) end = min(end, length.GetFiniteValue());
+            if (end <= from) return 0;
+            if (IsDirectAccess(from)) {
+                for (size_t i = from; i < end; i++) out[i-from] = indexer(i);
+                return end-from;
+            }
+            try {
+                Cache(end-1);
+            } catch (const out_of_range&) {
+                if (length.IsFinite()) throw;
+            }
+            end = min(end, materialized);
+            if (end <= from) return 0;
+            copy(&sequence[from], &sequence[from]+(end-from), out);
+            return end-from;
+        }
+
+        // Состояние генератора после GetMaterializedCount() порождённых элементов
+        string SaveGeneratorState() const {
+            if (!generator) throw runtime_error("Последовательность не имеет генератора!");
+            if (tape && !tape->IsLeading(reader)) throw runtime_error("Состояние генератора не соответствует вычисленным элементам!");
+            return generator->SaveState();
+        }
+
+        // Продолжение генерации с элемента position без пересчёта префикса; в режиме кеширования префикс должен быть вычислен
+        void ResumeGenerator(size_t position, const string &state) {
+            if (!generator) throw runtime_error("Последовательность не имеет генератора!");
+            if (!streaming && position != materialized) throw runtime_error("Продолжение с произвольной позиции возможно только в потоковом режиме!");
+            if (tape) tape->Restart(reader, position);
+            generator->LoadState(state);
+            materialized = position;
+            held = SIZE_MAX;
+        }
+
         Sequence<T>* Append(T item) override {
             if (!length.IsFinite()) throw runtime_error("Нельзя добавить элемент в конец неконечной последовательности!");
             auto new_seq = new LazySequence<T>();
@@ -265,8 +962,7 @@ class LazySequence: public Sequence<T> {
                     }
                 }
             );
-            if (length.IsFinite()) new_seq->length = Cardinal::Finite(GetLength()+1);
-            else new_seq->length = Cardinal::Infinite();
+            new_seq->length = length+Cardinal::Finite(1);
             return new_seq;
         }
 
@@ -341,7 +1037,8 @@ class LazySequence: public Sequence<T> {
             auto current_this = make_shared<size_t>(0);
             auto current_other = make_shared<size_t>(0);
             auto temp_seq_this = make_shared<LazySequence<T>>(*this);
-            auto temp_seq_other = make_shared<LazySequence<T>>(other);
+            auto other_lazy = dynamic_cast<LazySequence<T>*>(other);
+            auto temp_seq_other = other_lazy ? make_shared<LazySequence<T>>(*other_lazy) : make_shared<LazySequence<T>>(other);
             new_seq->generator = make_shared<Generator<T>>(
                 [temp_seq_this, temp_seq_other, current_this, current_other, finished]() mutable -> T {
                     if (!(*finished)) {
@@ -379,33 +1076,16 @@ class LazySequence: public Sequence<T> {
                     }
                 }
             );
-            try {
-                size_t temp_length_this = GetLength();
-                size_t temp_length_other = other->GetLength();
-                new_seq->length = Cardinal::Finite(temp_length_this+temp_length_other);
-            } catch (const runtime_error&) {
-                new_seq->length = Cardinal::Infinite();
-            }
+            new_seq->length = length+temp_seq_other->length;
             return new_seq;
         }
 
         Sequence<T>* GetSubsequence(size_t startIndex, size_t endIndex) override {
             if (startIndex > endIndex) throw out_of_range("Начальный индекс больше конечного!");
             if (length.IsFinite() && endIndex >= length.GetFiniteValue()) throw out_of_range("Индекс выходит за пределы последовательности!");
-            auto new_seq = new LazySequence<T>();
-            auto current = make_shared<size_t>(startIndex);
-            auto temp_seq = make_shared<LazySequence<T>>(*this);
-            new_seq->generator = make_shared<Generator<T>>(
-                [temp_seq, current, endIndex]() mutable -> T {
-                    if (*current > endIndex) throw runtime_error("Нет больше элементов!");
-                    T value = temp_seq->Get(*current);
-                    (*current)++;
-                    return value;
-                },
-                [current, endIndex]() mutable -> bool {
-                    return *current <= endIndex;
-                }
-            );
+            auto result = Skip(startIndex);
+            auto new_seq = result->Take(endIndex-startIndex+1);
+            delete result;
             new_seq->length = Cardinal::Finite(endIndex-startIndex+1);
             return new_seq;
         }
@@ -437,29 +1117,583 @@ class LazySequence: public Sequence<T> {
             return new_seq;
         }
 
+        // Фильтрация без ограничения числа просмотренных элементов: источник читается курсором и не запоминается.
+        // Для источника с произвольным доступом хранятся только позиции совпадений (DeltaIndex)
         LazySequence<T>* Where(function<bool(T)> func) {
             auto new_seq = new LazySequence<T>();
-            auto current = make_shared<size_t>(0);
             auto temp_seq = make_shared<LazySequence<T>>(*this);
+            auto cursor = make_shared<Cursor>(temp_seq);
+            new_seq->length = length.Filtered();
+            if (!IsRandomAccess()) {
+                new_seq->generator = CreateFetchGenerator<T>([cursor, func](T &out) -> bool {
+                    while (cursor->Next(out)) {
+                        if (func(out)) return true;
+                    }
+                    return false;
+                });
+                return new_seq;
+            }
+            auto matches = make_shared<DeltaIndex>();
+            auto exhausted = make_shared<bool>(false);
+            auto emitted = make_shared<size_t>(0);
+            // Поиск следующего совпадения с запоминанием его позиции в источнике
+            auto advance = [cursor, func, matches, exhausted]() -> bool {
+                T value;
+                while (!(*exhausted) && cursor->Next(value)) {
+                    if (func(value)) {
+                        matches->Append(cursor->GetPosition()-1);
+                        return true;
+                    }
+                }
+                *exhausted = true;
+                return false;
+            };
             new_seq->generator = make_shared<Generator<T>>(
-                [temp_seq, current]() mutable -> T {
-                    T value = temp_seq->Get(*current);
-                    (*current)++;
-                    return value;
+                [temp_seq, matches, emitted, advance]() -> T {
+                    if (*emitted >= matches->GetCount() && !advance()) throw runtime_error("Нет больше элементов!");
+                    return temp_seq->Peek(matches->Get((*emitted)++));
                 },
-                [temp_seq, func, current]() mutable -> bool {
-                    const size_t MAX_ITERATIONS = 1000;
+                [matches, emitted, advance]() -> bool {
+                    return *emitted < matches->GetCount() || advance();
+                }
+            );
+            new_seq->indexer = [temp_seq, matches, advance](size_t index) -> T {
+                while (matches->GetCount() <= index) {
+                    if (!advance()) throw out_of_range("Индекс выходит за пределы последовательности!");
+                }
+                return temp_seq->Peek(matches->Get(index));
+            };
+            return new_seq;
+        }
+
+        // Пропуск первых count элементов
+        LazySequence<T>* Skip(size_t count) {
+            auto new_seq = new LazySequence<T>();
+            auto temp_seq = make_shared<LazySequence<T>>(*this);
+            new_seq->length = length.Skip(count);
+            if (IsRandomAccess()) {
+                new_seq->indexer = [temp_seq, count](size_t index) -> T {
+                    return temp_seq->Peek(index+count);
+                };
+                new_seq->concurrentIndexer = IsConcurrentAccess();
+                return new_seq;
+            }
+            auto cursor = make_shared<Cursor>(temp_seq);
+            auto skipped = make_shared<bool>(false);
+            new_seq->generator = CreateFetchGenerator<T>([cursor, skipped, count](T &out) -> bool {
+                if (!(*skipped)) {
+                    cursor->Advance(count);
+                    *skipped = true;
+                }
+                return cursor->Next(out);
+            });
+            return new_seq;
+        }
+
+        // Не более count первых элементов
+        LazySequence<T>* Take(size_t count) {
+            auto new_seq = new LazySequence<T>();
+            auto temp_seq = make_shared<LazySequence<T>>(*this);
+            new_seq->length = length.Clamp(count);
+            if (IsRandomAccess()) {
+                new_seq->indexer = [temp_seq, count](size_t index) -> T {
+                    if (index >= count) throw out_of_range("Индекс выходит за пределы последовательности!");
+                    return temp_seq->Peek(index);
+                };
+                new_seq->concurrentIndexer = IsConcurrentAccess();
+                return new_seq;
+            }
+            auto cursor = make_shared<Cursor>(temp_seq);
+            new_seq->generator = CreateFetchGenerator<T>([cursor, count](T &out) -> bool {
+                return cursor->GetPosition() < count && cursor->Next(out);
+            });
+            return new_seq;
+        }
+
+        // Элементы до первого, не удовлетворяющего условию
+        LazySequence<T>* TakeWhile(function<bool(T)> func) {
+            auto new_seq = new LazySequence<T>();
+            auto cursor = make_shared<Cursor>(make_shared<LazySequence<T>>(*this));
+            auto stopped = make_shared<bool>(false);
+            new_seq->generator = CreateFetchGenerator<T>([cursor, stopped, func](T &out) -> bool {
+                if (*stopped) return false;
+                if (cursor->Next(out) && func(out)) return true;
+                *stopped = true;
+                return false;
+            });
+            new_seq->length = length.Filtered();
+            return new_seq;
+        }
+
+        // Разбиение на блоки по size элементов (последний блок может быть короче)
+        LazySequence<shared_ptr<DynamicArray<T>>>* Chunk(size_t size) {
+            if (size == 0) throw invalid_argument("Размер блока должен быть положительным!");
+            using Block = shared_ptr<DynamicArray<T>>;
+            auto new_seq = new LazySequence<Block>();
+            auto temp_seq = make_shared<LazySequence<T>>(*this);
+            new_seq->length = MapBounds(length, [size](size_t count) { return count/size+(count%size != 0); });
+            if (IsRandomAccess()) {
+                new_seq->indexer = [temp_seq, size](size_t index) -> Block {
+                    size_t from = index*size;
+                    size_t to = from+size;
+                    if (temp_seq->length.IsFinite()) to = min(to, temp_seq->length.GetFiniteValue());
+                    if (from >= to) throw out_of_range("Индекс выходит за пределы последовательности!");
+                    auto block = make_shared<DynamicArray<T>>(to-from);
+                    size_t filled = 0;
                     try {
-                        while (*current < MAX_ITERATIONS) {
-                            T value = temp_seq->Get(*current);
-                            if (func(value)) {
+                        for (; filled < to-from; filled++) (*block)[filled] = temp_seq->Peek(from+filled);
+                    } catch (const out_of_range&) {
+                        if (!temp_seq->length.IsUnknown() || filled == 0) throw;
+                        block->Resize(filled);
+                    }
+                    return block;
+                };
+                new_seq->concurrentIndexer = IsConcurrentAccess();
+                return new_seq;
+            }
+            auto cursor = make_shared<Cursor>(temp_seq);
+            new_seq->generator = CreateFetchGenerator<Block>([cursor, size](Block &out) -> bool {
+                auto block = make_shared<DynamicArray<T>>(size);
+                size_t filled = 0;
+                while (filled < size && cursor->Next((*block)[filled])) filled++;
+                if (filled == 0) return false;
+                if (filled < size) block->Resize(filled);
+                out = block;
+                return true;
+            });
+            return new_seq;
+        }
+
+        // Скользящее окно из size элементов со сдвигом step (только полные окна)
+        LazySequence<shared_ptr<DynamicArray<T>>>* Window(size_t size, size_t step = 1) {
+            if (size == 0 || step == 0) throw invalid_argument("Размер окна и шаг должны быть положительными!");
+            using Block = shared_ptr<DynamicArray<T>>;
+            auto new_seq = new LazySequence<Block>();
+            auto temp_seq = make_shared<LazySequence<T>>(*this);
+            new_seq->length = MapBounds(length, [size, step](size_t count) { return count < size ? 0 : (count-size)/step+1; });
+            if (IsRandomAccess()) {
+                new_seq->indexer = [temp_seq, size, step](size_t index) -> Block {
+                    size_t from = index*step;
+                    if (temp_seq->length.IsFinite() && from+size > temp_seq->length.GetFiniteValue()) {
+                        throw out_of_range("Индекс выходит за пределы последовательности!");
+                    }
+                    auto block = make_shared<DynamicArray<T>>(size);
+                    for (size_t i = 0; i < size; i++) (*block)[i] = temp_seq->Peek(from+i);
+                    return block;
+                };
+                new_seq->concurrentIndexer = IsConcurrentAccess();
+                return new_seq;
+            }
+            // Кольцевой буфер последнего окна: память O(size) независимо от длины источника
+            auto cursor = make_shared<Cursor>(temp_seq);
+            auto window = make_shared<RingWindow>(size);
+            new_seq->generator = CreateFetchGenerator<Block>([cursor, window, size, step](Block &out) -> bool {
+                size_t needed = size;
+                if (window->started) {
+                    if (step > size) cursor->Advance(step-size);
+                    needed = min(step, size);
+                }
+                window->started = true;
+                T value;
+                for (size_t i = 0; i < needed; i++) {
+                    if (!cursor->Next(value)) return false;
+                    window->items[window->head] = value;
+                    window->head = (window->head+1 == size) ? 0 : window->head+1;
+                }
+                auto block = make_shared<DynamicArray<T>>(size);
+                for (size_t i = 0; i < size; i++) {
+                    size_t position = window->head+i;
+                    (*block)[i] = window->items[position >= size ? position-size : position];
+                }
+                out = block;
+                return true;
+            });
+            return new_seq;
+        }
+
+        // Каждый элемент заменяется последовательностью, результаты склеиваются
+        template <typename U>
+        LazySequence<U>* FlatMap(function<shared_ptr<Sequence<U>>(T)> func) {
+            auto new_seq = new LazySequence<U>();
+            auto cursor = make_shared<Cursor>(make_shared<LazySequence<T>>(*this));
+            auto inner = make_shared<shared_ptr<typename LazySequence<U>::Cursor>>();
+            new_seq->generator = LazySequence<U>::template CreateFetchGenerator<U>([cursor, inner, func](U &out) -> bool {
+                while (true) {
+                    if (*inner && (*inner)->Next(out)) return true;
+                    T value;
+                    if (!cursor->Next(value)) return false;
+                    auto seq = func(value);
+                    auto lazy = dynamic_pointer_cast<LazySequence<U>>(seq);
+                    auto source = lazy ? make_shared<LazySequence<U>>(*lazy)
+                                       : make_shared<LazySequence<U>>([seq](size_t index) { return seq->Get(index); }, Cardinal::Finite(seq->GetLength()));
+                    *inner = make_shared<typename LazySequence<U>::Cursor>(source);
+                }
+            });
+            new_seq->length = (length.IsFinite() && length.GetFiniteValue() == 0) ? Cardinal::Finite(0) : Cardinal::Unknown();
+            return new_seq;
+        }
+
+        // Поэлементное объединение с преобразованием без промежуточных пар
+        template <typename U, typename R>
+        LazySequence<R>* ZipWith(LazySequence<U> *other, function<R(T, U)> func) {
+            auto new_seq = new LazySequence<R>();
+            auto first = make_shared<LazySequence<T>>(*this);
+            auto second = make_shared<LazySequence<U>>(*other);
+            new_seq->length = length.Min(other->length);
+            if (IsRandomAccess() && other->IsRandomAccess()) {
+                new_seq->indexer = [first, second, func](size_t index) -> R {
+                    return func(first->Peek(index), second->Peek(index));
+                };
+                new_seq->concurrentIndexer = IsConcurrentAccess() && other->IsConcurrentAccess();
+                return new_seq;
+            }
+            auto firstCursor = make_shared<Cursor>(first);
+            auto secondCursor = make_shared<typename LazySequence<U>::Cursor>(second);
+            new_seq->generator = LazySequence<R>::template CreateFetchGenerator<R>([firstCursor, secondCursor, func](R &out) -> bool {
+                T a;
+                U b;
+                if (!firstCursor->Next(a) || !secondCursor->Next(b)) return false;
+                out = func(a, b);
+                return true;
+            });
+            return new_seq;
+        }
+
+        template <typename U>
+        LazySequence<pair<T, U>>* Zip(LazySequence<U> *other) {
+            return ZipWith<U, pair<T, U>>(other, [](T a, U b) { return make_pair(a, b); });
+        }
+
+        template <typename U, typename V, typename... Rest>
+        LazySequence<tuple<T, U, V, Rest...>>* Zip(LazySequence<U> *second, LazySequence<V> *third, LazySequence<Rest>*... others) {
+            return ZipTuple<T, U, V, Rest...>(this, second, third, others...);
+        }
+
+        // Разделение последовательности пар: при потоковом источнике буферизуется только отставание одной стороны
+        template <typename U>
+        static pair<LazySequence<T>*, LazySequence<U>*> Unzip(LazySequence<pair<T, U>> *sequence) {
+            auto first = new LazySequence<T>();
+            auto second = new LazySequence<U>();
+            auto source = make_shared<LazySequence<pair<T, U>>>(*sequence);
+            first->length = sequence->length;
+            second->length = sequence->length;
+            if (sequence->IsRandomAccess()) {
+                bool concurrent = sequence->IsConcurrentAccess();
+                first->indexer = [source](size_t index) -> T { return source->Peek(index).first; };
+                second->indexer = [source](size_t index) -> U { return source->Peek(index).second; };
+                first->concurrentIndexer = concurrent;
+                second->concurrentIndexer = concurrent;
+                return make_pair(first, second);
+            }
+            auto cursor = make_shared<typename LazySequence<pair<T, U>>::Cursor>(source);
+            auto pendingFirst = make_shared<deque<T>>();
+            auto pendingSecond = make_shared<deque<U>>();
+            first->generator = CreateFetchGenerator<T>([cursor, pendingFirst, pendingSecond](T &out) -> bool {
+                if (pendingFirst->empty()) {
+                    pair<T, U> item;
+                    if (!cursor->Next(item)) return false;
+                    pendingSecond->push_back(move(item.second));
+                    out = move(item.first);
+                    return true;
+                }
+                out = move(pendingFirst->front());
+                pendingFirst->pop_front();
+                return true;
+            });
+            second->generator = LazySequence<U>::template CreateFetchGenerator<U>([cursor, pendingFirst, pendingSecond](U &out) -> bool {
+                if (pendingSecond->empty()) {
+                    pair<T, U> item;
+                    if (!cursor->Next(item)) return false;
+                    pendingFirst->push_back(move(item.first));
+                    out = move(item.second);
+                    return true;
+                }
+                out = move(pendingSecond->front());
+                pendingSecond->pop_front();
+                return true;
+            });
+            return make_pair(first, second);
+        }
+
+        // Слияние отсортированных последовательностей через дерево проигравших (устойчивое)
+        static LazySequence<T>* MergeSorted(const DynamicArray<LazySequence<T>*> &sources, function<bool(const T&, const T&)> less = std::less<T>()) {
+            if (sources.GetSize() == 0) throw invalid_argument("Нет последовательностей для слияния!");
+            using Tree = LoserTree<T, function<bool(const T&, const T&)>>;
+            auto new_seq = new LazySequence<T>();
+            auto cursors = make_shared<vector<Cursor>>();
+            Cardinal len = Cardinal::Finite(0);
+            for (size_t i = 0; i < sources.GetSize(); i++) {
+                cursors->emplace_back(make_shared<LazySequence<T>>(*sources[i]));
+                len = len+sources[i]->length;
+            }
+            auto tree = make_shared<Tree>(sources.GetSize(), less);
+            auto started = make_shared<bool>(false);
+            new_seq->generator = CreateFetchGenerator<T>([cursors, tree, started](T &out) -> bool {
+                if (!(*started)) {
+                    T head;
+                    for (size_t i = 0; i < cursors->size(); i++) {
+                        if ((*cursors)[i].Next(head)) tree->Set(i, move(head));
+                    }
+                    tree->Build();
+                    *started = true;
+                }
+                if (tree->IsEmpty()) return false;
+                size_t source = tree->Top();
+                out = move(tree->TopKey());
+                T next;
+                if ((*cursors)[source].Next(next)) tree->Replace(move(next));
+                else tree->Pop();
+                return true;
+            });
+            new_seq->length = len;
+            return new_seq;
+        }
+
+        // k первых элементов в порядке cmp за один проход, память O(k); источник не запоминается
+        LazySequence<T>* TopK(size_t k, function<bool(const T&, const T&)> cmp = less<T>()) const {
+            if (length.IsInfinite()) throw runtime_error("Нельзя выбрать элементы из бесконечной последовательности!");
+            TopKHeap<T, function<bool(const T&, const T&)>> heap(k, cmp);
+            Cursor cursor(make_shared<LazySequence<T>>(*this));
+            T value;
+            while (cursor.Next(value)) heap.Push(value);
+            vector<T> sorted = heap.GetSorted();
+            DynamicArray<T> items(sorted.size());
+            for (size_t i = 0; i < sorted.size(); i++) items[i] = move(sorted[i]);
+            return new LazySequence<T>(items);
+        }
+
+        // Элемент на позиции n после сортировки. Вычисленный или адресуемый по индексу источник копируется
+        // в массив и выбирается параллельным quickselect за O(length); остальные - кучей из n+1 элементов, память O(n)
+        T NthElement(size_t n, function<bool(const T&, const T&)> cmp = less<T>()) const {
+            if (length.IsFinite() && IsRandomAccess()) {
+                size_t count = length.GetFiniteValue();
+                if (n >= count) throw out_of_range("Некорректный индекс!");
+                vector<T> items(count);
+                ParallelFor(count, IsConcurrentAccess() ? GetChunkCount(count) : 1, [&](size_t, size_t from, size_t to) {
+                    for (size_t i = from; i < to; i++) items[i] = Peek(i);
+                });
+                return ArraySequence<T>::SelectNth(move(items), n, cmp);
+            }
+            auto top = unique_ptr<LazySequence<T>>(TopK(n+1, cmp));
+            if (top->GetLength() <= n) throw out_of_range("Некорректный индекс!");
+            return top->Get(n);
+        }
+
+        // Сначала k первых элементов в порядке cmp, затем остальные в исходном порядке
+        // Для источников с произвольным доступом память O(k), иначе источник запоминается для второго прохода
+        LazySequence<T>* PartialSort(size_t k, function<bool(const T&, const T&)> cmp = less<T>()) {
+            if (length.IsInfinite()) throw runtime_error("Нельзя упорядочить бесконечную последовательность!");
+            using Entry = pair<T, size_t>;
+            auto entryLess = [cmp](const Entry &a, const Entry &b) {
+                if (cmp(a.first, b.first)) return true;
+                if (cmp(b.first, a.first)) return false;
+                return a.second < b.second;
+            };
+            auto new_seq = new LazySequence<T>();
+            auto temp_seq = make_shared<LazySequence<T>>(*this);
+            // Второй проход требует истории, поэтому копия потокового источника без индексатора снова кеширует
+            if (temp_seq->streaming && !temp_seq->indexer) temp_seq->SetStreaming(false);
+            auto top = make_shared<vector<Entry>>();
+            auto selected = make_shared<vector<size_t>>();
+            auto emitted = make_shared<size_t>(0);
+            auto rest = make_shared<shared_ptr<Cursor>>();
+            new_seq->generator = CreateFetchGenerator<T>([temp_seq, k, entryLess, top, selected, emitted, rest](T &out) -> bool {
+                if (!(*rest)) {
+                    if (!temp_seq->IsRandomAccess()) {
+                        for (size_t i = temp_seq->materialized; ; i++) {
+                            try {
+                                temp_seq->Cache(i);
+                            } catch (const out_of_range&) {
+                                break;
+                            }
+                        }
+                    }
+                    TopKHeap<Entry, function<bool(const Entry&, const Entry&)>> heap(k, entryLess);
+                    Cursor cursor(temp_seq);
+                    T value;
+                    while (cursor.Next(value)) heap.Push(Entry(value, cursor.GetPosition()-1));
+                    *top = heap.GetSorted();
+                    for (const Entry &entry : *top) selected->push_back(entry.second);
+                    sort(selected->begin(), selected->end());
+                    *rest = make_shared<Cursor>(temp_seq);
+                }
+                if (*emitted < top->size()) {
+                    out = (*top)[(*emitted)++].first;
+                    return true;
+                }
+                // Второй проход: пропуск отобранных позиций
+                while ((*rest)->Next(out)) {
+                    size_t position = (*rest)->GetPosition()-1;
+                    if (!binary_search(selected->begin(), selected->end(), position)) return true;
+                }
+                return false;
+            });
+            new_seq->length = length;
+            return new_seq;
+        }
+
+        // Элементы без повторов в порядке первого появления; память O(числа различных элементов)
+        LazySequence<T>* Distinct() {
+            auto new_seq = new LazySequence<T>();
+            auto cursor = make_shared<Cursor>(make_shared<LazySequence<T>>(*this));
+            auto seen = make_shared<HashTable<T, uint8_t>>();
+            new_seq->generator = CreateFetchGenerator<T>([cursor, seen](T &out) -> bool {
+                while (cursor->Next(out)) {
+                    if (seen->Insert(out, 0).second) return true;
+                }
+                return false;
+            });
+            new_seq->length = length.Filtered();
+            return new_seq;
+        }
+
+        // Пары (ключ, свёртка элементов группы) в порядке первого появления ключа
+        // Источник читается один раз при первом обращении, память O(числа групп)
+        template <typename K, typename A>
+        LazySequence<pair<K, A>>* GroupBy(function<K(T)> key, function<A(A, T)> aggregate, A start) {
+            if (length.IsInfinite()) throw runtime_error("Нельзя сгруппировать бесконечную последовательность!");
+            using Group = pair<K, A>;
+            auto new_seq = new LazySequence<Group>();
+            auto cursor = make_shared<Cursor>(make_shared<LazySequence<T>>(*this));
+            auto groups = make_shared<HashTable<K, A>>();
+            auto emitted = make_shared<size_t>(0);
+            auto built = make_shared<bool>(false);
+            new_seq->generator = LazySequence<Group>::template CreateFetchGenerator<Group>(
+                [cursor, groups, emitted, built, key, aggregate, start](Group &out) -> bool {
+                    if (!(*built)) {
+                        T value;
+                        while (cursor->Next(value)) {
+                            A &current = groups->GetOrInsert(key(value), start);
+                            current = aggregate(current, value);
+                        }
+                        *built = true;
+                    }
+                    if (*emitted >= groups->GetCount()) return false;
+                    out = Group(groups->GetKey(*emitted), groups->GetValue(*emitted));
+                    (*emitted)++;
+                    return true;
+                }
+            );
+            new_seq->length = (length.IsFinite() && length.GetFiniteValue() > 0) ? Cardinal::Bounded(1, length.GetFiniteValue()) : length.Filtered();
+            return new_seq;
+        }
+
+        // Соединение по хешу: build материализуется в хеш-таблицу при первом обращении, текущая последовательность читается потоково
+        // Память ограничена размером build; пары выдаются в порядке элементов текущей последовательности, затем build
+        template <typename U, typename K>
+        LazySequence<pair<T, U>>* HashJoin(Sequence<U> *build, function<K(T)> probeKey, function<K(U)> buildKey) {
+            using Row = pair<T, U>;
+            auto new_seq = new LazySequence<Row>();
+            auto cursor = make_shared<Cursor>(make_shared<LazySequence<T>>(*this));
+            auto lazyBuild = dynamic_cast<LazySequence<U>*>(build);
+            if (lazyBuild && lazyBuild->length.IsInfinite()) throw invalid_argument("Сторона построения не может быть бесконечной!");
+            // Строки build с одинаковым ключом связаны в список через next; таблица хранит первую и последнюю строку ключа
+            struct State {
+                shared_ptr<LazySequence<U>> source;
+                HashTable<K, pair<size_t, size_t>> keys;
+                vector<U> rows;
+                vector<size_t> next;
+                bool built = false;
+                T probe;
+                size_t match = SIZE_MAX;
+            };
+            auto state = make_shared<State>();
+            state->source = lazyBuild ? make_shared<LazySequence<U>>(*lazyBuild) : make_shared<LazySequence<U>>(build);
+            new_seq->generator = LazySequence<Row>::template CreateFetchGenerator<Row>(
+                [cursor, state, probeKey, buildKey](Row &out) -> bool {
+                    if (!state->built) {
+                        typename LazySequence<U>::Cursor rows(state->source);
+                        U row;
+                        while (rows.Next(row)) {
+                            size_t index = state->rows.size();
+                            state->rows.push_back(row);
+                            state->next.push_back(SIZE_MAX);
+                            auto inserted = state->keys.Insert(buildKey(row), make_pair(index, index));
+                            if (!inserted.second) {
+                                auto &chain = state->keys.GetValue(inserted.first);
+                                state->next[chain.second] = index;
+                                chain.second = index;
+                            }
+                        }
+                        state->source = nullptr;
+                        state->built = true;
+                    }
+                    while (state->match == SIZE_MAX) {
+                        if (!cursor->Next(state->probe)) return false;
+                        size_t entry = state->keys.Find(probeKey(state->probe));
+                        if (entry != HashTable<K, pair<size_t, size_t>>::NOT_FOUND) state->match = state->keys.GetValue(entry).first;
+                    }
+                    out = Row(state->probe, state->rows[state->match]);
+                    state->match = state->next[state->match];
+                    return true;
+                }
+            );
+            new_seq->length = length.IsFinite() && length.GetFiniteValue() == 0 ? Cardinal::Finite(0) : Cardinal::Unknown();
+            return new_seq;
+        }
+
+        // Соединение слиянием входов, упорядоченных по возрастанию ключа
+        // Буферизуется только текущая серия равных ключей второй последовательности
+        template <typename U, typename K>
+        LazySequence<pair<T, U>>* MergeJoin(LazySequence<U> *other, function<K(T)> leftKey, function<K(U)> rightKey,
+                                            function<bool(const K&, const K&)> less = std::less<K>()) {
+            using Row = pair<T, U>;
+            auto new_seq = new LazySequence<Row>();
+            auto left = make_shared<Cursor>(make_shared<LazySequence<T>>(*this));
+            auto right = make_shared<typename LazySequence<U>::Cursor>(make_shared<LazySequence<U>>(*other));
+            struct State {
+                T current;
+                bool hasLeft = false;
+                U head;
+                bool hasRight = false;
+                bool started = false;
+                vector<U> run;
+                K runKey;
+                size_t runIndex = 0;
+                bool inRun = false;
+            };
+            auto state = make_shared<State>();
+            new_seq->generator = LazySequence<Row>::template CreateFetchGenerator<Row>(
+                [left, right, state, leftKey, rightKey, less](Row &out) -> bool {
+                    if (!state->started) {
+                        state->hasRight = right->Next(state->head);
+                        state->started = true;
+                    }
+                    while (true) {
+                        if (state->inRun) {
+                            if (state->runIndex < state->run.size()) {
+                                out = Row(state->current, state->run[state->runIndex++]);
                                 return true;
                             }
-                            (*current)++;
+                            if (!left->Next(state->current)) return false;
+                            K key = leftKey(state->current);
+                            if (!less(key, state->runKey) && !less(state->runKey, key)) {
+                                state->runIndex = 0;
+                                continue;
+                            }
+                            state->inRun = false;
+                            state->hasLeft = true;
                         }
-                        return false;
-                    } catch (const out_of_range&) {
-                        return false;
+                        if (!state->hasLeft) {
+                            if (!left->Next(state->current)) return false;
+                            state->hasLeft = true;
+                        }
+                        K key = leftKey(state->current);
+                        while (state->hasRight && less(rightKey(state->head), key)) state->hasRight = right->Next(state->head);
+                        if (!state->hasRight) return false;
+                        if (less(key, rightKey(state->head))) {
+                            state->hasLeft = false;
+                            continue;
+                        }
+                        state->run.clear();
+                        state->runKey = key;
+                        while (state->hasRight && !less(key, rightKey(state->head))) {
+                            state->run.push_back(state->head);
+                            state->hasRight = right->Next(state->head);
+                        }
+                        state->hasLeft = false;
+                        state->inRun = true;
+                        state->runIndex = 0;
                     }
                 }
             );
@@ -467,33 +1701,118 @@ class LazySequence: public Sequence<T> {
             return new_seq;
         }
 
+        // Свёртка с досрочной остановкой: stop проверяется после каждого шага
         template <typename U>
-        U Reduce(function<U(U, T)> func, U start) {
+        U Fold(function<U(U, T)> func, U start, function<bool(const U&)> stop = nullptr) const {
+            if (length.IsInfinite() && !stop) throw runtime_error("Свёртка бесконечной последовательности требует условие остановки!");
             U result = start;
-            size_t iterations = 0;
-            const size_t MAX_ITERATIONS = 1000000;
-            if (!generator) {
-                if (length.IsFinite()) {
-                    for (size_t i = 0; i < length.GetFiniteValue() && iterations < MAX_ITERATIONS; i++) {
-                        T value = Get(i);
-                        result = func(result, value);
-                        iterations++;
-                    }
-                }
-            } else {
-                auto temp_generator = make_shared<Generator<T>>(*generator);
-                while (iterations < MAX_ITERATIONS) {
+            if (stop && stop(result)) return result;
+            if (streaming) {
+                for (size_t i = 0; !length.IsFinite() || i < length.GetFiniteValue(); i++) {
+                    T value;
                     try {
-                        T value = temp_generator->GetNext();
-                        result = func(result, value);
-                        iterations++;
-                    } catch (const runtime_error&) {
-                        break;
+                        value = Extract(i);
+                    } catch (const out_of_range&) {
+                        if (length.IsUnknown()) break;
+                        throw;
                     }
+                    result = func(result, value);
+                    if (stop && stop(result)) break;
+                }
+                return result;
+            }
+            // Вычисленный префикс читается из кеша
+            for (size_t i = 0; i < materialized; i++) {
+                result = func(result, sequence[i]);
+                if (stop && stop(result)) return result;
+            }
+            if (length.IsFinite() && materialized >= length.GetFiniteValue()) return result;
+            // Конечный остаток генератора длиннее буфера ленты читается позицией самой последовательности:
+            // копия всё равно отключила бы её от ленты, а так элементы не запоминаются вовсе
+            bool longTail = length.IsFinite() && length.GetFiniteValue()-materialized > GeneratorTape<T>::MAX_BUFFER;
+            if (generator && !indexer && longTail) {
+                GeneratorTape<T> &source = Tape();
+                source.Check(reader);
+                if (source.GetPosition(reader) != materialized) throw runtime_error("Генератор не поддерживает произвольный доступ!");
+                for (size_t i = materialized; i < length.GetFiniteValue(); i++) {
+                    if (!source.HasNext(reader)) throw runtime_error("Генератор произвел меньше элементов, чем ожидалось!");
+                    result = func(result, source.Next(reader));
+                    if (stop && stop(result)) break;
                 }
+                return result;
+            }
+            // Короткий остаток - курсором копии: сама последовательность остаётся нетронутой
+            Cursor cursor(make_shared<LazySequence<T>>(*this));
+            cursor.Advance(materialized);
+            T value;
+            while (cursor.Next(value)) {
+                result = func(result, value);
+                if (stop && stop(result)) break;
             }
             return result;
         }
+
+        template <typename U>
+        U Reduce(function<U(U, T)> func, U start) {
+            return Fold<U>(func, start);
+        }
+
+        // Параллельная свёртка блоками: start - нейтральный элемент combine, результаты блоков объединяются по порядку
+        template <typename U>
+        U ParallelReduce(function<U(U, T)> func, function<U(U, U)> combine, U start, size_t threads = 0) const {
+            if (!length.IsFinite() || (streaming && !concurrentIndexer)) return Fold<U>(func, start);
+            size_t count = length.GetFiniteValue();
+            if (count == 0) return start;
+            if (!concurrentIndexer) Cache(count-1);
+            size_t chunks = GetChunkCount(count, threads);
+            vector<U> partial(chunks, start);
+            size_t cachedCount = streaming ? 0 : materialized;
+            ParallelFor(count, chunks, [&](size_t chunk, size_t from, size_t to) {
+                U local = start;
+                size_t cached = min(to, max(from, cachedCount));
+                for (size_t i = from; i < cached; i++) local = func(local, sequence[i]);
+                for (size_t i = cached; i < to; i++) local = func(local, indexer(i));
+                partial[chunk] = local;
+            });
+            U result = partial[0];
+            for (size_t chunk = 1; chunk < chunks; chunk++) result = combine(result, partial[chunk]);
+            return result;
+        }
+
+        // Вычисление первых count элементов (кеш всегда непрерывный префикс); по умолчанию - вся конечная последовательность
+        // Независимый индексатор заполняет заранее выделенный кеш параллельно блоками общего пула
+        void Materialize(size_t count = SIZE_MAX, size_t threads = 0) const {
+            if (streaming) throw runtime_error("Потоковая последовательность не хранит вычисленные элементы!");
+            if (count == SIZE_MAX) count = GetLength();
+            if (length.IsFinite() && count > length.GetFiniteValue()) throw out_of_range("Индекс выходит за пределы последовательности!");
+            if (count <= materialized) return;
+            if (!concurrentIndexer) {
+                Cache(count-1);
+                return;
+            }
+            size_t from = materialized;
+            Reserve(count);
+            ParallelFor(count-from, GetChunkCount(count-from, threads), [&](size_t, size_t begin, size_t end) {
+                for (size_t i = from+begin; i < from+end; i++) sequence[i] = indexer(i);
+            });
+            materialized = count;
+        }
 };
 
+
+// Оценка длины произвольной последовательности для предварительного выделения памяти
+template <typename T>
+Cardinal GetSizeHint(const Sequence<T> *seq) {
+    if (auto lazy = dynamic_cast<const LazySequence<T>*>(seq)) return lazy->GetCardinal();
+    return Cardinal::Finite(seq->GetLength());
+}
+
+// Предварительное вычисление LazySequence известной конечной длины перед полным проходом
+template <typename T>
+void PrefetchSequence(const Sequence<T> *seq, size_t count = SIZE_MAX, size_t threads = 0) {
+    auto lazy = dynamic_cast<const LazySequence<T>*>(seq);
+    if (!lazy || !lazy->GetCardinal().IsFinite() || lazy->IsStreaming()) return;
+    lazy->Materialize(min(count, lazy->GetLength()), threads);
+}
+
 #endif // LAZYSEQUENCE_HPP
@@ -0,0 +1,289 @@
+#ifndef PARALLEL_HPP
+#define PARALLEL_HPP
+
+#include <thread>
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <functional>
+#include <exception>
+#include <algorithm>
+#include <condition_variable>
+using namespace std;
+
+
+// Минимальный размер блока, ради которого имеет смысл заводить поток
+const size_t MIN_PARALLEL_CHUNK = 4096;
+
+// Число потоков по умолчанию
+inline size_t GetDefaultThreadCount() {
+    size_t count = thread::hardware_concurrency();
+    return count ? count : 1;
+}
+
+// Число блоков для параллельной обработки count элементов
+inline size_t GetChunkCount(size_t count, size_t threads = 0) {
+    if (threads == 0) threads = GetDefaultThreadCount();
+    size_t chunks = min(threads, count/MIN_PARALLEL_CHUNK);
+    return chunks ? chunks : 1;
+}
+
+// Пул потоков с перехватом задач: у каждого потока своя очередь, свободный поток забирает задачи из чужих
+class ThreadPool {
+    private:
+        struct Queue {
+            mutex lock;
+            deque<function<void()>> tasks;
+        };
+        vector<unique_ptr<Queue>> queues;
+        vector<thread> workers;
+        mutex sleepLock;
+        condition_variable wakeup;
+        atomic<size_t> pending;
+        atomic<size_t> nextQueue;
+        bool stopping;
+
+        static size_t& CurrentWorker() {
+            static thread_local size_t index = SIZE_MAX;
+            return index;
+        }
+
+        static const ThreadPool*& CurrentPool() {
+            static thread_local const ThreadPool *pool = nullptr;
+            return pool;
+        }
+
+        // Своя очередь берётся с конца, чужие - с начала
+        bool TryTake(size_t home, function<void()> &task) {
+            size_t count = queues.size();
+            for (size_t offset = 0; offset < count; offset++) {
+                Queue &queue = *queues[(home+offset) % count];
+                lock_guard<mutex> guard(queue.lock);
+                if (queue.tasks.empty()) continue;
+                if (offset == 0) {
+                    task = move(queue.tasks.back());
+                    queue.tasks.pop_back();
+                } else {
+                    task = move(queue.tasks.front());
+                    queue.tasks.pop_front();
+                }
+                pending--;
+                return true;
+            }
+            return false;
+        }
+
+        void WorkerLoop(size_t index) {
+            CurrentWorker() = index;
+            CurrentPool() = this;
+            function<void()> task;
+            while (true) {
+                if (TryTake(index, task)) {
+                    task();
+                    task = nullptr;
+                    continue;
+                }
+                unique_lock<mutex> guard(sleepLock);
+                wakeup.wait(guard, [this]() { return stopping || pending > 0; });
+                if (stopping && pending == 0) return;
+            }
+        }
+    public:
+        // Конструкторы
+        explicit ThreadPool(size_t threads = 0): pending(0), nextQueue(0), stopping(false) {
+            if (threads == 0) threads = GetDefaultThreadCount();
+            for (size_t i = 0; i < threads; i++) queues.push_back(make_unique<Queue>());
+            for (size_t i = 0; i < threads; i++) workers.emplace_back([this, i]() { WorkerLoop(i); });
+        }
+
+        ~ThreadPool() {
+            {
+                lock_guard<mutex> guard(sleepLock);
+                stopping = true;
+            }
+            wakeup.notify_all();
+            for (auto &worker : workers) worker.join();
+        }
+
+        ThreadPool(const ThreadPool&) = delete;
+        ThreadPool& operator=(const ThreadPool&) = delete;
+
+        // Декомпозиция
+        size_t GetThreadCount() const { return workers.size(); }
+
+        // Операции
+        void Submit(function<void()> task) {
+            size_t target = (CurrentPool() == this) ? CurrentWorker() : nextQueue++ % queues.size();
+            {
+                lock_guard<mutex> guard(sleepLock);
+                pending++;
+            }
+            {
+                lock_guard<mutex> guard(queues[target]->lock);
+                queues[target]->tasks.push_back(move(task));
+            }
+            wakeup.notify_one();
+        }
+
+        // Выполнение одной ожидающей задачи в вызывающем потоке (помощь при ожидании)
+        bool RunPending() {
+            function<void()> task;
+            size_t home = (CurrentPool() == this) ? CurrentWorker() : 0;
+            if (!TryTake(home, task)) return false;
+            task();
+            return true;
+        }
+};
+
+// Ограниченная очередь одного производителя и одного потребителя без блокировок: кольцевой буфер,
+// индексы записи и чтения растут монотонно и хранятся в разных строках кеша.
+// Push/Pop ждут места или элемента на условной переменной; мьютекс берётся только для ожидания,
+// а успешная операция будит другую сторону, лишь если та действительно спит
+template <typename T>
+class SpscQueue {
+    private:
+        vector<T> slots;
+        alignas(64) atomic<size_t> head;
+        alignas(64) atomic<size_t> tail;
+        atomic<bool> closed;
+        atomic<size_t> sleepers;
+        mutex waitLock;
+        condition_variable changed;
+
+        // Ожидание на условной переменной; счётчик спящих выставляется до проверки условия
+        template <typename Predicate>
+        void Sleep(Predicate ready) {
+            unique_lock<mutex> guard(waitLock);
+            sleepers.fetch_add(1);
+            atomic_thread_fence(memory_order_seq_cst);
+            changed.wait(guard, ready);
+            sleepers.fetch_sub(1);
+        }
+
+        // Барьер упорядочивает запись индекса и чтение счётчика: либо спящий увидит новый индекс, либо его разбудят
+        void Notify() {
+            atomic_thread_fence(memory_order_seq_cst);
+            if (sleepers.load(memory_order_relaxed) > 0) Wake();
+        }
+    public:
+        // Конструкторы
+        explicit SpscQueue(size_t capacity): slots(capacity ? capacity : 1), head(0), tail(0), closed(false), sleepers(0) {}
+
+        SpscQueue(const SpscQueue&) = delete;
+        SpscQueue& operator=(const SpscQueue&) = delete;
+
+        // Декомпозиция
+        size_t GetCapacity() const { return slots.size(); }
+
+        size_t GetSize() const { return tail.load(memory_order_acquire)-head.load(memory_order_acquire); }
+
+        // Производитель закрыл очередь; оставшиеся элементы ещё можно забрать
+        bool IsClosed() const { return closed.load(memory_order_acquire); }
+
+        // Операции
+        // Вызывается только производителем; при успехе элемент перемещается в очередь
+        bool TryPush(T &item) {
+            size_t position = tail.load(memory_order_relaxed);
+            if (position-head.load(memory_order_acquire) == slots.size()) return false;
+            slots[position % slots.size()] = move(item);
+            tail.store(position+1, memory_order_release);
+            return true;
+        }
+
+        // Вызывается только потребителем
+        bool TryPop(T &item) {
+            size_t position = head.load(memory_order_relaxed);
+            if (position == tail.load(memory_order_acquire)) return false;
+            item = move(slots[position % slots.size()]);
+            head.store(position+1, memory_order_release);
+            return true;
+        }
+
+        // Запись с ожиданием места; false - выставлен stop (после него нужно вызвать Wake)
+        bool Push(T &item, const atomic<bool> &stop) {
+            while (!TryPush(item)) {
+                Sleep([&]() { return stop || GetSize() < slots.size(); });
+                if (stop) return false;
+            }
+            Notify();
+            return true;
+        }
+
+        // Чтение с ожиданием элемента; false - очередь закрыта и пуста или выставлен stop
+        bool Pop(T &item, const atomic<bool> &stop) {
+            while (!TryPop(item)) {
+                if (stop) return false;
+                if (IsClosed()) {
+                    if (TryPop(item)) break;
+                    return false;
+                }
+                Sleep([&]() { return stop || IsClosed() || GetSize() > 0; });
+            }
+            Notify();
+            return true;
+        }
+
+        // Пробуждение ожидающих Push/Pop, например после выставления stop
+        void Wake() {
+            lock_guard<mutex> guard(waitLock);
+            changed.notify_all();
+        }
+
+        void Close() {
+            closed.store(true, memory_order_release);
+            Wake();
+        }
+};
+
+// Общий пул для всех параллельных операций
+inline ThreadPool& GetSharedThreadPool() {
+    static ThreadPool pool;
+    return pool;
+}
+
+// Параллельный цикл: [0, count) делится на chunks непрерывных блоков, блоки выполняются общим пулом
+inline void ParallelFor(size_t count, size_t chunks, function<void(size_t, size_t, size_t)> body) {
+    if (chunks <= 1 || count == 0) {
+        body(0, 0, count);
+        return;
+    }
+    ThreadPool &pool = GetSharedThreadPool();
+    vector<exception_ptr> errors(chunks);
+    size_t remaining = chunks-1;
+    mutex doneLock;
+    condition_variable done;
+    for (size_t chunk = 1; chunk < chunks; chunk++) {
+        pool.Submit([&, chunk]() {
+            try {
+                body(chunk, count*chunk/chunks, count*(chunk+1)/chunks);
+            } catch (...) {
+                errors[chunk] = current_exception();
+            }
+            // Сигнал под мьютексом: после последнего блока ParallelFor сразу разрушает done
+            lock_guard<mutex> guard(doneLock);
+            if (--remaining == 0) done.notify_all();
+        });
+    }
+    try {
+        body(0, 0, count/chunks);
+    } catch (...) {
+        errors[0] = current_exception();
+    }
+    // Ожидающий поток сам выполняет задачи, поэтому вложенные циклы не блокируют пул.
+    // Когда очередь пула пуста, оставшиеся блоки уже выполняются, и их можно ждать без опроса
+    unique_lock<mutex> guard(doneLock);
+    while (remaining > 0) {
+        guard.unlock();
+        bool helped = pool.RunPending();
+        guard.lock();
+        if (!helped) done.wait(guard, [&]() { return remaining == 0; });
+    }
+    guard.unlock();
+    for (auto &error : errors) {
+        if (error) rethrow_exception(error);
+    }
+}
+
+#endif // PARALLEL_HPP
@@ -0,0 +1,299 @@
+#ifndef PIPELINE_HPP
+#define PIPELINE_HPP
+
+#include <type_traits>
+#include <utility>
+#include "LazySequence.hpp"
+using namespace std;
+
+
+// Конвейеры, собираемые на этапе компиляции: From(...) | Map(f) | Where(p) | Take(n)
+// Каждая стадия - отдельный тип, вызовы Next встраиваются в один цикл
+namespace Pipeline {
+
+// Общие операции для всех стадий
+template <typename Derived, typename T>
+class Stage {
+    public:
+        using ValueType = T;
+
+        template <typename U, typename F>
+        U Fold(U start, F func) {
+            T value;
+            while (self().Next(value)) start = func(start, value);
+            return start;
+        }
+
+        T Sum() {
+            return Fold(T(), [](T acc, const T &value) { return acc+value; });
+        }
+
+        size_t Count() {
+            T value;
+            size_t count = 0;
+            while (self().Next(value)) count++;
+            return count;
+        }
+
+        template <typename F>
+        void ForEach(F func) {
+            T value;
+            while (self().Next(value)) func(value);
+        }
+
+        // Граница с LazySequence: конвейер становится генератором, оценка длины сохраняется
+        shared_ptr<LazySequence<T>> ToLazySequence() const {
+            auto pipeline = make_shared<Derived>(static_cast<const Derived&>(*this));
+            auto lookahead = make_shared<T>();
+            auto ready = make_shared<bool>(false);
+            auto finished = make_shared<bool>(false);
+            auto fetch = [pipeline, lookahead, ready, finished]() -> bool {
+                if (!(*ready) && !(*finished)) {
+                    if (pipeline->Next(*lookahead)) *ready = true;
+                    else *finished = true;
+                }
+                return *ready;
+            };
+            auto generator = make_shared<Generator<T>>(
+                [lookahead, ready, fetch]() -> T {
+                    if (!fetch()) throw runtime_error("Нет больше элементов!");
+                    *ready = false;
+                    return move(*lookahead);
+                },
+                fetch
+            );
+            return make_shared<LazySequence<T>>(generator, pipeline->GetSizeHint());
+        }
+    private:
+        Derived& self() { return static_cast<Derived&>(*this); }
+};
+
+
+// Источник из непрерывного массива
+template <typename T>
+class ArraySource: public Stage<ArraySource<T>, T> {
+    private:
+        const T *items;
+        size_t count;
+        size_t position;
+    public:
+        ArraySource(const T *data, size_t size): items(data), count(size), position(0) {}
+
+        Cardinal GetSizeHint() const { return Cardinal::Finite(count-position); }
+
+        bool Next(T &out) {
+            if (position >= count) return false;
+            out = items[position++];
+            return true;
+        }
+};
+
+// Источник из арифметической прогрессии [begin, end)
+template <typename T>
+class RangeSource: public Stage<RangeSource<T>, T> {
+    private:
+        T current;
+        T end;
+        T step;
+    public:
+        RangeSource(T from, T to, T delta): current(from), end(to), step(delta) {
+            if (!(step > T(0))) throw invalid_argument("Шаг прогрессии должен быть положительным!");
+        }
+
+        // Расстояние до конца считается без знака: end-current и current+step не переполняются
+        Cardinal GetSizeHint() const {
+            if constexpr (is_integral<T>::value) {
+                if (!(current < end)) return Cardinal::Finite(0);
+                using Unsigned = make_unsigned_t<T>;
+                Unsigned distance = static_cast<Unsigned>(end)-static_cast<Unsigned>(current);
+                Unsigned delta = static_cast<Unsigned>(step);
+                return Cardinal::Finite(static_cast<size_t>(distance/delta+(distance % delta != 0)));
+            }
+            return Cardinal::Unknown();
+        }
+
+        bool Next(T &out) {
+            if (!(current < end)) return false;
+            out = current;
+            if constexpr (is_integral<T>::value) {
+                using Unsigned = make_unsigned_t<T>;
+                if (static_cast<Unsigned>(end)-static_cast<Unsigned>(current) <= static_cast<Unsigned>(step)) current = end;
+                else current += step;
+            } else {
+                current += step;
+            }
+            return true;
+        }
+};
+
+// Источник из последовательности (включая LazySequence неизвестной длины)
+// LazySequence читается курсором копии: кеш не растёт и лимит кеша бесконечной последовательности не действует,
+// но у генератора отстающий оригинал держит в общей ленте до GeneratorTape::MAX_BUFFER прочитанных элементов
+template <typename T>
+class SequenceSource: public Stage<SequenceSource<T>, T> {
+    private:
+        using Cursor = typename LazySequence<T>::Cursor;
+
+        shared_ptr<Sequence<T>> sequence;
+        shared_ptr<Cursor> cursor;
+        size_t position;
+        size_t count;
+        bool bounded;
+    public:
+        SequenceSource(shared_ptr<Sequence<T>> seq): sequence(seq), position(0), count(0), bounded(true) {
+            if (auto lazy = dynamic_pointer_cast<LazySequence<T>>(seq)) {
+                cursor = make_shared<Cursor>(make_shared<LazySequence<T>>(*lazy));
+                bounded = lazy->GetCardinal().IsFinite();
+                if (bounded) count = lazy->GetLength();
+                return;
+            }
+            count = seq->GetLength();
+        }
+
+        Cardinal GetSizeHint() const {
+            if (bounded) return Cardinal::Finite(count-position);
+            return ::GetSizeHint(sequence.get()).Skip(position);
+        }
+
+        bool Next(T &out) {
+            if (cursor) {
+                if (!cursor->Next(out)) return false;
+                position++;
+                return true;
+            }
+            if (position >= count) return false;
+            out = sequence->Get(position++);
+            return true;
+        }
+};
+
+
+// Стадия преобразования
+template <typename Source, typename F>
+class MapStage: public Stage<MapStage<Source, F>, decay_t<invoke_result_t<F, typename Source::ValueType>>> {
+    private:
+        Source source;
+        F func;
+    public:
+        using ValueType = decay_t<invoke_result_t<F, typename Source::ValueType>>;
+
+        MapStage(Source src, F f): source(move(src)), func(move(f)) {}
+
+        Cardinal GetSizeHint() const { return source.GetSizeHint(); }
+
+        bool Next(ValueType &out) {
+            typename Source::ValueType value;
+            if (!source.Next(value)) return false;
+            out = func(value);
+            return true;
+        }
+};
+
+// Стадия фильтрации
+template <typename Source, typename P>
+class WhereStage: public Stage<WhereStage<Source, P>, typename Source::ValueType> {
+    private:
+        Source source;
+        P predicate;
+    public:
+        using ValueType = typename Source::ValueType;
+
+        WhereStage(Source src, P p): source(move(src)), predicate(move(p)) {}
+
+        Cardinal GetSizeHint() const { return source.GetSizeHint().Filtered(); }
+
+        bool Next(ValueType &out) {
+            while (source.Next(out)) {
+                if (predicate(out)) return true;
+            }
+            return false;
+        }
+};
+
+// Стадия ограничения числа элементов
+template <typename Source>
+class TakeStage: public Stage<TakeStage<Source>, typename Source::ValueType> {
+    private:
+        Source source;
+        size_t remaining;
+    public:
+        using ValueType = typename Source::ValueType;
+
+        TakeStage(Source src, size_t count): source(move(src)), remaining(count) {}
+
+        Cardinal GetSizeHint() const { return source.GetSizeHint().Clamp(remaining); }
+
+        bool Next(ValueType &out) {
+            if (remaining == 0 || !source.Next(out)) return false;
+            remaining--;
+            return true;
+        }
+};
+
+// Стадия пропуска первых элементов
+template <typename Source>
+class SkipStage: public Stage<SkipStage<Source>, typename Source::ValueType> {
+    private:
+        Source source;
+        size_t skip;
+    public:
+        using ValueType = typename Source::ValueType;
+
+        SkipStage(Source src, size_t count): source(move(src)), skip(count) {}
+
+        Cardinal GetSizeHint() const { return source.GetSizeHint().Skip(skip); }
+
+        bool Next(ValueType &out) {
+            for (; skip > 0; skip--) {
+                if (!source.Next(out)) return false;
+            }
+            return source.Next(out);
+        }
+};
+
+
+// Описания стадий для оператора |
+template <typename F> struct MapTag { F func; };
+template <typename P> struct WhereTag { P predicate; };
+struct TakeTag { size_t count; };
+struct SkipTag { size_t count; };
+
+template <typename F> MapTag<F> Map(F func) { return {move(func)}; }
+template <typename P> WhereTag<P> Where(P predicate) { return {move(predicate)}; }
+inline TakeTag Take(size_t count) { return {count}; }
+inline SkipTag Skip(size_t count) { return {count}; }
+
+template <typename Source, typename F>
+MapStage<Source, F> operator|(Source source, MapTag<F> tag) { return MapStage<Source, F>(move(source), move(tag.func)); }
+
+template <typename Source, typename P>
+WhereStage<Source, P> operator|(Source source, WhereTag<P> tag) { return WhereStage<Source, P>(move(source), move(tag.predicate)); }
+
+template <typename Source>
+TakeStage<Source> operator|(Source source, TakeTag tag) { return TakeStage<Source>(move(source), tag.count); }
+
+template <typename Source>
+SkipStage<Source> operator|(Source source, SkipTag tag) { return SkipStage<Source>(move(source), tag.count); }
+
+
+// Создание источников
+template <typename T>
+ArraySource<T> From(const T *items, size_t count) { return ArraySource<T>(items, count); }
+
+template <typename T>
+ArraySource<T> From(const DynamicArray<T> &array) {
+    return ArraySource<T>(array.GetSize() ? &array[0] : nullptr, array.GetSize());
+}
+
+template <typename T>
+SequenceSource<T> From(shared_ptr<Sequence<T>> sequence) { return SequenceSource<T>(sequence); }
+
+template <typename T>
+SequenceSource<T> From(shared_ptr<LazySequence<T>> sequence) { return SequenceSource<T>(sequence); }
+
+template <typename T>
+RangeSource<T> Range(T from, T to, T step = T(1)) { return RangeSource<T>(from, to, step); }
+
+}
+
+#endif // PIPELINE_HPP
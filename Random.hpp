@@ -0,0 +1,314 @@
+#ifndef RANDOM_HPP
+#define RANDOM_HPP
+
+#include <array>
+#include <cmath>
+#include <vector>
+#include <cstdint>
+#include <type_traits>
+#include "LazySequence.hpp"
+#include "Stream.hpp"
+using namespace std;
+
+
+// Счётчиковый генератор Philox4x32-10: блок определяется ключом и номером, внутреннего состояния нет
+class Philox {
+    private:
+        uint32_t key0;
+        uint32_t key1;
+        uint32_t stream;
+
+        static void Round(uint32_t (&counter)[4], uint32_t k0, uint32_t k1) {
+            uint64_t p0 = static_cast<uint64_t>(0xD2511F53u)*counter[0];
+            uint64_t p1 = static_cast<uint64_t>(0xCD9E8D57u)*counter[2];
+            uint32_t c1 = counter[1], c3 = counter[3];
+            counter[0] = static_cast<uint32_t>(p1 >> 32) ^ c1 ^ k0;
+            counter[1] = static_cast<uint32_t>(p1);
+            counter[2] = static_cast<uint32_t>(p0 >> 32) ^ c3 ^ k1;
+            counter[3] = static_cast<uint32_t>(p0);
+        }
+    public:
+        static constexpr size_t BLOCK_WORDS = 4;
+
+        // Конструкторы
+        explicit Philox(uint64_t seed = 0, uint32_t streamId = 0):
+            key0(static_cast<uint32_t>(seed)), key1(static_cast<uint32_t>(seed >> 32)), stream(streamId) {}
+
+        // Декомпозиция
+        uint64_t GetSeed() const { return (static_cast<uint64_t>(key1) << 32) | key0; }
+
+        uint32_t GetStream() const { return stream; }
+
+        // Четыре слова блока counter; lane - дополнительная независимая подпоследовательность того же номера
+        array<uint32_t, BLOCK_WORDS> Block(uint64_t counter, uint32_t lane = 0) const {
+            uint32_t state[4] = {static_cast<uint32_t>(counter), static_cast<uint32_t>(counter >> 32), lane, stream};
+            uint32_t k0 = key0, k1 = key1;
+            for (int round = 0; round < 10; round++) {
+                Round(state, k0, k1);
+                k0 += 0x9E3779B9u;
+                k1 += 0xBB67AE85u;
+            }
+            return {state[0], state[1], state[2], state[3]};
+        }
+
+        uint32_t Word(uint64_t index) const {
+            return Block(index/BLOCK_WORDS)[index % BLOCK_WORDS];
+        }
+
+        // Равномерное число из [0, 1) по 53 битам двух слов
+        static double ToUnit(uint32_t high, uint32_t low) {
+            uint64_t bits = ((static_cast<uint64_t>(high) << 32) | low) >> 11;
+            return static_cast<double>(bits)*(1.0/9007199254740992.0);
+        }
+};
+
+
+// Общие операции распределений: элемент i зависит только от (seed, stream, i), поэтому доступ произвольный,
+// а блоки можно заполнять параллельно. Derived задаёт VALUES_PER_BLOCK и Block(counter, out)
+template <typename Derived, typename T>
+class RandomDistribution {
+    private:
+        const Derived& self() const { return static_cast<const Derived&>(*this); }
+    protected:
+        Philox engine;
+
+        RandomDistribution(uint64_t seed, uint32_t stream): engine(seed, stream) {}
+    public:
+        using ValueType = T;
+
+        static constexpr size_t BUFFER_SIZE = 256;
+
+        // Декомпозиция
+        const Philox& GetEngine() const { return engine; }
+
+        T At(size_t index) const {
+            constexpr size_t per = Derived::VALUES_PER_BLOCK;
+            T values[per];
+            self().Block(index/per, values);
+            return values[index % per];
+        }
+
+        // Операции
+        // Заполнение [from, from+count): каждый вызов Philox даёт сразу VALUES_PER_BLOCK значений
+        void Fill(size_t from, T *out, size_t count) const {
+            constexpr size_t per = Derived::VALUES_PER_BLOCK;
+            T values[per];
+            size_t i = 0;
+            size_t offset = from % per;
+            if (offset && count) {
+                self().Block(from/per, values);
+                for (; offset < per && i < count; offset++) out[i++] = values[offset];
+            }
+            for (; i+per <= count; i += per) self().Block((from+i)/per, out+i);
+            if (i < count) {
+                self().Block((from+i)/per, values);
+                for (size_t j = 0; i < count; j++) out[i++] = values[j];
+            }
+        }
+
+        shared_ptr<DynamicArray<T>> Generate(size_t from, size_t count, size_t threads = 0) const {
+            auto result = make_shared<DynamicArray<T>>(count);
+            if (count == 0) return result;
+            T *data = &(*result)[0];
+            ParallelFor(count, GetChunkCount(count, threads), [&](size_t, size_t begin, size_t end) {
+                Fill(from+begin, data+begin, end-begin);
+            });
+            return result;
+        }
+
+        // Последовательный проход заполняет буфер блоками, произвольный доступ идёт через At
+        shared_ptr<LazySequence<T>> ToLazySequence(Cardinal len = Cardinal::Infinite()) const {
+            auto source = make_shared<Derived>(self());
+            auto position = make_shared<size_t>(0);
+            auto bufferStart = make_shared<size_t>(SIZE_MAX);
+            auto buffer = make_shared<vector<T>>(BUFFER_SIZE);
+            auto generator = make_shared<Generator<T>>(
+                [source, position, bufferStart, buffer]() -> T {
+                    if (*bufferStart == SIZE_MAX || *position < *bufferStart || *position-*bufferStart >= BUFFER_SIZE) {
+                        *bufferStart = *position;
+                        source->Fill(*bufferStart, buffer->data(), BUFFER_SIZE);
+                    }
+                    return (*buffer)[(*position)++ - *bufferStart];
+                },
+                []() { return true; },
+                [position]() {
+                    return string(reinterpret_cast<const char*>(position.get()), sizeof(size_t));
+                },
+                [position](const string &state) {
+                    if (state.size() != sizeof(size_t)) throw runtime_error("Некорректное состояние генератора!");
+                    memcpy(position.get(), state.data(), sizeof(size_t));
+                }
+            );
+            return make_shared<LazySequence<T>>(generator, [source](size_t index) { return source->At(index); }, len);
+        }
+
+        // Поток из count случайных значений без хранения прочитанных элементов
+        shared_ptr<ReadOnlyStream<T>> ToStream(size_t count) const {
+            auto stream = make_shared<ReadOnlyStream<T>>(ToLazySequence(Cardinal::Finite(count)));
+            stream->SetStreaming(true);
+            return stream;
+        }
+};
+
+
+// Равномерное целое из [from, to]
+template <typename T>
+class UniformIntDistribution: public RandomDistribution<UniformIntDistribution<T>, T> {
+    static_assert(is_integral<T>::value, "Требуется целочисленный тип!");
+    private:
+        T from;
+        uint64_t range;
+
+        // Старшие 64 бита произведения; без __int128 собираются из 32-битных половин
+        static uint64_t MultiplyHigh(uint64_t a, uint64_t b) {
+#ifdef __SIZEOF_INT128__
+            return static_cast<uint64_t>((static_cast<unsigned __int128>(a)*b) >> 64);
+#else
+            uint64_t aLow = a & 0xFFFFFFFFu, aHigh = a >> 32, bLow = b & 0xFFFFFFFFu, bHigh = b >> 32;
+            uint64_t low = aLow*bLow, middle1 = aHigh*bLow, middle2 = aLow*bHigh;
+            uint64_t carry = ((low >> 32)+(middle1 & 0xFFFFFFFFu)+(middle2 & 0xFFFFFFFFu)) >> 32;
+            return aHigh*bHigh+(middle1 >> 32)+(middle2 >> 32)+carry;
+#endif
+        }
+    public:
+        static constexpr size_t VALUES_PER_BLOCK = (sizeof(T) <= 4) ? 4 : 2;
+
+        UniformIntDistribution(T low, T high, uint64_t seed = 0, uint32_t stream = 0):
+            RandomDistribution<UniformIntDistribution<T>, T>(seed, stream), from(low) {
+            if (high < low) throw invalid_argument("Некорректный диапазон распределения!");
+            range = static_cast<uint64_t>(high)-static_cast<uint64_t>(low)+1;
+        }
+
+        // Отображение слова в диапазон умножением со старшей половиной (без деления)
+        void Block(uint64_t counter, T *out) const {
+            auto words = this->engine.Block(counter);
+            if constexpr (VALUES_PER_BLOCK == 4) {
+                for (size_t i = 0; i < 4; i++) {
+                    out[i] = static_cast<T>(static_cast<uint64_t>(from)+((static_cast<uint64_t>(words[i])*range) >> 32));
+                }
+            } else {
+                for (size_t i = 0; i < 2; i++) {
+                    uint64_t bits = (static_cast<uint64_t>(words[2*i]) << 32) | words[2*i+1];
+                    out[i] = static_cast<T>(static_cast<uint64_t>(from)+(range ? MultiplyHigh(bits, range) : bits));
+                }
+            }
+        }
+};
+
+// Равномерное вещественное из [from, to)
+template <typename T>
+class UniformRealDistribution: public RandomDistribution<UniformRealDistribution<T>, T> {
+    static_assert(is_floating_point<T>::value, "Требуется вещественный тип!");
+    private:
+        T from;
+        T width;
+    public:
+        static constexpr size_t VALUES_PER_BLOCK = 2;
+
+        UniformRealDistribution(T low = T(0), T high = T(1), uint64_t seed = 0, uint32_t stream = 0):
+            RandomDistribution<UniformRealDistribution<T>, T>(seed, stream), from(low), width(high-low) {
+            if (!(low < high)) throw invalid_argument("Некорректный диапазон распределения!");
+        }
+
+        void Block(uint64_t counter, T *out) const {
+            auto words = this->engine.Block(counter);
+            out[0] = from+width*static_cast<T>(Philox::ToUnit(words[0], words[1]));
+            out[1] = from+width*static_cast<T>(Philox::ToUnit(words[2], words[3]));
+        }
+};
+
+// Нормальное распределение: преобразование Бокса-Мюллера даёт пару значений на блок
+template <typename T>
+class NormalDistribution: public RandomDistribution<NormalDistribution<T>, T> {
+    static_assert(is_floating_point<T>::value, "Требуется вещественный тип!");
+    private:
+        T mean;
+        T deviation;
+    public:
+        static constexpr size_t VALUES_PER_BLOCK = 2;
+
+        NormalDistribution(T mu = T(0), T sigma = T(1), uint64_t seed = 0, uint32_t stream = 0):
+            RandomDistribution<NormalDistribution<T>, T>(seed, stream), mean(mu), deviation(sigma) {
+            if (!(sigma > T(0))) throw invalid_argument("Стандартное отклонение должно быть положительным!");
+        }
+
+        void Block(uint64_t counter, T *out) const {
+            auto words = this->engine.Block(counter);
+            double radius = sqrt(-2.0*log(1.0-Philox::ToUnit(words[0], words[1])));
+            double angle = 6.283185307179586*Philox::ToUnit(words[2], words[3]);
+            out[0] = mean+deviation*static_cast<T>(radius*cos(angle));
+            out[1] = mean+deviation*static_cast<T>(radius*sin(angle));
+        }
+};
+
+// Распределение Ципфа на [1, n] с показателем s: отбор с обращением (Hörmann, Derflinger) за O(1) без таблиц
+// Повторные попытки для элемента берут блоки того же номера с другим lane, поэтому элемент не зависит от соседей
+template <typename T>
+class ZipfDistribution: public RandomDistribution<ZipfDistribution<T>, T> {
+    static_assert(is_integral<T>::value, "Требуется целочисленный тип!");
+    private:
+        double count;
+        double exponent;
+        double integralFirst;
+        double integralTotal;
+        double squeeze;
+
+        static double Log1pRatio(double x) {
+            if (fabs(x) > 1e-8) return log1p(x)/x;
+            return 1.0-x*(0.5-x*(1.0/3.0-0.25*x));
+        }
+
+        static double Expm1Ratio(double x) {
+            if (fabs(x) > 1e-8) return expm1(x)/x;
+            return 1.0+x*0.5*(1.0+x/3.0*(1.0+0.25*x));
+        }
+
+        double H(double x) const { return exp(-exponent*log(x)); }
+
+        double Integral(double x) const {
+            double logX = log(x);
+            return Expm1Ratio((1.0-exponent)*logX)*logX;
+        }
+
+        double IntegralInverse(double x) const {
+            double t = x*(1.0-exponent);
+            if (t < -1.0) t = -1.0;
+            return exp(Log1pRatio(t)*x);
+        }
+
+        // Одна попытка отбора; 0 - попытка отвергнута
+        T Sample(double u) const {
+            double value = integralTotal+u*(integralFirst-integralTotal);
+            double x = IntegralInverse(value);
+            double k = floor(x+0.5);
+            if (k < 1.0) k = 1.0;
+            else if (k > count) k = count;
+            if (k-x <= squeeze || value >= Integral(k+0.5)-H(k)) return static_cast<T>(k);
+            return T(0);
+        }
+    public:
+        static constexpr size_t VALUES_PER_BLOCK = 1;
+
+        ZipfDistribution(T n, double s = 1.0, uint64_t seed = 0, uint32_t stream = 0):
+            RandomDistribution<ZipfDistribution<T>, T>(seed, stream), count(static_cast<double>(n)), exponent(s) {
+            if (n < T(1)) throw invalid_argument("Число значений распределения Ципфа должно быть положительным!");
+            if (!(s > 0.0)) throw invalid_argument("Показатель распределения Ципфа должен быть положительным!");
+            integralFirst = Integral(1.5)-1.0;
+            integralTotal = Integral(count+0.5);
+            squeeze = 2.0-IntegralInverse(Integral(2.5)-H(2.0));
+        }
+
+        void Block(uint64_t counter, T *out) const {
+            for (uint32_t lane = 0; ; lane++) {
+                auto words = this->engine.Block(counter, lane);
+                T value = Sample(Philox::ToUnit(words[0], words[1]));
+                if (value == T(0)) value = Sample(Philox::ToUnit(words[2], words[3]));
+                if (value != T(0)) {
+                    out[0] = value;
+                    return;
+                }
+            }
+        }
+};
+
+#endif // RANDOM_HPP
@@ -0,0 +1,237 @@
+#ifndef RECURRENCE_HPP
+#define RECURRENCE_HPP
+
+#include <type_traits>
+#include "LazySequence.hpp"
+using namespace std;
+
+
+// Окно рекуррентного соотношения фиксированного порядка (кольцевой буфер)
+template <typename T>
+class RecurrenceWindow {
+    private:
+        DynamicArray<T> ring;
+        size_t head;
+    public:
+        RecurrenceWindow(const Sequence<T> &initial): ring(initial.GetLength()), head(0) {
+            if (initial.GetLength() == 0) throw invalid_argument("Порядок рекуррентного соотношения должен быть положительным!");
+            for (size_t i = 0; i < initial.GetLength(); i++) ring[i] = initial.Get(i);
+        }
+
+        // Декомпозиция
+        size_t GetOrder() const { return ring.GetSize(); }
+
+        size_t GetHead() const { return head; }
+
+        // Элемент окна: 0 - самый старый, GetOrder()-1 - самый новый
+        const T& operator[](size_t index) const {
+            size_t position = head+index;
+            if (position >= ring.GetSize()) position -= ring.GetSize();
+            return ring[position];
+        }
+
+        // Операции
+        void Push(const T &value) {
+            ring[head] = value;
+            head = (head+1 == ring.GetSize()) ? 0 : head+1;
+        }
+
+        void Reset(size_t newHead) {
+            if (newHead >= ring.GetSize()) throw out_of_range("Некорректная позиция окна!");
+            head = newHead;
+        }
+
+        T* GetData() { return &ring[0]; }
+};
+
+
+// Рекуррентная последовательность порядка k с окном из k последних элементов
+template <typename T>
+class Recurrence {
+    public:
+        // Первые k элементов - начальные значения, далее a(n) = func(a(n-k), ..., a(n-1))
+        static shared_ptr<Generator<T>> CreateGenerator(function<T(const RecurrenceWindow<T>&)> func, const Sequence<T> &initial) {
+            auto window = make_shared<RecurrenceWindow<T>>(initial);
+            auto emitted = make_shared<size_t>(0);
+            size_t order = window->GetOrder();
+            function<string()> save = nullptr;
+            function<void(const string&)> load = nullptr;
+            if constexpr (is_trivially_copyable<T>::value) {
+                save = [window, emitted, order]() {
+                    string state(sizeof(size_t)*2+order*sizeof(T), '\0');
+                    size_t head = window->GetHead();
+                    memcpy(&state[0], emitted.get(), sizeof(size_t));
+                    memcpy(&state[sizeof(size_t)], &head, sizeof(size_t));
+                    memcpy(&state[sizeof(size_t)*2], window->GetData(), order*sizeof(T));
+                    return state;
+                };
+                load = [window, emitted, order](const string &state) {
+                    if (state.size() != sizeof(size_t)*2+order*sizeof(T)) throw runtime_error("Некорректное состояние генератора!");
+                    size_t head;
+                    memcpy(emitted.get(), &state[0], sizeof(size_t));
+                    memcpy(&head, &state[sizeof(size_t)], sizeof(size_t));
+                    memcpy(window->GetData(), &state[sizeof(size_t)*2], order*sizeof(T));
+                    window->Reset(head);
+                };
+            }
+            return make_shared<Generator<T>>(
+                [window, emitted, order, func]() -> T {
+                    if (*emitted < order) return (*window)[(*emitted)++];
+                    T value = func(*window);
+                    window->Push(value);
+                    (*emitted)++;
+                    return value;
+                },
+                []() { return true; },
+                save,
+                load
+            );
+        }
+
+        static shared_ptr<LazySequence<T>> Create(function<T(const RecurrenceWindow<T>&)> func, const Sequence<T> &initial) {
+            return make_shared<LazySequence<T>>(CreateGenerator(func, initial), Cardinal::Infinite());
+        }
+};
+
+
+// Линейная рекуррента a(n) = c(0)*a(n-1)+c(1)*a(n-2)+...+c(k-1)*a(n-k) с переходом через степень матрицы.
+// Целые типы без модуля считаются с проверкой: переполнение - исключение overflow_error
+template <typename T>
+class LinearRecurrence {
+    private:
+        DynamicArray<T> coefficients;
+        DynamicArray<T> initial;
+        T modulus;
+
+        T Normalize(T value) const {
+            if constexpr (is_integral<T>::value) {
+                if (modulus != T(0)) {
+                    value %= modulus;
+                    if (value < T(0)) value += modulus;
+                }
+            }
+            return value;
+        }
+
+        // Целые по модулю хранятся в [0, modulus): сумма сравнивается с остатком до модуля,
+        // а произведение считается в 128 битах, так что промежуточные значения не переполняются
+        T Add(T left, T right) const {
+            if constexpr (is_integral<T>::value) {
+                if (modulus != T(0)) return (left >= modulus-right) ? left-(modulus-right) : left+right;
+                T sum;
+                if (__builtin_add_overflow(left, right, &sum)) throw overflow_error("Переполнение линейной рекурренты: задайте модуль!");
+                return sum;
+            } else {
+                return left+right;
+            }
+        }
+
+        T Multiply(T left, T right) const {
+            if constexpr (is_integral<T>::value) {
+                if (modulus != T(0)) {
+                    uint64_t a = static_cast<uint64_t>(left), b = static_cast<uint64_t>(right), m = static_cast<uint64_t>(modulus);
+#ifdef __SIZEOF_INT128__
+                    return static_cast<T>(static_cast<unsigned __int128>(a)*b % m);
+#else
+                    // Умножение сложением с удвоением, без выхода за 64 бита
+                    uint64_t product = 0;
+                    for (; b; b >>= 1) {
+                        if (b & 1) product = (product >= m-a) ? product-(m-a) : product+a;
+                        a = (a >= m-a) ? a-(m-a) : a+a;
+                    }
+                    return static_cast<T>(product);
+#endif
+                }
+                T product;
+                if (__builtin_mul_overflow(left, right, &product)) throw overflow_error("Переполнение линейной рекурренты: задайте модуль!");
+                return product;
+            } else {
+                return left*right;
+            }
+        }
+
+        // Произведение матриц порядка k
+        DynamicArray<T> Multiply(const DynamicArray<T> &a, const DynamicArray<T> &b) const {
+            size_t order = coefficients.GetSize();
+            DynamicArray<T> result(order*order);
+            for (size_t i = 0; i < order*order; i++) result[i] = T(0);
+            for (size_t i = 0; i < order; i++) {
+                for (size_t l = 0; l < order; l++) {
+                    T left = a[i*order+l];
+                    if (left == T(0)) continue;
+                    for (size_t j = 0; j < order; j++) {
+                        result[i*order+j] = Add(result[i*order+j], Multiply(left, b[l*order+j]));
+                    }
+                }
+            }
+            return result;
+        }
+    public:
+        LinearRecurrence(const Sequence<T> &coeffs, const Sequence<T> &init, T mod = T(0)):
+            coefficients(coeffs.GetLength()), initial(init.GetLength()), modulus(mod) {
+            if (modulus < T(0)) throw invalid_argument("Модуль рекурренты должен быть положительным!");
+            if (coeffs.GetLength() == 0 || coeffs.GetLength() != init.GetLength()) {
+                throw invalid_argument("Число коэффициентов должно совпадать с числом начальных значений!");
+            }
+            for (size_t i = 0; i < coeffs.GetLength(); i++) {
+                coefficients[i] = Normalize(coeffs.Get(i));
+                initial[i] = Normalize(init.Get(i));
+            }
+        }
+
+        size_t GetOrder() const { return coefficients.GetSize(); }
+
+        // Значение a(n) за O(k^3 log n)
+        T At(size_t n) const {
+            size_t order = coefficients.GetSize();
+            if (n < order) return initial[n];
+            DynamicArray<T> power(order*order);
+            DynamicArray<T> result(order*order);
+            for (size_t i = 0; i < order*order; i++) {
+                power[i] = T(0);
+                result[i] = T(0);
+            }
+            for (size_t j = 0; j < order; j++) power[j] = coefficients[j];
+            for (size_t i = 1; i < order; i++) power[i*order+i-1] = T(1);
+            for (size_t i = 0; i < order; i++) result[i*order+i] = T(1);
+            size_t steps = n-order+1;
+            while (steps) {
+                if (steps & 1) result = Multiply(result, power);
+                steps >>= 1;
+                if (steps) power = Multiply(power, power);
+            }
+            // Вектор состояния (a(k-1), a(k-2), ..., a(0))
+            T value = T(0);
+            for (size_t j = 0; j < order; j++) {
+                value = Add(value, Multiply(result[j], initial[order-1-j]));
+            }
+            return value;
+        }
+
+        // Последовательный генератор с окном из k элементов
+        shared_ptr<Generator<T>> CreateGenerator() const {
+            auto self = *this;
+            return Recurrence<T>::CreateGenerator(
+                [self](const RecurrenceWindow<T> &window) -> T {
+                    size_t order = window.GetOrder();
+                    T value = T(0);
+                    for (size_t j = 0; j < order; j++) {
+                        value = self.Add(value, self.Multiply(self.coefficients[j], window[order-1-j]));
+                    }
+                    return value;
+                },
+                LazySequence<T>(initial)
+            );
+        }
+
+        shared_ptr<LazySequence<T>> ToLazySequence() const {
+            auto self = *this;
+            return make_shared<LazySequence<T>>(
+                CreateGenerator(),
+                [self](size_t n) { return self.At(n); },
+                Cardinal::Infinite()
+            );
+        }
+};
+
+#endif // RECURRENCE_HPP
@@ -5,7 +5,9 @@
 #include <vector>
 #include <fstream>
 #include <algorithm>
+#include <charconv>
 #include "LazySequence.hpp"
+#include "sequences/ArraySequence.hpp"
 using namespace std;
 
 
@@ -25,6 +27,37 @@ class Serializer {
         virtual ~Serializer() = default;
 };
 
+// Контрольная точка чтения: номер записи, смещение её начала в файле и состояние генератора
+struct StreamCheckpoint {
+    static constexpr uint64_t NO_OFFSET = UINT64_MAX;
+
+    size_t record = 0;
+    uint64_t offset = NO_OFFSET;
+    string state;
+
+    string Serialize() const {
+        uint64_t header[3] = {static_cast<uint64_t>(record), offset, static_cast<uint64_t>(state.size())};
+        string result("STRMCP1", 8);
+        result.append(reinterpret_cast<const char*>(header), sizeof(header));
+        result += state;
+        return result;
+    }
+
+    static StreamCheckpoint Deserialize(const string &data) {
+        uint64_t header[3];
+        if (data.size() < 8+sizeof(header) || data.compare(0, 8, string("STRMCP1", 8)) != 0) {
+            throw runtime_error("Некорректная контрольная точка потока!");
+        }
+        memcpy(header, data.data()+8, sizeof(header));
+        if (data.size() != 8+sizeof(header)+header[2]) throw runtime_error("Некорректная контрольная точка потока!");
+        StreamCheckpoint checkpoint;
+        checkpoint.record = static_cast<size_t>(header[0]);
+        checkpoint.offset = header[1];
+        checkpoint.state = data.substr(8+sizeof(header));
+        return checkpoint;
+    }
+};
+
 // Интерфейс основного потока
 template <typename T>
 class Stream {
@@ -56,30 +89,115 @@ class ReadableStream: virtual public Stream<T> {
         virtual T Peek() const = 0;
         virtual T Read() = 0;
         virtual size_t Seek(size_t index) = 0;
+
+        // Контрольная точка текущей позиции; по умолчанию восстанавливается обычным Seek
+        virtual StreamCheckpoint GetCheckpoint() {
+            StreamCheckpoint checkpoint;
+            checkpoint.record = this->position;
+            return checkpoint;
+        }
+
+        virtual size_t Seek(const StreamCheckpoint &checkpoint) {
+            return Seek(checkpoint.record);
+        }
+
         virtual shared_ptr<DynamicArray<T>> ReadBlock(size_t count) {
             auto block = make_shared<DynamicArray<T>>(count);
+            size_t actualCount = count ? ReadBlock(&(*block)[0], count) : 0;
+            if (actualCount < count) block->Resize(actualCount);
+            return block;
+        }
+
+        // Чтение в буфер вызывающего без выделения памяти; возвращает число прочитанных элементов.
+        // Реализация по умолчанию читает поэлементно, потоки переопределяют её блочным чтением
+        virtual size_t ReadBlock(T *buffer, size_t count) {
             size_t actualCount = 0;
-            for (size_t i = 0; i < count && !IsEndOfStream(); i++) {
+            for (; actualCount < count && !IsEndOfStream(); actualCount++) {
                 try {
-                    block->Set(i, Read());
-                    actualCount++;
+                    buffer[actualCount] = Read();
                 } catch (...) {
                     break;
                 }
             }
-            if (actualCount < count) block->Resize(actualCount);
-            return block;
+            return actualCount;
+        }
+
+        // k первых в порядке cmp элементов от текущей позиции до конца потока, память O(k)
+        shared_ptr<DynamicArray<T>> TopK(size_t k, function<bool(const T&, const T&)> cmp = less<T>()) {
+            TopKHeap<T, function<bool(const T&, const T&)>> heap(k, cmp);
+            while (!IsEndOfStream()) heap.Push(Read());
+            vector<T> sorted = heap.GetSorted();
+            auto result = make_shared<DynamicArray<T>>(sorted.size());
+            for (size_t i = 0; i < sorted.size(); i++) (*result)[i] = move(sorted[i]);
+            return result;
+        }
+
+        // Элемент на позиции n в порядке cmp среди оставшихся в потоке, память O(n)
+        virtual T NthElement(size_t n, function<bool(const T&, const T&)> cmp = less<T>()) {
+            auto top = TopK(n+1, cmp);
+            if (top->GetSize() <= n) throw out_of_range("Некорректный индекс!");
+            return (*top)[n];
         }
 };
 
+// Запись последовательности блоками через WriteBlock: элементы собираются в буфер по WRITE_BLOCK_SIZE штук
+const size_t WRITE_BLOCK_SIZE = 4096;
+
 // Интерфейс потока для записи
 template <typename T>
 class WritableStream: virtual public Stream<T> {
+    protected:
+        // Запись блоками по оценке длины: при конечной длине недостающий элемент - ошибка, иначе конец
+        size_t WriteInBlocks(Sequence<T> *seq, Cardinal hint) {
+            vector<T> chunk(WRITE_BLOCK_SIZE);
+            size_t filled = 0;
+            size_t position = this->GetPosition();
+            for (size_t i = 0; !hint.IsFinite() || i < hint.GetFiniteValue(); i++) {
+                try {
+                    chunk[filled] = seq->Get(i);
+                } catch (const out_of_range&) {
+                    if (hint.IsFinite()) throw;
+                    break;
+                }
+                if (++filled == WRITE_BLOCK_SIZE) {
+                    position = WriteBlock(chunk.data(), filled);
+                    filled = 0;
+                }
+            }
+            if (filled) position = WriteBlock(chunk.data(), filled);
+            return position;
+        }
+
+        // Общая реализация WriteAll: бесконечная последовательность отвергается, конечная LazySequence
+        // вычисляется заранее (prefetch = false - для приёмников, которым история не нужна)
+        size_t WriteAllInBlocks(shared_ptr<Sequence<T>> seq, bool prefetch = true) {
+            if (!this->isOpen) throw runtime_error("Поток не открыт!");
+            Cardinal hint = GetSizeHint(seq.get());
+            if (hint.IsInfinite()) throw runtime_error("Нельзя записать бесконечную последовательность!");
+            if (prefetch && hint.IsFinite()) PrefetchSequence(seq.get());
+            return WriteInBlocks(seq.get(), hint);
+        }
     public:
         virtual ~WritableStream() = default;
         virtual size_t Write(const T &item) = 0;
         virtual size_t WriteAll(shared_ptr<Sequence<T>> seq) = 0;
-        virtual size_t WriteBlock(shared_ptr<DynamicArray<T>> arr) = 0;
+
+        virtual size_t WriteBlock(shared_ptr<DynamicArray<T>> arr) {
+            return WriteBlock(arr->GetSize() ? &(*arr)[0] : nullptr, arr->GetSize());
+        }
+
+        // Запись из буфера вызывающего; реализация по умолчанию пишет поэлементно
+        virtual size_t WriteBlock(const T *items, size_t count) {
+            for (size_t i = 0; i < count; i++) Write(items[i]);
+            return this->position;
+        }
+};
+
+// Заголовок файла индекса строк: размер и время изменения файла, для которого индекс построен
+struct LineIndexHeader {
+    char magic[8];
+    uint64_t fileSize;
+    int64_t modified;
 };
 
 // Класс потока для чтения
@@ -91,6 +209,98 @@ class ReadOnlyStream: public ReadableStream<T> {
         ifstream fileStream;
         bool canSeek;
         bool canGoBack;
+        // Файловый режим: номер первой записи data, смещения последней прочитанной и следующей строки
+        size_t base = 0;
+        uint64_t lineOffset = 0;
+        uint64_t nextLineOffset = 0;
+        shared_ptr<DeltaIndex> lineOffsets;
+        // Индекс строк на диске: при актуальном индексе записи читаются по смещению из отображения файла
+        string filename;
+        string indexFilename;
+        FileStamp stamp;
+        bool indexed = false;
+        bool indexSaved = false;
+
+        bool IsFileMode() const { return fileStream.is_open() && deserializer; }
+
+        bool LoadLineIndex() {
+            try {
+                MappedFile sidecar(indexFilename);
+                LineIndexHeader header;
+                if (sidecar.GetSize() < sizeof(header)) return false;
+                memcpy(&header, sidecar.GetData(), sizeof(header));
+                if (memcmp(header.magic, "LZLIDX1", 8) != 0 || header.fileSize != stamp.size || header.modified != stamp.modified) return false;
+                lineOffsets = make_shared<DeltaIndex>(DeltaIndex::Deserialize(sidecar.GetData()+sizeof(header), sidecar.GetSize()-sizeof(header)));
+            } catch (const exception&) {
+                // Отсутствующий или повреждённый индекс строится заново
+                return false;
+            }
+            auto source = make_shared<MappedFile>(filename);
+            if (source->GetSize() != stamp.size) return false;
+            auto offsets = lineOffsets;
+            auto deser = deserializer;
+            auto reader = [source, offsets, deser](size_t index) -> T {
+                uint64_t start = offsets->Get(index);
+                uint64_t end = index+1 < offsets->GetCount() ? offsets->Get(index+1) : source->GetSize();
+                if (end > start && source->GetData()[end-1] == '\n') end--;
+                if (end > start && source->GetData()[end-1] == '\r') end--;
+                return deser->Deserialize(string(source->GetData()+start, static_cast<size_t>(end-start)));
+            };
+            data = make_shared<LazySequence<T>>(reader, Cardinal::Finite(offsets->GetCount()));
+            // Каждое чтение - одно обращение по смещению, кеш прочитанных строк не нужен
+            data->SetStreaming(true);
+            indexed = true;
+            return true;
+        }
+
+        // Сохранение индекса после первого полного прохода файла с начала
+        void SaveLineIndex() {
+            if (indexFilename.empty() || indexSaved || indexed || base != 0 || !lineOffsets) return;
+            indexSaved = true;
+            try {
+                if (GetFileStamp(filename) != stamp) return;
+                LineIndexHeader header;
+                memcpy(header.magic, "LZLIDX1", 8);
+                header.fileSize = stamp.size;
+                header.modified = stamp.modified;
+                string body = lineOffsets->Serialize();
+                ofstream sidecar(indexFilename, ios::binary | ios::trunc);
+                sidecar.write(reinterpret_cast<const char*>(&header), sizeof(header));
+                sidecar.write(body.data(), static_cast<streamsize>(body.size()));
+                sidecar.close();
+                if (!sidecar) remove(indexFilename.c_str());
+            } catch (const exception&) {
+                // Индекс - только ускорение: ошибка его записи не мешает чтению
+            }
+        }
+
+        // Генератор строк файла с текущего смещения; при кешировании запоминаются смещения всех строк
+        void OpenFile() {
+            auto fileReader = [this]() -> T {
+                string line;
+                uint64_t start = this->nextLineOffset;
+                if (getline(this->fileStream, line)) {
+                    this->lineOffset = start;
+                    this->nextLineOffset = start+line.size()+(this->fileStream.eof() ? 0 : 1);
+                    if (!line.empty() && line.back() == '\r') line.pop_back();
+                    if (this->lineOffsets) this->lineOffsets->Append(start);
+                    return this->deserializer->Deserialize(line);
+                }
+                throw runtime_error("Конец файла");
+            };
+            auto hasNext = [this]() -> bool {
+                if (this->fileStream.peek() != char_traits<char>::eof()) return true;
+                this->SaveLineIndex();
+                return false;
+            };
+            this->position = base;
+            indexed = false;
+            if (base == 0 && !indexFilename.empty() && LoadLineIndex()) return;
+            auto gen = make_shared<Generator<T>>(fileReader, hasNext);
+            data = make_shared<LazySequence<T>>(gen, Cardinal::Unknown());
+            data->SetStreaming(!canGoBack);
+            lineOffsets = (canGoBack || !indexFilename.empty()) ? make_shared<DeltaIndex>() : nullptr;
+        }
     public:
         // Конструкторы
         ~ReadOnlyStream() override { try { Close(); } catch (...) {} }
@@ -102,11 +312,22 @@ class ReadOnlyStream: public ReadableStream<T> {
             Stream<T>(), data(lazySeq), deserializer(nullptr), canSeek(true), canGoBack(true) {}
         
         ReadOnlyStream(const string &filename, shared_ptr<Deserializer<T>> deser):
-            Stream<T>(), data(nullptr), deserializer(deser), canSeek(true), canGoBack(true) {
+            Stream<T>(), data(nullptr), deserializer(deser), canSeek(true), canGoBack(true), filename(filename) {
             if (!deser) throw runtime_error("Десериализатор не может быть пустым!");
-            fileStream.open(filename);
+            // Двоичный режим: смещения строк совпадают с байтами файла при любых переводах строк
+            fileStream.open(filename, ios::binary);
             if (!fileStream.is_open()) throw runtime_error("Невозможно открыть файл: " + filename);
         }
+
+        // Продолжение чтения файла с контрольной точки без повторного разбора предыдущих строк
+        ReadOnlyStream(const string &filename, shared_ptr<Deserializer<T>> deser, const StreamCheckpoint &checkpoint):
+            ReadOnlyStream(filename, deser) {
+            if (checkpoint.offset == StreamCheckpoint::NO_OFFSET) throw invalid_argument("Контрольная точка не содержит смещения в файле!");
+            fileStream.seekg(static_cast<streamoff>(checkpoint.offset));
+            if (!fileStream) throw runtime_error("Некорректное смещение контрольной точки!");
+            base = checkpoint.record;
+            lineOffset = nextLineOffset = checkpoint.offset;
+        }
         
         ReadOnlyStream(const string &dataString, shared_ptr<Deserializer<T>> deser, char delimiter):
             Stream<T>(), data(nullptr), deserializer(deser), canSeek(true), canGoBack(true) {
@@ -154,10 +375,10 @@ class ReadOnlyStream: public ReadableStream<T> {
             if (!this->isOpen) return true;
             if (data) {
                 try {
-                    return this->position >= data->GetLength();
+                    return this->position-base >= data->GetLength();
                 } catch (const runtime_error &e) {
                     try {
-                        data->Get(this->position);
+                        data->Get(this->position-base);
                         return false;
                     } catch (const out_of_range&) {
                         return true;
@@ -172,14 +393,14 @@ class ReadOnlyStream: public ReadableStream<T> {
         T Peek() const override {
             if (!this->isOpen) throw runtime_error("Поток не открыт!");
             if (IsEndOfStream()) throw runtime_error("Достигнут конец потока!");
-            return data->Get(this->position);
+            return data->Get(this->position-base);
         }
         
         T Read() override {
             if (!this->isOpen) throw runtime_error("Поток не открыт!");
             if (IsEndOfStream()) throw runtime_error("Достигнут конец потока!");
             try {
-                T item = data->Get(this->position);
+                T item = data->Extract(this->position-base);
                 this->position++;
                 return item;
             } catch (const out_of_range &e) {
@@ -187,40 +408,124 @@ class ReadOnlyStream: public ReadableStream<T> {
             }
         }
 
+        using ReadableStream<T>::ReadBlock;
+
+        // Остаток вычисленной или адресуемой по индексу последовательности выбирается quickselect без кучи
+        T NthElement(size_t n, function<bool(const T&, const T&)> cmp = less<T>()) override {
+            if (!this->isOpen) throw runtime_error("Поток не открыт!");
+            if (!data || !data->GetCardinal().IsFinite()) return ReadableStream<T>::NthElement(n, cmp);
+            size_t count = data->GetLength();
+            bool cached = !data->IsStreaming() && data->GetMaterializedCount() >= count;
+            if (!data->IsIndexAddressable() && !cached) return ReadableStream<T>::NthElement(n, cmp);
+            auto rest = unique_ptr<LazySequence<T>>(data->Skip(this->position-base));
+            this->position = base+count;
+            return rest->NthElement(n, cmp);
+        }
+
+        // Блок копируется из кеша последовательности, который дополняется одним проходом генератора
+        size_t ReadBlock(T *buffer, size_t count) override {
+            if (!this->isOpen) throw runtime_error("Поток не открыт!");
+            if (!data) return 0;
+            size_t copied = data->CopyTo(this->position-base, buffer, count);
+            this->position += copied;
+            return copied;
+        }
+
         size_t Seek(size_t index) override {
             if (!this->isOpen) throw runtime_error("Поток не открыт!");
             if (!IsCanSeek()) throw runtime_error("Перемещение по потоку не поддерживается!");
+            if (index < this->position && !IsCanGoBack()) throw runtime_error("Перемещение назад в потоковом режиме не поддерживается!");
+            if (index < base) throw out_of_range("Позиция предшествует контрольной точке, с которой начато чтение!");
             if (data) {
                 try {
-                    if (index >= data->GetLength()) throw out_of_range("Индекс за пределами потока!");
+                    if (index-base >= data->GetLength()) throw out_of_range("Индекс за пределами потока!");
                 } catch (const runtime_error&) {}
             }
             this->position = index;
             return this->position;
         }
 
+        // Возврат к контрольной точке: для файла O(1) переходом по смещению, для генератора - загрузкой состояния
+        size_t Seek(const StreamCheckpoint &checkpoint) override {
+            if (!this->isOpen) throw runtime_error("Поток не открыт!");
+            if (IsFileMode() && checkpoint.offset != StreamCheckpoint::NO_OFFSET) {
+                fileStream.clear();
+                fileStream.seekg(static_cast<streamoff>(checkpoint.offset));
+                if (!fileStream) throw runtime_error("Некорректное смещение контрольной точки!");
+                base = checkpoint.record;
+                lineOffset = nextLineOffset = checkpoint.offset;
+                OpenFile();
+                return this->position;
+            }
+            if (!checkpoint.state.empty()) {
+                if (checkpoint.record < base) throw out_of_range("Позиция предшествует контрольной точке, с которой начато чтение!");
+                data->ResumeGenerator(checkpoint.record-base, checkpoint.state);
+                this->position = checkpoint.record;
+                return this->position;
+            }
+            return Seek(checkpoint.record);
+        }
+
+        // Контрольная точка текущей позиции: смещение строки в файле или состояние генератора потоковой последовательности
+        StreamCheckpoint GetCheckpoint() override {
+            StreamCheckpoint checkpoint;
+            checkpoint.record = this->position;
+            if (!this->isOpen || !data) return checkpoint;
+            size_t index = this->position-base;
+            size_t generated = data->GetMaterializedCount();
+            if (IsFileMode() && indexed) {
+                checkpoint.offset = index < lineOffsets->GetCount() ? lineOffsets->Get(index) : stamp.size;
+                return checkpoint;
+            }
+            if (IsFileMode()) {
+                if (index > generated) {
+                    data->Get(index-1);
+                    generated = data->GetMaterializedCount();
+                }
+                if (index == generated) checkpoint.offset = nextLineOffset;
+                else if (lineOffsets && index < lineOffsets->GetCount()) checkpoint.offset = lineOffsets->Get(index);
+                else if (index+1 == generated) checkpoint.offset = lineOffset;
+                else throw runtime_error("Смещение записи в файле недоступно!");
+                return checkpoint;
+            }
+            if (data->IsStreaming() && !data->IsIndexAddressable()) {
+                if (index != generated) throw runtime_error("Генератор уже прочитал элементы после позиции контрольной точки!");
+                checkpoint.state = data->SaveGeneratorState();
+            }
+            return checkpoint;
+        }
+
         shared_ptr<LazySequence<T>> GetData() const { return data; }
 
+        // Записи читаются через сохранённый индекс строк
+        bool IsLineIndexed() const { return indexed; }
+
         // Операции
+        // Однопроходное чтение без истории: прочитанные элементы не хранятся, возврат назад запрещён
+        void SetStreaming(bool enabled) {
+            if (data && !indexed) data->SetStreaming(enabled);
+            canGoBack = !enabled;
+        }
+
+        // Индекс смещений строк в отдельном файле (по умолчанию - рядом с данными, с суффиксом .lidx):
+        // строится при первом полном проходе, при следующих открытиях Seek и Read не читают предыдущие строки.
+        // Индекс не используется, если размер или время изменения файла отличаются от сохранённых
+        void UseLineIndex(const string &path = "") {
+            if (!IsFileMode()) throw runtime_error("Индекс строк доступен только для файлового потока!");
+            if (this->isOpen) throw runtime_error("Индекс строк подключается до открытия потока!");
+            indexFilename = path.empty() ? filename+".lidx" : path;
+            stamp = GetFileStamp(filename);
+            indexSaved = false;
+        }
+
         void Open() override {
             if (this->isOpen) return;
             if (data) {
                 this->isOpen = true;
                 return;
             }
-            if (fileStream.is_open() && deserializer) {
-                auto fileReader = [this]() -> T {
-                    string line;
-                    if (getline(this->fileStream, line)) {
-                        return this->deserializer->Deserialize(line);
-                    }
-                    throw runtime_error("Конец файла");
-                };
-                auto hasNext = [this]() -> bool {
-                    return this->fileStream && !this->fileStream.eof();
-                };
-                auto gen = make_shared<Generator<T>>(fileReader, hasNext);
-                data = make_shared<LazySequence<T>>(gen);
+            if (IsFileMode()) {
+                OpenFile();
                 this->isOpen = true;
                 return;
             }
@@ -245,7 +550,19 @@ class WriteOnlyStream: public WritableStream<T> {
         shared_ptr<Serializer<T>> serializer;
         ofstream fileStream;
         size_t bufferSize;
+        shared_ptr<AsyncFileWriter> asyncWriter;
+        string pendingBytes;
+        size_t batchBytes;
+
+        void SubmitPending() {
+            if (pendingBytes.empty()) return;
+            asyncWriter->Write(move(pendingBytes));
+            pendingBytes = string();
+            pendingBytes.reserve(batchBytes);
+        }
     public:
+        static constexpr size_t ASYNC_BATCH_BYTES = 1 << 20;
+
         // Конструкторы
         ~WriteOnlyStream() override { try { Close(); } catch (...) {} }
 
@@ -259,14 +576,23 @@ class WriteOnlyStream: public WritableStream<T> {
             if (!fileStream.is_open()) throw runtime_error("Невозможно открыть файл: " + filename);
         }
 
+        // Файл с отложенной записью: строки копятся в пакеты по batch байт, в полёте не больше inFlight пакетов
+        WriteOnlyStream(const string &filename, shared_ptr<Serializer<T>> ser, size_t inFlight, size_t batch = ASYNC_BATCH_BYTES):
+            Stream<T>(), outputBuffer(nullptr), serializer(ser), bufferSize(0), batchBytes(max<size_t>(batch, 1)) {
+            if (!ser) throw runtime_error("Сериализатор не может быть пустым!");
+            asyncWriter = make_shared<AsyncFileWriter>(filename, inFlight);
+            pendingBytes.reserve(batchBytes);
+        }
+
         // Декомпозиция
         size_t GetBufferSize() const { return bufferSize; }
         shared_ptr<DynamicArray<T>> GetBuffer() const { return outputBuffer; }
+        bool IsAsync() const { return static_cast<bool>(asyncWriter); }
 
         // Операции
         void Open() override {
             if (this->isOpen) return;
-            if (outputBuffer || (fileStream.is_open() && serializer)) {
+            if (outputBuffer || (fileStream.is_open() && serializer) || (asyncWriter && asyncWriter->IsOpen())) {
                 this->isOpen = true;
                 return;
             }
@@ -275,11 +601,26 @@ class WriteOnlyStream: public WritableStream<T> {
         
         void Close() override {
             if (!this->isOpen) return;
+            this->isOpen = false;
+            this->position = 0;
             if (fileStream.is_open()) {
                 fileStream.close();
             }
-            this->isOpen = false;
-            this->position = 0;
+            if (asyncWriter) {
+                SubmitPending();
+                asyncWriter->Close();
+            }
+        }
+
+        // Ожидание записи всех переданных элементов
+        void Flush() {
+            if (!this->isOpen) throw runtime_error("Поток не открыт!");
+            if (asyncWriter) {
+                SubmitPending();
+                asyncWriter->Flush();
+            } else if (fileStream.is_open()) {
+                fileStream.flush();
+            }
         }
         
         size_t Write(const T &item) override {
@@ -292,26 +633,75 @@ class WriteOnlyStream: public WritableStream<T> {
                     outputBuffer->Set(bufferSize, item);
                     bufferSize++;
                 }
+            } else if (asyncWriter) {
+                pendingBytes += serializer->Serialize(item);
+                pendingBytes += '\n';
+                if (pendingBytes.size() >= batchBytes) SubmitPending();
             } else if (fileStream.is_open() && serializer) {
-                fileStream << serializer->Serialize(item) << endl;
+                fileStream << serializer->Serialize(item) << '\n';
                 if (!fileStream.good()) throw runtime_error("Ошибка записи в файл");
             }
             this->position++;
             return this->position;
         }
 
-        size_t WriteAll(shared_ptr<Sequence<T>> seq) override {
-            for (size_t i = 0; i < seq->GetLength(); i++) {
-                Write(seq->Get(i));
+        using WritableStream<T>::WriteBlock;
+
+        // Буфер расширяется один раз на весь блок, в файл блок пишется одной строкой
+        size_t WriteBlock(const T *items, size_t count) override {
+            if (!this->isOpen) throw runtime_error("Поток не открыт!");
+            if (count == 0) return this->position;
+            if (outputBuffer) {
+                if (this->position+count > bufferSize) {
+                    outputBuffer->Resize(this->position+count);
+                    bufferSize = this->position+count;
+                }
+                copy(items, items+count, &(*outputBuffer)[this->position]);
+            } else if (asyncWriter) {
+                for (size_t i = 0; i < count; i++) {
+                    pendingBytes += serializer->Serialize(items[i]);
+                    pendingBytes += '\n';
+                    if (pendingBytes.size() >= batchBytes) SubmitPending();
+                }
+            } else if (fileStream.is_open() && serializer) {
+                string lines;
+                for (size_t i = 0; i < count; i++) {
+                    lines += serializer->Serialize(items[i]);
+                    lines += '\n';
+                }
+                fileStream.write(lines.data(), static_cast<streamsize>(lines.size()));
+                if (!fileStream.good()) throw runtime_error("Ошибка записи в файл");
             }
+            this->position += count;
             return this->position;
         }
 
-        size_t WriteBlock(shared_ptr<DynamicArray<T>> arr) override {
-            for (size_t i = 0; i < arr->GetSize(); i++) {
-                Write(arr->Get(i));
+        size_t WriteAll(shared_ptr<Sequence<T>> seq) override {
+            if (!this->isOpen) throw runtime_error("Поток не открыт!");
+            Cardinal hint = GetSizeHint(seq.get());
+            if (hint.IsInfinite()) throw runtime_error("Нельзя записать бесконечную последовательность!");
+            if (hint.IsFinite()) PrefetchSequence(seq.get());
+            if (outputBuffer && hint.HasUpperBound()) {
+                // Одно выделение памяти по верхней оценке длины
+                size_t limit = hint.GetUpperBound();
+                if (this->position+limit > bufferSize) outputBuffer->Resize(this->position+limit);
+                for (size_t i = 0; i < limit; i++) {
+                    if (hint.IsFinite()) {
+                        (*outputBuffer)[this->position] = seq->Get(i);
+                    } else {
+                        try {
+                            (*outputBuffer)[this->position] = seq->Get(i);
+                        } catch (const out_of_range&) {
+                            break;
+                        }
+                    }
+                    this->position++;
+                }
+                bufferSize = max(bufferSize, this->position);
+                if (outputBuffer->GetSize() > bufferSize) outputBuffer->Resize(bufferSize);
+                return this->position;
             }
-            return this->position;
+            return this->WriteInBlocks(seq.get(), hint);
         }
 };
 
@@ -411,6 +801,18 @@ class ReadWriteStream: public ReadableStream<T>, public WritableStream<T> {
             }
         }
 
+        using ReadableStream<T>::ReadBlock;
+
+        size_t ReadBlock(T *buffer, size_t count) override {
+            if (!this->isOpen) throw runtime_error("Поток не открыт!");
+            if (!readData) return 0;
+            size_t copied = readData->CopyTo(this->position, buffer, count);
+            this->position += copied;
+            return copied;
+        }
+
+        using ReadableStream<T>::Seek;
+
         size_t Seek(size_t index) override {
             if (!this->isOpen) throw runtime_error("Поток не открыт!");
             if (!IsCanSeek()) throw runtime_error("Перемещение не поддерживается!");
@@ -471,15 +873,21 @@ class ReadWriteStream: public ReadableStream<T>, public WritableStream<T> {
         }
 
         size_t Write(const T &item) override {
+            return WriteBlock(&item, 1);
+        }
+
+        using WritableStream<T>::WriteBlock;
+
+        // Файл перечитывается и переписывается один раз на весь блок
+        size_t WriteBlock(const T *items, size_t count) override {
             if (!this->isOpen) throw runtime_error("Поток не открыт!");
+            if (count == 0) return this->position;
             if (writeBuffer) {
-                if (this->position < writeBufferSize) {
-                    writeBuffer->Set(this->position, item);
-                } else {
-                    writeBuffer->Resize(writeBufferSize + 1);
-                    writeBuffer->Set(writeBufferSize, item);
-                    writeBufferSize++;
+                if (this->position+count > writeBufferSize) {
+                    writeBuffer->Resize(this->position+count);
+                    writeBufferSize = this->position+count;
                 }
+                copy(items, items+count, &(*writeBuffer)[this->position]);
             } else if (isFileMode && serializer) {
                 size_t writePos = this->position;
                 vector<string> lines;
@@ -489,15 +897,17 @@ class ReadWriteStream: public ReadableStream<T>, public WritableStream<T> {
                 while (getline(fileStream, line)) {
                     lines.push_back(line);
                 }
-                if (writePos >= lines.size()) {
-                    lines.resize(writePos+1);
+                if (writePos+count > lines.size()) {
+                    lines.resize(writePos+count);
+                }
+                for (size_t i = 0; i < count; i++) {
+                    lines[writePos+i] = serializer->Serialize(items[i]);
                 }
-                lines[writePos] = serializer->Serialize(item);
                 fileStream.close();
                 fileStream.open(filename, ios::out | ios::trunc);
                 if (!fileStream.is_open()) throw runtime_error("Не удалось открыть файл для записи: " + filename);
                 for (const auto &l : lines) {
-                    fileStream << l << endl;
+                    fileStream << l << '\n';
                 }
                 fileStream.flush();
                 fileStream.close();
@@ -505,25 +915,306 @@ class ReadWriteStream: public ReadableStream<T>, public WritableStream<T> {
                 if (!fileStream.is_open()) throw runtime_error("Не удалось открыть файл для записи: " + filename);
                 ReloadFileData();
             }
-            this->position++;
+            this->position += count;
             return this->position;
         }
 
         size_t WriteAll(shared_ptr<Sequence<T>> seq) override {
-            for (size_t i = 0; i < seq->GetLength(); i++) {
-                Write(seq->Get(i));
+            if (!this->isOpen) throw runtime_error("Поток не открыт!");
+            Cardinal hint = GetSizeHint(seq.get());
+            if (hint.IsInfinite()) throw runtime_error("Нельзя записать бесконечную последовательность!");
+            if (hint.IsFinite()) PrefetchSequence(seq.get());
+            if (writeBuffer && hint.HasUpperBound()) {
+                // Одно выделение памяти по верхней оценке длины
+                size_t limit = hint.GetUpperBound();
+                if (this->position+limit > writeBufferSize) writeBuffer->Resize(this->position+limit);
+                for (size_t i = 0; i < limit; i++) {
+                    if (hint.IsFinite()) {
+                        (*writeBuffer)[this->position] = seq->Get(i);
+                    } else {
+                        try {
+                            (*writeBuffer)[this->position] = seq->Get(i);
+                        } catch (const out_of_range&) {
+                            break;
+                        }
+                    }
+                    this->position++;
+                }
+                writeBufferSize = max(writeBufferSize, this->position);
+                if (writeBuffer->GetSize() > writeBufferSize) writeBuffer->Resize(writeBufferSize);
+                return this->position;
             }
+            return this->WriteInBlocks(seq.get(), hint);
+        }
+};
+
+// Двоичный формат записей фиксированной ширины: заголовок с тегом типа и шириной, затем записи в little-endian
+struct BinaryStreamHeader {
+    char magic[8];
+    uint32_t typeTag;
+    uint32_t recordWidth;
+};
+
+inline bool IsLittleEndianHost() {
+    const uint16_t probe = 1;
+    return *reinterpret_cast<const uint8_t*>(&probe) == 1;
+}
+
+// Тег типа: вид (1 - беззнаковое целое, 2 - знаковое, 3 - вещественное, 4 - прочий тривиально копируемый) и размер
+template <typename T>
+uint32_t BinaryTypeTag() {
+    static_assert(is_trivially_copyable<T>::value, "Двоичный формат поддерживается только для тривиально копируемых типов!");
+    uint32_t kind = is_floating_point<T>::value ? 3 : (is_integral<T>::value ? (is_signed<T>::value ? 2 : 1) : 4);
+    return (kind << 24) | static_cast<uint32_t>(sizeof(T));
+}
+
+// Перестановка байтов чисел на big-endian платформах (в обе стороны); составные типы хранятся как есть
+template <typename T>
+void SwapLittleEndian(T *items, size_t count) {
+    if constexpr (is_arithmetic<T>::value && sizeof(T) > 1) {
+        if (IsLittleEndianHost()) return;
+        for (size_t i = 0; i < count; i++) {
+            uint8_t *bytes = reinterpret_cast<uint8_t*>(items+i);
+            reverse(bytes, bytes+sizeof(T));
+        }
+    }
+}
+
+// Класс потока для чтения двоичных записей: Seek вычисляется смещением, блок читается одним вызовом read
+template <typename T>
+class BinaryReadOnlyStream: public ReadableStream<T> {
+    protected:
+        mutable ifstream fileStream;
+        size_t count;
+        mutable bool positioned;
+
+        static constexpr uint64_t HEADER_SIZE = sizeof(BinaryStreamHeader);
+
+        void Position() const {
+            if (positioned) return;
+            fileStream.clear();
+            fileStream.seekg(static_cast<streamoff>(HEADER_SIZE+this->position*sizeof(T)));
+            positioned = true;
+        }
+    public:
+        // Конструкторы
+        ~BinaryReadOnlyStream() override { try { Close(); } catch (...) {} }
+
+        explicit BinaryReadOnlyStream(const string &filename): Stream<T>(), count(0), positioned(false) {
+            fileStream.open(filename, ios::binary);
+            if (!fileStream.is_open()) throw runtime_error("Невозможно открыть файл: " + filename);
+            BinaryStreamHeader header;
+            if (!fileStream.read(reinterpret_cast<char*>(&header), sizeof(header))) throw runtime_error("Повреждённый двоичный файл: " + filename);
+            SwapLittleEndian(&header.typeTag, 1);
+            SwapLittleEndian(&header.recordWidth, 1);
+            if (memcmp(header.magic, "LZBREC1", 8) != 0) throw runtime_error("Файл не является двоичным потоком: " + filename);
+            if (header.typeTag != BinaryTypeTag<T>() || header.recordWidth != sizeof(T)) {
+                throw runtime_error("Несовместимый тип записей двоичного файла: " + filename);
+            }
+            fileStream.seekg(0, ios::end);
+            uint64_t size = static_cast<uint64_t>(fileStream.tellg());
+            count = static_cast<size_t>((size-HEADER_SIZE)/sizeof(T));
+        }
+
+        // Декомпозиция
+        bool IsCanSeek() const override { return true; }
+
+        bool IsCanGoBack() const override { return true; }
+
+        bool IsEndOfStream() const override {
+            return !this->isOpen || this->position >= count;
+        }
+
+        size_t GetCount() const { return count; }
+
+        T Peek() const override {
+            if (!this->isOpen) throw runtime_error("Поток не открыт!");
+            if (IsEndOfStream()) throw runtime_error("Достигнут конец потока!");
+            Position();
+            T item;
+            fileStream.read(reinterpret_cast<char*>(&item), sizeof(T));
+            if (!fileStream) throw runtime_error("Ошибка чтения файла");
+            fileStream.seekg(-static_cast<streamoff>(sizeof(T)), ios::cur);
+            SwapLittleEndian(&item, 1);
+            return item;
+        }
+
+        T Read() override {
+            if (!this->isOpen) throw runtime_error("Поток не открыт!");
+            if (IsEndOfStream()) throw runtime_error("Достигнут конец потока!");
+            Position();
+            T item;
+            if (!fileStream.read(reinterpret_cast<char*>(&item), sizeof(T))) throw runtime_error("Ошибка чтения файла");
+            SwapLittleEndian(&item, 1);
+            this->position++;
+            return item;
+        }
+
+        size_t Seek(size_t index) override {
+            if (!this->isOpen) throw runtime_error("Поток не открыт!");
+            if (index > count) throw out_of_range("Индекс за пределами потока!");
+            if (index != this->position) positioned = false;
+            this->position = index;
             return this->position;
         }
 
-        size_t WriteBlock(shared_ptr<DynamicArray<T>> arr) override {
-            for (size_t i = 0; i < arr->GetSize(); i++) {
-                Write(arr->Get(i));
+        using ReadableStream<T>::ReadBlock;
+
+        size_t ReadBlock(T *buffer, size_t blockSize) override {
+            if (!this->isOpen) throw runtime_error("Поток не открыт!");
+            size_t available = min(blockSize, count-min(count, this->position));
+            if (available == 0) return 0;
+            Position();
+            if (!fileStream.read(reinterpret_cast<char*>(buffer), static_cast<streamsize>(available*sizeof(T)))) {
+                throw runtime_error("Ошибка чтения файла");
+            }
+            SwapLittleEndian(buffer, available);
+            this->position += available;
+            return available;
+        }
+
+        StreamCheckpoint GetCheckpoint() override {
+            StreamCheckpoint checkpoint;
+            checkpoint.record = this->position;
+            checkpoint.offset = HEADER_SIZE+this->position*sizeof(T);
+            return checkpoint;
+        }
+
+        // Операции
+        void Open() override {
+            if (this->isOpen) return;
+            if (!fileStream.is_open()) throw runtime_error("Не удалось открыть поток: файл закрыт!");
+            this->isOpen = true;
+            positioned = false;
+        }
+
+        void Close() override {
+            if (!this->isOpen) return;
+            fileStream.close();
+            this->isOpen = false;
+            this->position = 0;
+        }
+};
+
+// Класс потока для записи двоичных записей
+template <typename T>
+class BinaryWriteOnlyStream: public WritableStream<T> {
+    protected:
+        ofstream fileStream;
+
+        void WriteRecords(const T *items, size_t itemCount) {
+            if (IsLittleEndianHost() || !is_arithmetic<T>::value) {
+                fileStream.write(reinterpret_cast<const char*>(items), static_cast<streamsize>(itemCount*sizeof(T)));
+            } else {
+                vector<T> swapped(items, items+itemCount);
+                SwapLittleEndian(swapped.data(), itemCount);
+                fileStream.write(reinterpret_cast<const char*>(swapped.data()), static_cast<streamsize>(itemCount*sizeof(T)));
             }
+            if (!fileStream.good()) throw runtime_error("Ошибка записи в файл");
+            this->position += itemCount;
+        }
+    public:
+        // Конструкторы
+        ~BinaryWriteOnlyStream() override { try { Close(); } catch (...) {} }
+
+        explicit BinaryWriteOnlyStream(const string &filename): Stream<T>() {
+            fileStream.open(filename, ios::binary | ios::trunc);
+            if (!fileStream.is_open()) throw runtime_error("Невозможно открыть файл: " + filename);
+            BinaryStreamHeader header;
+            memcpy(header.magic, "LZBREC1", 8);
+            header.typeTag = BinaryTypeTag<T>();
+            header.recordWidth = sizeof(T);
+            SwapLittleEndian(&header.typeTag, 1);
+            SwapLittleEndian(&header.recordWidth, 1);
+            fileStream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+            if (!fileStream.good()) throw runtime_error("Ошибка записи в файл");
+        }
+
+        // Операции
+        void Open() override {
+            if (this->isOpen) return;
+            if (!fileStream.is_open()) throw runtime_error("Не удалось открыть поток для записи: файл закрыт!");
+            this->isOpen = true;
+        }
+
+        void Close() override {
+            if (!this->isOpen) return;
+            fileStream.close();
+            this->isOpen = false;
+            this->position = 0;
+        }
+
+        void Flush() {
+            if (!this->isOpen) throw runtime_error("Поток не открыт!");
+            fileStream.flush();
+        }
+
+        size_t Write(const T &item) override {
+            if (!this->isOpen) throw runtime_error("Поток не открыт!");
+            WriteRecords(&item, 1);
+            return this->position;
+        }
+
+        using WritableStream<T>::WriteBlock;
+
+        size_t WriteBlock(const T *items, size_t itemCount) override {
+            if (!this->isOpen) throw runtime_error("Поток не открыт!");
+            if (itemCount) WriteRecords(items, itemCount);
             return this->position;
         }
+
+        size_t WriteAll(shared_ptr<Sequence<T>> seq) override {
+            return this->WriteAllInBlocks(seq);
+        }
 };
 
+// Параллельная загрузка файла чисел (по одному в строке): файл отображается в память и делится на диапазоны,
+// выровненные по строкам; каждый поток разбирает свой диапазон в локальный буфер, затем буферы по префиксным
+// суммам длин параллельно копируются в один массив с сохранением исходного порядка. Пустые строки пропускаются
+template <typename T>
+shared_ptr<ArraySequence<T>> ParallelParseFile(const string &filename, size_t threads = 0) {
+    static_assert(is_arithmetic<T>::value, "Параллельный разбор поддерживается только для числовых типов!");
+    MappedFile file(filename);
+    const char *data = file.GetData();
+    size_t size = file.GetSize();
+    // Начало первой строки, которая начинается не раньше offset
+    auto align = [data, size](size_t offset) -> size_t {
+        if (offset == 0 || offset >= size) return min(offset, size);
+        const void *newline = memchr(data+offset-1, '\n', size-offset+1);
+        return newline ? static_cast<size_t>(static_cast<const char*>(newline)-data)+1 : size;
+    };
+    size_t chunks = GetChunkCount(size, threads);
+    vector<vector<T>> local(chunks);
+    ParallelFor(size, chunks, [&](size_t chunk, size_t from, size_t to) {
+        const char *cursor = data+align(from);
+        const char *end = data+align(to);
+        vector<T> &items = local[chunk];
+        items.reserve(static_cast<size_t>(end-cursor)/8);
+        while (cursor < end) {
+            while (cursor < end && (*cursor == ' ' || *cursor == '\t' || *cursor == '\r' || *cursor == '\n')) cursor++;
+            if (cursor >= end) break;
+            if (*cursor == '+') cursor++;
+            T value;
+            auto result = from_chars(cursor, end, value);
+            if (result.ec != errc()) throw runtime_error("Некорректное число в файле: " + filename);
+            cursor = result.ptr;
+            while (cursor < end && (*cursor == ' ' || *cursor == '\t' || *cursor == '\r')) cursor++;
+            if (cursor < end && *cursor != '\n') throw runtime_error("Некорректное число в файле: " + filename);
+            items.push_back(value);
+        }
+    });
+    vector<size_t> offsets(chunks+1, 0);
+    for (size_t chunk = 0; chunk < chunks; chunk++) offsets[chunk+1] = offsets[chunk]+local[chunk].size();
+    DynamicArray<T> result(offsets[chunks]);
+    ParallelFor(chunks, chunks, [&](size_t, size_t from, size_t to) {
+        for (size_t chunk = from; chunk < to; chunk++) {
+            if (!local[chunk].empty()) memcpy(&result[offsets[chunk]], local[chunk].data(), local[chunk].size()*sizeof(T));
+            vector<T>().swap(local[chunk]);
+        }
+    });
+    return make_shared<ArraySequence<T>>(move(result));
+}
+
 // Класс десериализатора для int
 class IntDeserializer: public Deserializer<int> {
     public:
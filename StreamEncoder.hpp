@@ -4,33 +4,45 @@
 #include "Stream.hpp"
 
 
+// Кодеки блоков сжатого контейнера; None - блок хранится без сжатия
+enum class BlockCodec: uint8_t {
+    None = 0,
+    RLE = 1,
+    LZ = 2
+};
+
 class StreamEncoder {
+    private:
+        static void WriteLength(string &out, size_t length) {
+            for (; length >= 255; length -= 255) out += static_cast<char>(255);
+            out += static_cast<char>(length);
+        }
+
+        static size_t ReadLength(const uint8_t *&cursor, const uint8_t *end) {
+            size_t length = 0;
+            uint8_t part;
+            do {
+                if (cursor >= end) throw runtime_error("Повреждённый сжатый блок!");
+                part = *cursor++;
+                length += part;
+            } while (part == 255);
+            return length;
+        }
+
+        // Последовательность LZ: токен (длина литералов и совпадения по 4 бита), литералы, смещение, продолжение длины
+        static void WriteSequence(string &out, const char *literals, size_t literalCount, size_t offset, size_t matchLength) {
+            size_t match = matchLength ? matchLength-4 : 0;
+            out += static_cast<char>((min<size_t>(literalCount, 15) << 4) | min<size_t>(match, 15));
+            if (literalCount >= 15) WriteLength(out, literalCount-15);
+            out.append(literals, literalCount);
+            if (!matchLength) return;
+            out += static_cast<char>(offset & 0xFF);
+            out += static_cast<char>(offset >> 8);
+            if (match >= 15) WriteLength(out, match-15);
+        }
     public:
         // RLE кодирование
-        static void RLEEncode(shared_ptr<ReadableStream<char>> input, shared_ptr<WritableStream<string>> output) {
-            input->Open();
-            output->Open();
-            char prev = '\0';
-            int count = 0;
-            bool first = true;
-            while (!input->IsEndOfStream()) {
-                char current = input->Read();
-                if (first) {
-                    prev = current;
-                    count = 1;
-                    first = false;
-                } else if (current == prev) {
-                    count++;
-                } else {
-                    output->Write(to_string(count)+prev);
-                    prev = current;
-                    count = 1;
-                }
-            }
-            if (!first) output->Write(to_string(count) + prev);
-            input->Close();
-            output->Close();
-        }
+        static void RLEEncode(shared_ptr<ReadableStream<char>> input, shared_ptr<WritableStream<string>> output);
         
         // RLE декодирование
         static void RLEDecode(shared_ptr<ReadableStream<string>> input, shared_ptr<WritableStream<char>> output) {
@@ -55,6 +67,196 @@ class StreamEncoder {
             input->Close();
             output->Close();
         }
+
+        // Блочное RLE для произвольных байтов: управляющий байт n < 128 - далее n+1 литералов,
+        // n >= 128 - следующий байт повторяется n-125 раз (от 3 до 130)
+        static string RLEEncodeBlock(const string &data) {
+            string out;
+            size_t size = data.size();
+            size_t literalStart = 0;
+            size_t i = 0;
+            auto flushLiterals = [&](size_t end) {
+                while (literalStart < end) {
+                    size_t count = min<size_t>(end-literalStart, 128);
+                    out += static_cast<char>(count-1);
+                    out.append(data, literalStart, count);
+                    literalStart += count;
+                }
+            };
+            while (i < size) {
+                size_t run = 1;
+                while (i+run < size && run < 130 && data[i+run] == data[i]) run++;
+                if (run >= 3) {
+                    flushLiterals(i);
+                    out += static_cast<char>(run+125);
+                    out += data[i];
+                    i += run;
+                    literalStart = i;
+                } else {
+                    i += run;
+                }
+            }
+            flushLiterals(size);
+            return out;
+        }
+
+        static string RLEDecodeBlock(const char *data, size_t size, size_t rawSize) {
+            string out;
+            out.reserve(rawSize);
+            const uint8_t *cursor = reinterpret_cast<const uint8_t*>(data);
+            const uint8_t *end = cursor+size;
+            while (cursor < end) {
+                uint8_t control = *cursor++;
+                if (control < 128) {
+                    size_t count = control+1;
+                    if (static_cast<size_t>(end-cursor) < count) throw runtime_error("Повреждённый сжатый блок!");
+                    out.append(reinterpret_cast<const char*>(cursor), count);
+                    cursor += count;
+                } else {
+                    if (cursor >= end) throw runtime_error("Повреждённый сжатый блок!");
+                    out.append(control-125, static_cast<char>(*cursor++));
+                }
+            }
+            if (out.size() != rawSize) throw runtime_error("Повреждённый сжатый блок!");
+            return out;
+        }
+
+        // Блочное LZ77 со смещениями до 64 КБ и хеш-таблицей четырёхбайтовых префиксов
+        static string LZEncodeBlock(const string &data) {
+            const size_t HASH_BITS = 14;
+            string out;
+            size_t size = data.size();
+            vector<int64_t> table(size_t(1) << HASH_BITS, -1);
+            size_t anchor = 0;
+            size_t i = 0;
+            while (i+4 <= size) {
+                uint32_t prefix;
+                memcpy(&prefix, data.data()+i, 4);
+                size_t slot = (prefix*2654435761u) >> (32-HASH_BITS);
+                int64_t candidate = table[slot];
+                table[slot] = static_cast<int64_t>(i);
+                if (candidate >= 0 && i-candidate <= 65535 && memcmp(data.data()+candidate, data.data()+i, 4) == 0) {
+                    size_t length = 4;
+                    while (i+length < size && data[candidate+length] == data[i+length]) length++;
+                    WriteSequence(out, data.data()+anchor, i-anchor, i-candidate, length);
+                    i += length;
+                    anchor = i;
+                } else {
+                    i++;
+                }
+            }
+            if (anchor < size) WriteSequence(out, data.data()+anchor, size-anchor, 0, 0);
+            return out;
+        }
+
+        static string LZDecodeBlock(const char *data, size_t size, size_t rawSize) {
+            string out;
+            out.reserve(rawSize);
+            const uint8_t *cursor = reinterpret_cast<const uint8_t*>(data);
+            const uint8_t *end = cursor+size;
+            while (out.size() < rawSize) {
+                if (cursor >= end) throw runtime_error("Повреждённый сжатый блок!");
+                uint8_t token = *cursor++;
+                size_t literals = token >> 4;
+                if (literals == 15) literals += ReadLength(cursor, end);
+                if (static_cast<size_t>(end-cursor) < literals || out.size()+literals > rawSize) throw runtime_error("Повреждённый сжатый блок!");
+                out.append(reinterpret_cast<const char*>(cursor), literals);
+                cursor += literals;
+                if (out.size() == rawSize) break;
+                if (end-cursor < 2) throw runtime_error("Повреждённый сжатый блок!");
+                size_t offset = cursor[0] | (static_cast<size_t>(cursor[1]) << 8);
+                cursor += 2;
+                size_t length = (token & 15)+4;
+                if ((token & 15) == 15) length += ReadLength(cursor, end);
+                if (offset == 0 || offset > out.size() || out.size()+length > rawSize) throw runtime_error("Повреждённый сжатый блок!");
+                // Совпадение может перекрывать выводимые байты, поэтому копирование побайтовое
+                size_t from = out.size()-offset;
+                for (size_t k = 0; k < length; k++) out += out[from+k];
+            }
+            return out;
+        }
+
+        static string EncodeBlock(BlockCodec codec, const string &data) {
+            switch (codec) {
+                case BlockCodec::None: return data;
+                case BlockCodec::RLE: return RLEEncodeBlock(data);
+                case BlockCodec::LZ: return LZEncodeBlock(data);
+            }
+            throw invalid_argument("Неизвестный кодек блока!");
+        }
+
+        static string DecodeBlock(BlockCodec codec, const char *data, size_t size, size_t rawSize) {
+            switch (codec) {
+                case BlockCodec::None:
+                    if (size != rawSize) throw runtime_error("Повреждённый сжатый блок!");
+                    return string(data, size);
+                case BlockCodec::RLE: return RLEDecodeBlock(data, size, rawSize);
+                case BlockCodec::LZ: return LZDecodeBlock(data, size, rawSize);
+            }
+            throw runtime_error("Неизвестный кодек блока!");
+        }
+};
+
+// Потоковый RLE-кодировщик: символы записываются по мере поступления (например, как ветвь TeeStream),
+// серии передаются в output, последняя - при закрытии
+class RLEWriteOnlyStream: public WritableStream<char> {
+    private:
+        shared_ptr<WritableStream<string>> output;
+        char prev;
+        size_t count;
+    public:
+        explicit RLEWriteOnlyStream(shared_ptr<WritableStream<string>> target): Stream<char>(), output(target), prev('\0'), count(0) {
+            if (!target) throw invalid_argument("Пустой выходной поток!");
+        }
+
+        void Open() override {
+            if (this->isOpen) return;
+            output->Open();
+            this->isOpen = true;
+        }
+
+        void Close() override {
+            if (!this->isOpen) return;
+            if (count) output->Write(to_string(count)+prev);
+            count = 0;
+            output->Close();
+            this->isOpen = false;
+            this->position = 0;
+        }
+
+        size_t Write(const char &item) override {
+            return WriteBlock(&item, 1);
+        }
+
+        using WritableStream<char>::WriteBlock;
+
+        size_t WriteBlock(const char *items, size_t itemCount) override {
+            if (!this->isOpen) throw runtime_error("Поток не открыт!");
+            for (size_t i = 0; i < itemCount; i++) {
+                if (count && items[i] == prev) {
+                    count++;
+                    continue;
+                }
+                if (count) output->Write(to_string(count)+prev);
+                prev = items[i];
+                count = 1;
+            }
+            this->position += itemCount;
+            return this->position;
+        }
+
+        size_t WriteAll(shared_ptr<Sequence<char>> seq) override {
+            return this->WriteAllInBlocks(seq, false);
+        }
 };
 
+inline void StreamEncoder::RLEEncode(shared_ptr<ReadableStream<char>> input, shared_ptr<WritableStream<string>> output) {
+    input->Open();
+    RLEWriteOnlyStream encoder(output);
+    encoder.Open();
+    while (!input->IsEndOfStream()) encoder.Write(input->Read());
+    input->Close();
+    encoder.Close();
+}
+
 #endif // STREAMENCODER_HPP
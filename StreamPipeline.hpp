@@ -0,0 +1,254 @@
+#ifndef STREAMPIPELINE_HPP
+#define STREAMPIPELINE_HPP
+
+#include <mutex>
+#include <chrono>
+#include <thread>
+#include <atomic>
+#include <vector>
+#include <type_traits>
+#include "Stream.hpp"
+using namespace std;
+
+
+// Многопоточный конвейер потоков: источник -> стадии преобразования -> приёмник.
+// Каждая стадия работает в своём потоке, стадии связаны ограниченными очередями пакетов (SpscQueue):
+// заполненная очередь останавливает производителя, ошибка любой стадии или Cancel останавливают все стадии
+
+// Счётчики стадии; seconds - время работы без ожидания очередей
+struct PipelineStageStatistics {
+    string name;
+    size_t items;
+    size_t batches;
+    double seconds;
+
+    double GetThroughput() const { return seconds > 0 ? items/seconds : 0; }
+};
+
+// Общее состояние конвейера: счётчики стадий, флаг отмены и первая ошибка.
+// Список счётчиков защищён мьютексом: статистику можно читать из другого потока во время запуска
+class PipelineState {
+    public:
+        struct Counter {
+            string name;
+            atomic<size_t> items{0};
+            atomic<size_t> batches{0};
+            atomic<int64_t> nanoseconds{0};
+        };
+
+        atomic<bool> cancelled{false};
+        mutex errorLock;
+        exception_ptr error;
+
+        Counter* AddCounter(const string &name) {
+            lock_guard<mutex> guard(counterLock);
+            counters.push_back(make_unique<Counter>());
+            counters.back()->name = name;
+            return counters.back().get();
+        }
+
+        // Очередь будится при отмене, чтобы ожидающие её стадии увидели флаг
+        template <typename T>
+        void AddQueue(shared_ptr<SpscQueue<T>> queue) {
+            lock_guard<mutex> guard(counterLock);
+            wakers.push_back([queue]() { queue->Wake(); });
+        }
+
+        size_t GetCounterCount() {
+            lock_guard<mutex> guard(counterLock);
+            return counters.size();
+        }
+
+        vector<PipelineStageStatistics> GetStatistics() {
+            lock_guard<mutex> guard(counterLock);
+            vector<PipelineStageStatistics> result;
+            for (const auto &counter : counters) {
+                result.push_back({counter->name, counter->items.load(), counter->batches.load(), counter->nanoseconds.load()/1e9});
+            }
+            return result;
+        }
+
+        void Cancel() {
+            cancelled = true;
+            lock_guard<mutex> guard(counterLock);
+            for (auto &wake : wakers) wake();
+        }
+
+        void Fail(exception_ptr exception) {
+            {
+                lock_guard<mutex> guard(errorLock);
+                if (!error) error = exception;
+            }
+            Cancel();
+        }
+
+        // Ожидание места в очереди (противодавление); false - конвейер остановлен
+        template <typename T>
+        bool Push(SpscQueue<T> &queue, T &item) {
+            return queue.Push(item, cancelled);
+        }
+
+        // Ожидание пакета; false - очередь закрыта и пуста или конвейер остановлен
+        template <typename T>
+        bool Pop(SpscQueue<T> &queue, T &item) {
+            return queue.Pop(item, cancelled);
+        }
+    private:
+        mutex counterLock;
+        vector<unique_ptr<Counter>> counters;
+        vector<function<void()>> wakers;
+};
+
+template <typename T>
+class StreamPipeline {
+    template <typename> friend class StreamPipeline;
+    private:
+        using Batch = vector<T>;
+
+        shared_ptr<PipelineState> state;
+        vector<function<void()>> stages;
+        shared_ptr<SpscQueue<Batch>> output;
+        size_t batchSize;
+        size_t queueCapacity;
+        bool started;
+
+        StreamPipeline(shared_ptr<PipelineState> pipelineState, vector<function<void()>> pipelineStages,
+                       shared_ptr<SpscQueue<Batch>> queue, size_t batch, size_t capacity):
+            state(pipelineState), stages(move(pipelineStages)), output(queue), batchSize(batch), queueCapacity(capacity), started(false) {}
+
+        static void Account(PipelineState::Counter *counter, size_t items, chrono::steady_clock::time_point start) {
+            counter->items += items;
+            counter->batches++;
+            counter->nanoseconds += chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now()-start).count();
+        }
+
+        // Новая стадия: process переводит входной пакет в выходной, пустые выходные пакеты не передаются
+        template <typename U>
+        StreamPipeline<U> AddStage(const string &name, function<void(Batch&, vector<U>&)> process) {
+            if (started || !output) throw runtime_error("Конвейер уже запущен или передан дальше!");
+            auto input = output;
+            auto next = make_shared<SpscQueue<vector<U>>>(queueCapacity);
+            auto pipelineState = state;
+            state->AddQueue(next);
+            PipelineState::Counter *counter = state->AddCounter(name);
+            stages.push_back([pipelineState, input, next, counter, process]() {
+                Batch batch;
+                while (pipelineState->Pop(*input, batch)) {
+                    auto start = chrono::steady_clock::now();
+                    vector<U> result;
+                    result.reserve(batch.size());
+                    process(batch, result);
+                    Account(counter, batch.size(), start);
+                    if (!result.empty() && !pipelineState->Push(*next, result)) break;
+                }
+                next->Close();
+            });
+            output = nullptr;
+            return StreamPipeline<U>(state, move(stages), next, batchSize, queueCapacity);
+        }
+    public:
+        static constexpr size_t DEFAULT_BATCH_SIZE = 4096;
+        static constexpr size_t DEFAULT_QUEUE_CAPACITY = 4;
+
+        // Конструкторы
+        StreamPipeline(StreamPipeline&&) = default;
+        StreamPipeline(const StreamPipeline&) = delete;
+        StreamPipeline& operator=(const StreamPipeline&) = delete;
+
+        // Источник читает поток пакетами по batch элементов; в каждой очереди не больше capacity пакетов
+        static StreamPipeline<T> From(shared_ptr<ReadableStream<T>> source, size_t batch = DEFAULT_BATCH_SIZE,
+                                      size_t capacity = DEFAULT_QUEUE_CAPACITY) {
+            if (!source) throw invalid_argument("Источник конвейера не может быть пустым!");
+            if (batch == 0) throw invalid_argument("Размер пакета должен быть положительным!");
+            auto pipelineState = make_shared<PipelineState>();
+            auto queue = make_shared<SpscQueue<Batch>>(capacity);
+            pipelineState->AddQueue(queue);
+            PipelineState::Counter *counter = pipelineState->AddCounter("source");
+            vector<function<void()>> pipelineStages;
+            pipelineStages.push_back([pipelineState, source, queue, counter, batch]() {
+                while (!pipelineState->cancelled) {
+                    auto start = chrono::steady_clock::now();
+                    Batch items(batch);
+                    size_t count = source->ReadBlock(items.data(), batch);
+                    if (count == 0) break;
+                    items.resize(count);
+                    Account(counter, count, start);
+                    if (!pipelineState->Push(*queue, items)) break;
+                }
+                queue->Close();
+            });
+            return StreamPipeline<T>(pipelineState, move(pipelineStages), queue, batch, capacity);
+        }
+
+        // Декомпозиция
+        size_t GetStageCount() const { return state->GetCounterCount(); }
+
+        // Счётчики стадий (можно читать во время работы конвейера)
+        vector<PipelineStageStatistics> GetStatistics() const { return state->GetStatistics(); }
+
+        bool IsCancelled() const { return state->cancelled; }
+
+        // Операции
+        template <typename F>
+        StreamPipeline<decay_t<invoke_result_t<F, const T&>>> Map(F func, const string &name = "map") {
+            using U = decay_t<invoke_result_t<F, const T&>>;
+            return AddStage<U>(name, [func](Batch &batch, vector<U> &result) {
+                for (const T &item : batch) result.push_back(func(item));
+            });
+        }
+
+        template <typename P>
+        StreamPipeline<T> Where(P predicate, const string &name = "where") {
+            return AddStage<T>(name, [predicate](Batch &batch, Batch &result) {
+                for (T &item : batch) {
+                    if (predicate(item)) result.push_back(move(item));
+                }
+            });
+        }
+
+        // Преобразование целого пакета (например, кодирование), число элементов может меняться
+        template <typename U>
+        StreamPipeline<U> Transform(function<void(vector<T>&, vector<U>&)> process, const string &name = "transform") {
+            return AddStage<U>(name, move(process));
+        }
+
+        // Остановка всех стадий; Run завершится исключением
+        void Cancel() { state->Cancel(); }
+
+        // Запуск: стадии в отдельных потоках, приёмник - в вызывающем; возвращает число записанных элементов
+        size_t Run(shared_ptr<WritableStream<T>> sink, const string &name = "sink") {
+            if (!sink) throw invalid_argument("Приёмник конвейера не может быть пустым!");
+            if (started || !output) throw runtime_error("Конвейер уже запущен или передан дальше!");
+            started = true;
+            PipelineState::Counter *counter = state->AddCounter(name);
+            vector<thread> workers;
+            for (auto &stage : stages) {
+                auto pipelineState = state;
+                workers.emplace_back([pipelineState, stage]() {
+                    try {
+                        stage();
+                    } catch (...) {
+                        pipelineState->Fail(current_exception());
+                    }
+                });
+            }
+            size_t written = 0;
+            try {
+                Batch batch;
+                while (state->Pop(*output, batch)) {
+                    auto start = chrono::steady_clock::now();
+                    sink->WriteBlock(batch.data(), batch.size());
+                    written += batch.size();
+                    Account(counter, batch.size(), start);
+                }
+            } catch (...) {
+                state->Fail(current_exception());
+            }
+            for (auto &worker : workers) worker.join();
+            if (state->error) rethrow_exception(state->error);
+            if (state->cancelled) throw runtime_error("Конвейер остановлен отменой!");
+            return written;
+        }
+};
+
+#endif // STREAMPIPELINE_HPP
@@ -65,20 +65,34 @@ class StreamStatistics {
         // Сбор из LazySequence
         void CollectFromSequence(shared_ptr<LazySequence<T>> seq, size_t maxElements = 0) {
             if (!seq) throw invalid_argument("Пустая ленивая последовательность!");
-            if (maxElements == 0) {
-                try {
-                    maxElements = seq->GetLength();
-                } catch (const runtime_error&) {
-                    maxElements = 1000000;
-                }
+            Cardinal hint = seq->GetCardinal();
+            if (maxElements == 0 && hint.IsInfinite()) throw invalid_argument("Для бесконечной последовательности нужно указать число элементов!");
+            size_t limit = maxElements ? maxElements : SIZE_MAX;
+            if (hint.HasUpperBound()) limit = std::min(limit, hint.GetUpperBound());
+            // Известная длина: кеш вычисляется заранее (параллельно, если позволяет источник)
+            if (hint.IsFinite() && !seq->IsStreaming()) {
+                seq->Materialize(limit);
+                for (size_t i = 0; i < limit; i++) Process(seq->Get(i));
+                return;
             }
-            for (size_t i = 0; i < maxElements; i++) {
-                try {
-                    Process(seq->Get(i));
-                } catch (const exception&) {
-                    break;
+            if (seq->IsStreaming()) {
+                for (size_t i = 0; i < limit; i++) {
+                    T value;
+                    try {
+                        value = seq->Extract(i);
+                    } catch (const out_of_range&) {
+                        if (hint.IsUnknown()) break;
+                        throw;
+                    }
+                    Process(value);
                 }
+                return;
             }
+            // Неизвестная или бесконечная длина: курсор читает генератор позицией самой последовательности,
+            // поэтому прочитанное не остаётся ни в кеше, ни в общей ленте генератора
+            typename LazySequence<T>::Cursor cursor(seq);
+            T value;
+            for (size_t i = 0; i < limit && cursor.Next(value); i++) Process(value);
         }
     
         // Сбор из Sequence
@@ -164,20 +178,34 @@ class StreamStatistics<string> {
         // Сбор из LazySequence
         void CollectFromSequence(shared_ptr<LazySequence<string>> seq, size_t maxElements = 0) {
             if (!seq) throw invalid_argument("Пустая ленивая последовательность!");
-            if (maxElements == 0) {
-                try {
-                    maxElements = seq->GetLength();
-                } catch (const runtime_error&) {
-                    maxElements = 1000000;
-                }
+            Cardinal hint = seq->GetCardinal();
+            if (maxElements == 0 && hint.IsInfinite()) throw invalid_argument("Для бесконечной последовательности нужно указать число элементов!");
+            size_t limit = maxElements ? maxElements : SIZE_MAX;
+            if (hint.HasUpperBound()) limit = std::min(limit, hint.GetUpperBound());
+            // Известная длина: кеш вычисляется заранее (параллельно, если позволяет источник)
+            if (hint.IsFinite() && !seq->IsStreaming()) {
+                seq->Materialize(limit);
+                for (size_t i = 0; i < limit; i++) Process(seq->Get(i));
+                return;
             }
-            for (size_t i = 0; i < maxElements; i++) {
-                try {
-                    Process(seq->Get(i));
-                } catch (const exception&) {
-                    break;
+            if (seq->IsStreaming()) {
+                for (size_t i = 0; i < limit; i++) {
+                    string value;
+                    try {
+                        value = seq->Extract(i);
+                    } catch (const out_of_range&) {
+                        if (hint.IsUnknown()) break;
+                        throw;
+                    }
+                    Process(value);
                 }
+                return;
             }
+            // Неизвестная или бесконечная длина: курсор читает генератор позицией самой последовательности,
+            // поэтому прочитанное не остаётся ни в кеше, ни в общей ленте генератора
+            typename LazySequence<string>::Cursor cursor(seq);
+            string value;
+            for (size_t i = 0; i < limit && cursor.Next(value); i++) Process(value);
         }
 
         // Сбор из Sequence
@@ -214,4 +242,41 @@ class StreamStatistics<string> {
         }
 };
 
+// Приёмник, собирающий статистику записанных элементов (например, как ветвь TeeStream)
+template <typename T>
+class StatisticsWriteOnlyStream: public WritableStream<T> {
+    private:
+        shared_ptr<StreamStatistics<T>> statistics;
+    public:
+        explicit StatisticsWriteOnlyStream(shared_ptr<StreamStatistics<T>> target): Stream<T>(), statistics(target) {
+            if (!target) throw invalid_argument("Пустой объект статистики!");
+        }
+
+        shared_ptr<StreamStatistics<T>> GetStatistics() const { return statistics; }
+
+        void Open() override { this->isOpen = true; }
+
+        void Close() override {
+            this->isOpen = false;
+            this->position = 0;
+        }
+
+        size_t Write(const T &item) override {
+            return WriteBlock(&item, 1);
+        }
+
+        using WritableStream<T>::WriteBlock;
+
+        size_t WriteBlock(const T *items, size_t count) override {
+            if (!this->isOpen) throw runtime_error("Поток не открыт!");
+            for (size_t i = 0; i < count; i++) statistics->Process(items[i]);
+            this->position += count;
+            return this->position;
+        }
+
+        size_t WriteAll(shared_ptr<Sequence<T>> seq) override {
+            return this->WriteAllInBlocks(seq, false);
+        }
+};
+
 #endif // STREAMSTATISTICS_HPP
@@ -0,0 +1,204 @@
+#ifndef TEESTREAM_HPP
+#define TEESTREAM_HPP
+
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <vector>
+#include "Stream.hpp"
+using namespace std;
+
+
+// Поток-разветвитель: каждый записанный пакет передаётся всем приёмникам, источник читается один раз.
+// В синхронном режиме приёмники пишутся по очереди в вызывающем потоке; в многопоточном у каждого приёмника
+// свой поток и своя очередь не более чем из lagBatches пакетов: медленный приёмник останавливает запись
+template <typename T>
+class TeeStream: public WritableStream<T> {
+    protected:
+        using Batch = shared_ptr<const vector<T>>;
+
+        struct Consumer {
+            shared_ptr<WritableStream<T>> stream;
+            unique_ptr<SpscQueue<Batch>> queue;
+            thread worker;
+        };
+
+        vector<Consumer> consumers;
+        bool threaded;
+        size_t lagBatches;
+        size_t batchSize;
+        vector<T> pending;
+        atomic<bool> failed;
+        mutex errorLock;
+        exception_ptr error;
+
+        // Ошибка будит все очереди: ожидающие запись и чтение увидят флаг failed
+        void Fail(exception_ptr exception) {
+            {
+                lock_guard<mutex> guard(errorLock);
+                if (!error) error = exception;
+            }
+            failed = true;
+            for (auto &consumer : consumers) consumer.queue->Wake();
+        }
+
+        void RethrowError() {
+            lock_guard<mutex> guard(errorLock);
+            if (error) rethrow_exception(error);
+        }
+
+        void ConsumerLoop(Consumer &consumer) {
+            try {
+                Batch batch;
+                while (consumer.queue->Pop(batch, failed)) {
+                    consumer.stream->WriteBlock(batch->data(), batch->size());
+                    batch = nullptr;
+                }
+            } catch (...) {
+                Fail(current_exception());
+            }
+        }
+
+        // Пакет ставится в очередь каждого приёмника; ожидание при заполненной очереди - противодавление
+        void Dispatch(vector<T> &&items) {
+            if (items.empty()) return;
+            Batch batch = make_shared<const vector<T>>(move(items));
+            for (auto &consumer : consumers) {
+                Batch copy = batch;
+                if (!consumer.queue->Push(copy, failed)) RethrowError();
+            }
+        }
+
+        void SubmitPending() {
+            vector<T> batch;
+            batch.swap(pending);
+            pending.reserve(batchSize);
+            Dispatch(move(batch));
+        }
+
+        void StopWorkers() {
+            for (auto &consumer : consumers) {
+                if (consumer.queue) consumer.queue->Close();
+            }
+            for (auto &consumer : consumers) {
+                if (consumer.worker.joinable()) consumer.worker.join();
+            }
+        }
+    public:
+        static constexpr size_t DEFAULT_LAG_BATCHES = 4;
+        static constexpr size_t DEFAULT_BATCH_SIZE = 4096;
+
+        // Конструкторы
+        ~TeeStream() override {
+            try { Close(); } catch (...) {}
+            StopWorkers();
+        }
+
+        explicit TeeStream(const vector<shared_ptr<WritableStream<T>>> &sinks, bool perConsumerThreads = false,
+                           size_t lag = DEFAULT_LAG_BATCHES, size_t batch = DEFAULT_BATCH_SIZE):
+            Stream<T>(), threaded(perConsumerThreads), lagBatches(lag ? lag : 1), batchSize(batch ? batch : 1), failed(false) {
+            if (sinks.empty()) throw invalid_argument("Разветвителю нужен хотя бы один приёмник!");
+            consumers.resize(sinks.size());
+            for (size_t i = 0; i < sinks.size(); i++) {
+                if (!sinks[i]) throw invalid_argument("Приёмник не может быть пустым!");
+                consumers[i].stream = sinks[i];
+            }
+        }
+
+        TeeStream(const TeeStream&) = delete;
+        TeeStream& operator=(const TeeStream&) = delete;
+
+        // Декомпозиция
+        size_t GetConsumerCount() const { return consumers.size(); }
+
+        bool IsThreaded() const { return threaded; }
+
+        // Число пакетов, ещё не записанных приёмником
+        size_t GetLag(size_t index) const {
+            if (index >= consumers.size()) throw out_of_range("Некорректный номер приёмника!");
+            return consumers[index].queue ? consumers[index].queue->GetSize() : 0;
+        }
+
+        // Операции
+        void Open() override {
+            if (this->isOpen) return;
+            for (auto &consumer : consumers) consumer.stream->Open();
+            if (threaded) {
+                failed = false;
+                error = nullptr;
+                for (auto &consumer : consumers) {
+                    consumer.queue = make_unique<SpscQueue<Batch>>(lagBatches);
+                    consumer.worker = thread([this, &consumer]() { ConsumerLoop(consumer); });
+                }
+                pending.reserve(batchSize);
+            }
+            this->isOpen = true;
+        }
+
+        // Дожидается записи всех пакетов всеми приёмниками и закрывает их; ошибка приёмника передаётся вызывающему
+        void Close() override {
+            if (!this->isOpen) return;
+            this->isOpen = false;
+            this->position = 0;
+            if (threaded) {
+                if (!failed) {
+                    try {
+                        SubmitPending();
+                    } catch (...) {}
+                }
+                StopWorkers();
+                for (auto &consumer : consumers) consumer.queue = nullptr;
+            }
+            for (auto &consumer : consumers) consumer.stream->Close();
+            RethrowError();
+        }
+
+        size_t Write(const T &item) override {
+            return WriteBlock(&item, 1);
+        }
+
+        using WritableStream<T>::WriteBlock;
+
+        size_t WriteBlock(const T *items, size_t count) override {
+            if (!this->isOpen) throw runtime_error("Поток не открыт!");
+            if (!threaded) {
+                for (auto &consumer : consumers) consumer.stream->WriteBlock(items, count);
+            } else {
+                if (failed) RethrowError();
+                for (size_t done = 0; done < count;) {
+                    size_t take = min(count-done, batchSize-pending.size());
+                    pending.insert(pending.end(), items+done, items+done+take);
+                    done += take;
+                    if (pending.size() == batchSize) SubmitPending();
+                }
+            }
+            this->position += count;
+            return this->position;
+        }
+
+        size_t WriteAll(shared_ptr<Sequence<T>> seq) override {
+            return this->WriteAllInBlocks(seq);
+        }
+
+        // Передача неполного пакета приёмникам без ожидания записи
+        void Flush() {
+            if (!this->isOpen) throw runtime_error("Поток не открыт!");
+            if (threaded) SubmitPending();
+        }
+
+        // Однократное чтение источника пакетами до конца и передача всем приёмникам; возвращает число элементов
+        size_t Pump(shared_ptr<ReadableStream<T>> source) {
+            if (!source) throw invalid_argument("Источник не может быть пустым!");
+            if (!this->isOpen) throw runtime_error("Поток не открыт!");
+            vector<T> buffer(batchSize);
+            size_t total = 0;
+            size_t count;
+            while ((count = source->ReadBlock(buffer.data(), buffer.size())) > 0) {
+                WriteBlock(buffer.data(), count);
+                total += count;
+            }
+            return total;
+        }
+};
+
+#endif // TEESTREAM_HPP
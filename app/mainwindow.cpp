@@ -1605,6 +1605,7 @@ void MainWindow::finiteSubsequence()
         }
 
         auto lazySeq = dynamic_cast<LazySequence<int>*>(finiteSequence->GetSubsequence(start, end));
+        lazySeq->Materialize();
         auto newArray = make_shared<DynamicArray<int>>(lazySeq->GetLength());
         for (size_t i = 0; i < lazySeq->GetLength(); i++) {
             newArray->Set(i, lazySeq->Get(i));
@@ -1936,6 +1937,7 @@ void MainWindow::infiniteSubsequence()
 
     try {
         auto lazySeq = dynamic_cast<LazySequence<int>*>(infiniteSequence->GetSubsequence(start, end));
+        lazySeq->Materialize();
         auto newArray = make_shared<DynamicArray<int>>(lazySeq->GetLength());
         for (size_t i = 0; i < lazySeq->GetLength(); i++) {
             newArray->Set(i, lazySeq->Get(i));
@@ -1,12 +1,18 @@
 #ifndef ARRAYSEQUENCE_HPP
 #define ARRAYSEQUENCE_HPP
 
+#include <vector>
+#include <algorithm>
 #include "Sequence.hpp"
 #include "DynamicArray.hpp"
+#include "Selection.hpp"
+#include "HashTable.hpp"
+#include "../Parallel.hpp"
 
 
 template <typename T>
 class ArraySequence: public Sequence<T> {
+    template <typename> friend class ArraySequence;
     protected:
         DynamicArray<T> array;
         size_t length;
@@ -43,6 +49,8 @@ class ArraySequence: public Sequence<T> {
 
         ArraySequence(const DynamicArray<T> &other): length(other.GetSize()), array(other) {}
 
+        ArraySequence(DynamicArray<T> &&other): array(std::move(other)), length(array.GetSize()) {}
+
         ArraySequence(const ArraySequence<T> &other): length(other.length), array(other.array) {}
         ArraySequence<T>& operator=(const ArraySequence<T> &other) {
             if (this != &other) {
@@ -169,15 +177,17 @@ class ArraySequence: public Sequence<T> {
         }
 
         Sequence<T>* Where(std::function<bool(T)> func) {
+            // Результат не длиннее исходной последовательности: одно выделение памяти и усечение в конце
             auto result = new ArraySequence<T>();
+            result->array.Resize(length);
             for (size_t i = 0; i < length; i++) {
-                T value = array.Get(i);
+                const T &value = array[i];
                 if (func(value)) {
-                    result->increase(result->length+1);
-                    result->array.Set(result->length, value);
+                    result->array[result->length] = value;
                     result->length++;
                 }
             }
+            result->array.Resize(result->length);
             return result;
         }
 
@@ -217,6 +227,209 @@ class ArraySequence: public Sequence<T> {
             second->length = seqLength;
             return std::make_pair(first, second);
         }
+
+        // Частичная сортировка и порядковые статистики (cmp задаёт порядок, по умолчанию - возрастание)
+        // k первых элементов в порядке cmp, дополнительная память O(k)
+        Sequence<T>* TopK(size_t k, std::function<bool(const T&, const T&)> cmp = std::less<T>()) {
+            k = std::min(k, length);
+            auto result = new ArraySequence<T>();
+            result->array.Resize(k);
+            if (k > 0) std::partial_sort_copy(&array[0], &array[0]+length, &result->array[0], &result->array[0]+k, cmp);
+            result->length = k;
+            return result;
+        }
+
+        Sequence<T>* ParallelTopK(size_t k, std::function<bool(const T&, const T&)> cmp = std::less<T>(), size_t threads = 0) {
+            using Heap = TopKHeap<T, std::function<bool(const T&, const T&)>>;
+            size_t chunks = GetChunkCount(length, threads);
+            std::vector<Heap> heaps(chunks, Heap(k, cmp));
+            ParallelFor(length, chunks, [&](size_t chunk, size_t from, size_t to) {
+                for (size_t i = from; i < to; i++) heaps[chunk].Push(array[i]);
+            });
+            for (size_t chunk = 1; chunk < chunks; chunk++) heaps[0].Merge(heaps[chunk]);
+            std::vector<T> sorted = heaps[0].GetSorted();
+            auto result = new ArraySequence<T>();
+            result->array.Resize(sorted.size());
+            for (size_t i = 0; i < sorted.size(); i++) result->array[i] = sorted[i];
+            result->length = sorted.size();
+            return result;
+        }
+
+        // Элемент, стоящий на позиции n после сортировки (исходная последовательность не меняется)
+        T NthElement(size_t n, std::function<bool(const T&, const T&)> cmp = std::less<T>()) {
+            if (n >= length) throw std::out_of_range("Некорректный индекс!");
+            std::vector<T> items(&array[0], &array[0]+length);
+            std::nth_element(items.begin(), items.begin()+n, items.end(), cmp);
+            return items[n];
+        }
+
+        // Параллельный quickselect: каждый шаг - параллельное разбиение с сохранением только нужной части
+        T ParallelNthElement(size_t n, std::function<bool(const T&, const T&)> cmp = std::less<T>(), size_t threads = 0) {
+            if (n >= length) throw std::out_of_range("Некорректный индекс!");
+            return SelectNth(std::vector<T>(&array[0], &array[0]+length), n, cmp, threads);
+        }
+
+        // Тот же выбор над уже собранной копией элементов, которую можно переупорядочивать
+        static T SelectNth(std::vector<T> current, size_t n, const std::function<bool(const T&, const T&)> &cmp, size_t threads = 0) {
+            if (n >= current.size()) throw std::out_of_range("Некорректный индекс!");
+            std::vector<T> buffer(current.size());
+            while (current.size() > 2*MIN_PARALLEL_CHUNK) {
+                T pivot = SamplePivot(current, cmp);
+                size_t lessCount, equalCount;
+                ParallelPartition(current.data(), current.size(), pivot, cmp, buffer.data(), lessCount, equalCount, threads);
+                if (n < lessCount) {
+                    current.assign(buffer.begin(), buffer.begin()+lessCount);
+                } else if (n < lessCount+equalCount) {
+                    return pivot;
+                } else {
+                    n -= lessCount+equalCount;
+                    current.assign(buffer.begin()+lessCount+equalCount, buffer.begin()+current.size());
+                }
+            }
+            std::nth_element(current.begin(), current.begin()+n, current.end(), cmp);
+            return current[n];
+        }
+
+        // Вся последовательность, в которой первые k элементов упорядочены и не больше остальных
+        Sequence<T>* PartialSort(size_t k, std::function<bool(const T&, const T&)> cmp = std::less<T>()) {
+            k = std::min(k, length);
+            auto result = new ArraySequence<T>(*this);
+            if (k > 0) std::partial_sort(&result->array[0], &result->array[0]+k, &result->array[0]+length, cmp);
+            return result;
+        }
+
+        Sequence<T>* ParallelPartialSort(size_t k, std::function<bool(const T&, const T&)> cmp = std::less<T>(), size_t threads = 0) {
+            k = std::min(k, length);
+            if (k == 0) return new ArraySequence<T>(*this);
+            T pivot = ParallelNthElement(k-1, cmp, threads);
+            auto result = new ArraySequence<T>();
+            result->array.Resize(length);
+            size_t lessCount, equalCount;
+            ParallelPartition(&array[0], length, pivot, cmp, &result->array[0], lessCount, equalCount, threads);
+            std::sort(&result->array[0], &result->array[0]+lessCount, cmp);
+            result->length = length;
+            return result;
+        }
+
+        // Группировка через хеш-таблицу с открытой адресацией; результат - в порядке первого появления
+        Sequence<T>* Distinct() {
+            HashTable<T, uint8_t> seen(0);
+            for (size_t i = 0; i < length; i++) seen.Insert(array[i], 0);
+            auto result = new ArraySequence<T>();
+            result->array.Resize(seen.GetCount());
+            for (size_t i = 0; i < seen.GetCount(); i++) result->array[i] = seen.GetKey(i);
+            result->length = seen.GetCount();
+            return result;
+        }
+
+        // Локальные таблицы блоков объединяются по порядку блоков, поэтому порядок первого появления сохраняется
+        Sequence<T>* ParallelDistinct(size_t threads = 0) {
+            size_t chunks = GetChunkCount(length, threads);
+            std::vector<HashTable<T, uint8_t>> local(chunks);
+            ParallelFor(length, chunks, [&](size_t chunk, size_t from, size_t to) {
+                for (size_t i = from; i < to; i++) local[chunk].Insert(array[i], 0);
+            });
+            for (size_t chunk = 1; chunk < chunks; chunk++) {
+                for (size_t i = 0; i < local[chunk].GetCount(); i++) local[0].Insert(local[chunk].GetKey(i), 0);
+            }
+            auto result = new ArraySequence<T>();
+            result->array.Resize(local[0].GetCount());
+            for (size_t i = 0; i < local[0].GetCount(); i++) result->array[i] = local[0].GetKey(i);
+            result->length = local[0].GetCount();
+            return result;
+        }
+
+        // Пары (ключ, свёртка элементов группы), start - начальное значение свёртки каждой группы
+        template <typename K, typename A>
+        Sequence<std::pair<K, A>>* GroupBy(std::function<K(T)> key, std::function<A(A, T)> aggregate, A start) {
+            HashTable<K, A> groups(0);
+            for (size_t i = 0; i < length; i++) {
+                A &value = groups.GetOrInsert(key(array[i]), start);
+                value = aggregate(value, array[i]);
+            }
+            return GroupsToSequence(groups);
+        }
+
+        // combine объединяет частичные свёртки одной группы из разных блоков, start - его нейтральный элемент
+        template <typename K, typename A>
+        Sequence<std::pair<K, A>>* ParallelGroupBy(std::function<K(T)> key, std::function<A(A, T)> aggregate,
+                                                   std::function<A(A, A)> combine, A start, size_t threads = 0) {
+            size_t chunks = GetChunkCount(length, threads);
+            std::vector<HashTable<K, A>> local(chunks);
+            ParallelFor(length, chunks, [&](size_t chunk, size_t from, size_t to) {
+                for (size_t i = from; i < to; i++) {
+                    A &value = local[chunk].GetOrInsert(key(array[i]), start);
+                    value = aggregate(value, array[i]);
+                }
+            });
+            for (size_t chunk = 1; chunk < chunks; chunk++) {
+                for (size_t i = 0; i < local[chunk].GetCount(); i++) {
+                    auto inserted = local[0].Insert(local[chunk].GetKey(i), local[chunk].GetValue(i));
+                    if (!inserted.second) {
+                        A &value = local[0].GetValue(inserted.first);
+                        value = combine(value, local[chunk].GetValue(i));
+                    }
+                }
+            }
+            return GroupsToSequence(local[0]);
+        }
+
+    private:
+        // Опорный элемент - медиана девяти равномерно взятых образцов
+        static T SamplePivot(const std::vector<T> &items, const std::function<bool(const T&, const T&)> &cmp) {
+            const size_t SAMPLES = 9;
+            T samples[SAMPLES];
+            for (size_t i = 0; i < SAMPLES; i++) samples[i] = items[(2*i+1)*items.size()/(2*SAMPLES)];
+            std::nth_element(samples, samples+SAMPLES/2, samples+SAMPLES, cmp);
+            return samples[SAMPLES/2];
+        }
+
+        template <typename K, typename A>
+        static Sequence<std::pair<K, A>>* GroupsToSequence(const HashTable<K, A> &groups) {
+            auto result = new ArraySequence<std::pair<K, A>>();
+            result->array.Resize(groups.GetCount());
+            for (size_t i = 0; i < groups.GetCount(); i++) result->array[i] = std::make_pair(groups.GetKey(i), groups.GetValue(i));
+            result->length = groups.GetCount();
+            return result;
+        }
+
+        // Устойчивое трёхпутевое разбиение в out: меньшие pivot, равные, большие; два параллельных прохода (подсчёт и раскладка)
+        static void ParallelPartition(const T *items, size_t count, const T &pivot, const std::function<bool(const T&, const T&)> &cmp,
+                                      T *out, size_t &lessCount, size_t &equalCount, size_t threads) {
+            size_t chunks = GetChunkCount(count, threads);
+            std::vector<size_t> less(chunks, 0), equal(chunks, 0);
+            ParallelFor(count, chunks, [&](size_t chunk, size_t from, size_t to) {
+                for (size_t i = from; i < to; i++) {
+                    if (cmp(items[i], pivot)) less[chunk]++;
+                    else if (!cmp(pivot, items[i])) equal[chunk]++;
+                }
+            });
+            lessCount = 0;
+            equalCount = 0;
+            for (size_t chunk = 0; chunk < chunks; chunk++) {
+                lessCount += less[chunk];
+                equalCount += equal[chunk];
+            }
+            std::vector<size_t> lessOffset(chunks), equalOffset(chunks), greaterOffset(chunks);
+            size_t lessPosition = 0, equalPosition = lessCount, greaterPosition = lessCount+equalCount;
+            for (size_t chunk = 0; chunk < chunks; chunk++) {
+                size_t from = count*chunk/chunks, to = count*(chunk+1)/chunks;
+                lessOffset[chunk] = lessPosition;
+                equalOffset[chunk] = equalPosition;
+                greaterOffset[chunk] = greaterPosition;
+                lessPosition += less[chunk];
+                equalPosition += equal[chunk];
+                greaterPosition += (to-from)-less[chunk]-equal[chunk];
+            }
+            ParallelFor(count, chunks, [&](size_t chunk, size_t from, size_t to) {
+                size_t l = lessOffset[chunk], e = equalOffset[chunk], g = greaterOffset[chunk];
+                for (size_t i = from; i < to; i++) {
+                    if (cmp(items[i], pivot)) out[l++] = items[i];
+                    else if (!cmp(pivot, items[i])) out[e++] = items[i];
+                    else out[g++] = items[i];
+                }
+            });
+        }
 };
 
 #endif // ARRAYSEQUENCE_HPP
@@ -0,0 +1,170 @@
+#ifndef DELTAINDEX_HPP
+#define DELTAINDEX_HPP
+
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <algorithm>
+
+
+// Неубывающая последовательность позиций: блоки с абсолютным началом и дельтами в varint
+class DeltaIndex {
+    public:
+        static constexpr size_t BLOCK_SIZE = 64;
+    private:
+        std::vector<uint64_t> samples;
+        std::vector<uint64_t> blockOffsets;
+        std::vector<uint8_t> deltas;
+        size_t count;
+        uint64_t last;
+
+        static uint64_t DecodeVarint(const uint8_t *&cursor) {
+            uint64_t value = 0;
+            int shift = 0;
+            while (*cursor & 0x80) {
+                value |= static_cast<uint64_t>(*cursor++ & 0x7F) << shift;
+                shift += 7;
+            }
+            value |= static_cast<uint64_t>(*cursor++) << shift;
+            return value;
+        }
+
+        // Блоки идут подряд с нуля, каждая дельта - корректный varint внутри массива, значения не убывают
+        void Validate() const {
+            size_t position = 0;
+            uint64_t value = 0;
+            for (size_t block = 0; block < samples.size(); block++) {
+                if (blockOffsets[block] != position || (block > 0 && samples[block] < value)) {
+                    throw std::runtime_error("Повреждённый индекс позиций!");
+                }
+                value = samples[block];
+                size_t end = std::min((block+1)*BLOCK_SIZE, count);
+                for (size_t i = block*BLOCK_SIZE+1; i < end; i++) {
+                    uint64_t delta = 0;
+                    for (int shift = 0; ; shift += 7) {
+                        if (position >= deltas.size() || shift > 63) throw std::runtime_error("Повреждённый индекс позиций!");
+                        uint8_t byte = deltas[position++];
+                        delta |= static_cast<uint64_t>(byte & 0x7F) << shift;
+                        if (!(byte & 0x80)) break;
+                    }
+                    if (delta > UINT64_MAX-value) throw std::runtime_error("Повреждённый индекс позиций!");
+                    value += delta;
+                }
+            }
+            if (position != deltas.size() || (count > 0 && value != last)) throw std::runtime_error("Повреждённый индекс позиций!");
+        }
+    public:
+        // Создание объекта
+        DeltaIndex(): count(0), last(0) {}
+
+        // Декомпозиция
+        size_t GetCount() const { return count; }
+
+        uint64_t GetLast() const {
+            if (count == 0) throw std::out_of_range("Индекс пуст!");
+            return last;
+        }
+
+        uint64_t Get(size_t index) const {
+            if (index >= count) throw std::out_of_range("Некорректный индекс!");
+            size_t block = index/BLOCK_SIZE;
+            uint64_t value = samples[block];
+            const uint8_t *cursor = deltas.data()+blockOffsets[block];
+            for (size_t i = block*BLOCK_SIZE; i < index; i++) {
+                value += DecodeVarint(cursor);
+            }
+            return value;
+        }
+
+        // Номер первого элемента, не меньшего value
+        size_t LowerBound(uint64_t value) const {
+            if (count == 0 || value > last) return count;
+            size_t left = 0, right = samples.size();
+            while (right-left > 1) {
+                size_t middle = (left+right)/2;
+                if (samples[middle] <= value) left = middle;
+                else right = middle;
+            }
+            size_t index = left*BLOCK_SIZE;
+            uint64_t current = samples[left];
+            const uint8_t *cursor = deltas.data()+blockOffsets[left];
+            size_t end = std::min((left+1)*BLOCK_SIZE, count);
+            while (current < value) {
+                if (++index == end) return end;
+                current += DecodeVarint(cursor);
+            }
+            return index;
+        }
+
+        size_t GetMemoryUsage() const {
+            return samples.size()*sizeof(uint64_t)+blockOffsets.size()*sizeof(uint64_t)+deltas.size();
+        }
+
+        // Операции
+        void Append(uint64_t value) {
+            if (count > 0 && value < last) throw std::invalid_argument("Позиции должны быть неубывающими!");
+            if (count % BLOCK_SIZE == 0) {
+                samples.push_back(value);
+                blockOffsets.push_back(deltas.size());
+            } else {
+                uint64_t delta = value-last;
+                while (delta >= 0x80) {
+                    deltas.push_back(static_cast<uint8_t>(delta | 0x80));
+                    delta >>= 7;
+                }
+                deltas.push_back(static_cast<uint8_t>(delta));
+            }
+            last = value;
+            count++;
+        }
+
+        // Компактное представление: count, last, размеры массивов и сами массивы (порядок байтов платформы)
+        std::string Serialize() const {
+            uint64_t header[4] = {count, last, samples.size(), deltas.size()};
+            std::string result(reinterpret_cast<const char*>(header), sizeof(header));
+            result.append(reinterpret_cast<const char*>(samples.data()), samples.size()*sizeof(uint64_t));
+            result.append(reinterpret_cast<const char*>(blockOffsets.data()), blockOffsets.size()*sizeof(uint64_t));
+            result.append(reinterpret_cast<const char*>(deltas.data()), deltas.size());
+            return result;
+        }
+
+        // Размеры сверяются с остатком данных по частям, чтобы их сумма не переполнилась;
+        // затем все дельты декодируются с проверкой границ, так что Get и LowerBound не выйдут за массив
+        static DeltaIndex Deserialize(const char *data, size_t size) {
+            uint64_t header[4];
+            if (size < sizeof(header)) throw std::runtime_error("Повреждённый индекс позиций!");
+            memcpy(header, data, sizeof(header));
+            uint64_t blocks = header[2];
+            uint64_t payload = size-sizeof(header);
+            if (blocks != header[0]/BLOCK_SIZE+(header[0] % BLOCK_SIZE != 0) || blocks > payload/(2*sizeof(uint64_t)) ||
+                header[3] != payload-2*blocks*sizeof(uint64_t)) {
+                throw std::runtime_error("Повреждённый индекс позиций!");
+            }
+            DeltaIndex result;
+            result.count = static_cast<size_t>(header[0]);
+            result.last = header[1];
+            const char *cursor = data+sizeof(header);
+            result.samples.resize(blocks);
+            result.blockOffsets.resize(blocks);
+            result.deltas.resize(header[3]);
+            if (blocks) {
+                memcpy(result.samples.data(), cursor, blocks*sizeof(uint64_t));
+                memcpy(result.blockOffsets.data(), cursor+blocks*sizeof(uint64_t), blocks*sizeof(uint64_t));
+            }
+            if (header[3]) memcpy(result.deltas.data(), cursor+2*blocks*sizeof(uint64_t), header[3]);
+            result.Validate();
+            return result;
+        }
+
+        void Clear() {
+            samples.clear();
+            blockOffsets.clear();
+            deltas.clear();
+            count = 0;
+            last = 0;
+        }
+};
+
+#endif // DELTAINDEX_HPP
@@ -7,15 +7,16 @@ class DynamicArray {
     private:
         T *data;
         size_t size;
+        size_t capacity;
     public:
         // Создание объекта
-        DynamicArray(): size(0), data(nullptr) {}
+        DynamicArray(): data(nullptr), size(0), capacity(0) {}
 
         ~DynamicArray() { delete[] data; }
 
-        DynamicArray(size_t count): size(count), data(new T[count]) {}
+        DynamicArray(size_t count): data(new T[count]), size(count), capacity(count) {}
 
-        DynamicArray(T *items, size_t count): size(count), data(new T[count]) {
+        DynamicArray(T *items, size_t count): data(new T[count]), size(count), capacity(count) {
             if (count) {
                 for (size_t i = 0; i < count; i++) {
                     data[i] = items[i];
@@ -23,7 +24,7 @@ class DynamicArray {
             }
         }
 
-        DynamicArray(const DynamicArray<T> &other): size(other.size), data(new T[other.size]) {
+        DynamicArray(const DynamicArray<T> &other): data(new T[other.size]), size(other.size), capacity(other.size) {
             if (other.size) {
                 for (size_t i = 0; i < other.size; i++) {
                     data[i] = other.data[i];
@@ -31,14 +32,17 @@ class DynamicArray {
             }
         }
 
-        DynamicArray(DynamicArray<T> &&other) noexcept: data(other.data), size(other.size) {
+        DynamicArray(DynamicArray<T> &&other) noexcept: data(other.data), size(other.size), capacity(other.capacity) {
             other.data = nullptr;
             other.size = 0;
+            other.capacity = 0;
         }
 
         // Декомпозиция
         size_t GetSize() const { return size; }
 
+        size_t GetCapacity() const { return capacity; }
+
         T Get(size_t index) const {
             if (size > index) {
                 return data[index];
@@ -65,8 +69,10 @@ class DynamicArray {
             if (this != &other) {
                 delete[] data;
                 size = other.size;
+                capacity = other.capacity;
                 data = other.data;
                 other.size = 0;
+                other.capacity = 0;
                 other.data = nullptr;
             }
             return *this;
@@ -81,12 +87,21 @@ class DynamicArray {
             }
         }
 
+        // Увеличение в пределах зарезервированной ёмкости не перераспределяет память
         void Resize(size_t newSize) {
             if (newSize == size) return;
             if (newSize == 0) {
                 delete[] data;
                 data = nullptr;
                 size = 0;
+                capacity = 0;
+                return;
+            }
+            if (newSize > size && newSize <= capacity) {
+                for (size_t i = size; i < newSize; i++) {
+                    data[i] = T();
+                }
+                size = newSize;
                 return;
             }
             T *newData = new T[newSize];
@@ -99,6 +114,19 @@ class DynamicArray {
             delete[] data;
             data = newData;
             size = newSize;
+            capacity = newSize;
+        }
+
+        // Выделение памяти под count элементов без изменения размера
+        void Reserve(size_t count) {
+            if (count <= capacity) return;
+            T *newData = new T[count];
+            for (size_t i = 0; i < size; i++) {
+                newData[i] = std::move(data[i]);
+            }
+            delete[] data;
+            data = newData;
+            capacity = count;
         }
 };
 
@@ -0,0 +1,133 @@
+#ifndef HASHTABLE_HPP
+#define HASHTABLE_HPP
+
+#include <vector>
+#include <cstdint>
+#include <utility>
+#include <stdexcept>
+#include <functional>
+
+
+// Хеш-таблица с открытой адресацией и линейным пробированием
+// Ключи, значения и хеши лежат в плотных массивах в порядке вставки
+// Ячейка таблицы - 64 бита: старшая половина хеша для отсева несовпадений и номер записи
+template <typename K, typename V, typename Hash = std::hash<K>, typename Equal = std::equal_to<K>>
+class HashTable {
+    public:
+        static constexpr size_t NOT_FOUND = SIZE_MAX;
+    private:
+        static constexpr size_t MIN_CAPACITY = 16;
+        std::vector<K> keys;
+        std::vector<V> values;
+        std::vector<size_t> hashes;
+        std::vector<uint64_t> slots;
+        size_t mask;
+        Hash hasher;
+        Equal equal;
+
+        // Перемешивание битов: std::hash для целых - тождественная функция
+        static size_t Mix(size_t hash) {
+            uint64_t value = hash;
+            value ^= value >> 33;
+            value *= 0xff51afd7ed558ccdULL;
+            value ^= value >> 33;
+            return static_cast<size_t>(value);
+        }
+
+        static uint64_t Tag(size_t hash) {
+            return static_cast<uint64_t>(hash) >> 32;
+        }
+
+        static uint64_t Cell(size_t hash, size_t entry) {
+            return (Tag(hash) << 32) | static_cast<uint64_t>(entry+1);
+        }
+
+        size_t FindSlot(const K &key, size_t hash) const {
+            for (size_t slot = hash & mask; ; slot = (slot+1) & mask) {
+                uint64_t cell = slots[slot];
+                if (cell == 0) return slot;
+                if ((cell >> 32) == Tag(hash) && equal(keys[(cell & UINT32_MAX)-1], key)) return slot;
+            }
+        }
+
+        void Rehash(size_t capacity) {
+            slots.assign(capacity, 0);
+            mask = capacity-1;
+            for (size_t entry = 0; entry < hashes.size(); entry++) {
+                size_t slot = hashes[entry] & mask;
+                while (slots[slot] != 0) slot = (slot+1) & mask;
+                slots[slot] = Cell(hashes[entry], entry);
+            }
+        }
+
+        // Заполнение не выше 3/4
+        static size_t CapacityFor(size_t count) {
+            size_t capacity = MIN_CAPACITY;
+            while (capacity*3 < count*4) capacity *= 2;
+            return capacity;
+        }
+    public:
+        // Создание объекта
+        explicit HashTable(size_t expected = 0, Hash hash = Hash(), Equal eq = Equal()): hasher(hash), equal(eq) {
+            Reserve(expected);
+            if (slots.empty()) Rehash(MIN_CAPACITY);
+        }
+
+        // Декомпозиция
+        size_t GetCount() const { return keys.size(); }
+        size_t GetCapacity() const { return slots.size(); }
+
+        size_t Find(const K &key) const {
+            uint64_t cell = slots[FindSlot(key, Mix(hasher(key)))];
+            return cell ? (cell & UINT32_MAX)-1 : NOT_FOUND;
+        }
+
+        bool Contains(const K &key) const { return Find(key) != NOT_FOUND; }
+
+        const K& GetKey(size_t entry) const { return keys.at(entry); }
+        V& GetValue(size_t entry) { return values.at(entry); }
+        const V& GetValue(size_t entry) const { return values.at(entry); }
+
+        size_t GetMemoryUsage() const {
+            return keys.capacity()*sizeof(K)+values.capacity()*sizeof(V)+hashes.capacity()*sizeof(size_t)+slots.capacity()*sizeof(uint64_t);
+        }
+
+        // Операции
+        void Reserve(size_t count) {
+            keys.reserve(count);
+            values.reserve(count);
+            hashes.reserve(count);
+            size_t capacity = CapacityFor(count);
+            if (capacity > slots.size()) Rehash(capacity);
+        }
+
+        // Номер записи и признак новой вставки; существующее значение не заменяется
+        std::pair<size_t, bool> Insert(const K &key, const V &value) {
+            size_t hash = Mix(hasher(key));
+            size_t slot = FindSlot(key, hash);
+            if (slots[slot] != 0) return std::make_pair(static_cast<size_t>((slots[slot] & UINT32_MAX)-1), false);
+            if (keys.size() >= UINT32_MAX-1) throw std::length_error("Слишком много записей в хеш-таблице!");
+            if ((keys.size()+1)*4 > slots.size()*3) {
+                Rehash(slots.size()*2);
+                slot = FindSlot(key, hash);
+            }
+            keys.push_back(key);
+            values.push_back(value);
+            hashes.push_back(hash);
+            slots[slot] = Cell(hash, keys.size()-1);
+            return std::make_pair(keys.size()-1, true);
+        }
+
+        V& GetOrInsert(const K &key, const V &initial) {
+            return values[Insert(key, initial).first];
+        }
+
+        void Clear() {
+            keys.clear();
+            values.clear();
+            hashes.clear();
+            Rehash(MIN_CAPACITY);
+        }
+};
+
+#endif // HASHTABLE_HPP
@@ -0,0 +1,95 @@
+#ifndef LOSERTREE_HPP
+#define LOSERTREE_HPP
+
+#include <vector>
+#include <utility>
+#include <stdexcept>
+#include <functional>
+
+
+// Дерево проигравших для k-путевого слияния: выбор следующего минимума за log k сравнений
+// Узлы 1..k-1 хранят проигравших, узел 0 - победителя; при равенстве ключей побеждает меньший номер источника
+template <typename T, typename Compare = std::less<T>>
+class LoserTree {
+    private:
+        std::vector<T> keys;
+        std::vector<bool> active;
+        std::vector<size_t> tree;
+        Compare less;
+
+        bool Beats(size_t a, size_t b) const {
+            if (!active[a] || !active[b]) return active[a] || (!active[b] && a < b);
+            if (less(keys[a], keys[b])) return true;
+            if (less(keys[b], keys[a])) return false;
+            return a < b;
+        }
+
+        // Повтор турнира от листа source до корня
+        void Replay(size_t source) {
+            size_t winner = source;
+            for (size_t node = (source+keys.size())/2; node >= 1; node /= 2) {
+                if (Beats(tree[node], winner)) std::swap(tree[node], winner);
+            }
+            tree[0] = winner;
+        }
+    public:
+        // Создание объекта
+        explicit LoserTree(size_t count, Compare compare = Compare()):
+            keys(count), active(count, false), tree(count ? count : 1, 0), less(compare) {
+            if (count == 0) throw std::invalid_argument("Число источников должно быть положительным!");
+        }
+
+        // Декомпозиция
+        size_t GetSourceCount() const { return keys.size(); }
+
+        bool IsEmpty() const { return !active[tree[0]]; }
+
+        size_t Top() const {
+            if (IsEmpty()) throw std::out_of_range("Все источники исчерпаны!");
+            return tree[0];
+        }
+
+        const T& TopKey() const { return keys[Top()]; }
+
+        T& TopKey() { return keys[Top()]; }
+
+        // Операции
+        // Начальная загрузка: ключи источников задаются до Build
+        void Set(size_t source, T key) {
+            keys.at(source) = std::move(key);
+            active[source] = true;
+        }
+
+        void Build() {
+            size_t count = keys.size();
+            std::vector<size_t> winners(2*count);
+            for (size_t source = 0; source < count; source++) winners[count+source] = source;
+            for (size_t node = count-1; node >= 1; node--) {
+                size_t a = winners[2*node], b = winners[2*node+1];
+                if (Beats(a, b)) {
+                    winners[node] = a;
+                    tree[node] = b;
+                } else {
+                    winners[node] = b;
+                    tree[node] = a;
+                }
+            }
+            tree[0] = (count == 1) ? 0 : winners[1];
+        }
+
+        // Замена ключа победителя следующим элементом того же источника
+        void Replace(T key) {
+            size_t source = Top();
+            keys[source] = std::move(key);
+            Replay(source);
+        }
+
+        // Источник победителя исчерпан
+        void Pop() {
+            size_t source = Top();
+            active[source] = false;
+            Replay(source);
+        }
+};
+
+#endif // LOSERTREE_HPP
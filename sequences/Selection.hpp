@@ -0,0 +1,59 @@
+#ifndef SELECTION_HPP
+#define SELECTION_HPP
+
+#include <vector>
+#include <algorithm>
+#include <stdexcept>
+#include <functional>
+
+
+// Ограниченная куча k лучших элементов (первых в порядке less); на вершине худший из отобранных
+template <typename T, typename Compare = std::less<T>>
+class TopKHeap {
+    private:
+        std::vector<T> items;
+        size_t capacity;
+        Compare less;
+    public:
+        // Создание объекта
+        explicit TopKHeap(size_t k, Compare compare = Compare()): capacity(k), less(compare) {
+            items.reserve(k);
+        }
+
+        // Декомпозиция
+        size_t GetCount() const { return items.size(); }
+        size_t GetCapacity() const { return capacity; }
+        bool IsFull() const { return items.size() == capacity; }
+
+        const T& GetWorst() const {
+            if (items.empty()) throw std::out_of_range("Куча пуста!");
+            return items.front();
+        }
+
+        // Отобранные элементы в порядке less
+        std::vector<T> GetSorted() const {
+            std::vector<T> result(items);
+            std::sort_heap(result.begin(), result.end(), less);
+            return result;
+        }
+
+        // Операции
+        bool Push(const T &value) {
+            if (items.size() < capacity) {
+                items.push_back(value);
+                std::push_heap(items.begin(), items.end(), less);
+                return true;
+            }
+            if (capacity == 0 || !less(value, items.front())) return false;
+            std::pop_heap(items.begin(), items.end(), less);
+            items.back() = value;
+            std::push_heap(items.begin(), items.end(), less);
+            return true;
+        }
+
+        void Merge(const TopKHeap<T, Compare> &other) {
+            for (const T &value : other.items) Push(value);
+        }
+};
+
+#endif // SELECTION_HPP
@@ -5,7 +5,16 @@
 #include <vector>
 #include <algorithm>
 #include <stdexcept>
+#include <cstdio>
+#include <cmath>
+#include <climits>
+#include <numeric>
+#include <atomic>
+#include <unordered_map>
 #include "../LazySequence.hpp"
+#include "../Recurrence.hpp"
+#include "../Pipeline.hpp"
+#include "../Random.hpp"
 #include "../sequences/ArraySequence.hpp"
 using namespace std;
 
@@ -416,6 +425,1258 @@ TEST_F(LazySequenceTest, CopyConstructor) {
     delete modified;
 }
 
+// Тесты снимков состояния
+static shared_ptr<Generator<int>> CreateCheckpointGenerator(shared_ptr<int> counter, int cost = 0) {
+    return make_shared<Generator<int>>(
+        [counter, cost]() {
+            double work = 0;
+            for (int i = 0; i < cost; i++) work += sqrt(static_cast<double>(i+*counter));
+            int value = (*counter)*(*counter);
+            (*counter)++;
+            return work < 0 ? -value : value;
+        },
+        []() { return true; },
+        [counter]() { return to_string(*counter); },
+        [counter](const string &state) { *counter = stoi(state); }
+    );
+}
+
+TEST_F(LazySequenceTest, Snapshot_SaveAndRestore) {
+    const string filename = "test_snapshot.tmp";
+    auto counter = make_shared<int>(0);
+    LazySequence<int> seq(CreateCheckpointGenerator(counter), Cardinal::Finite(100));
+    EXPECT_EQ(seq.Get(49), 49*49);
+    seq.SaveSnapshot(filename);
+
+    auto restoredCounter = make_shared<int>(0);
+    auto restored = LazySequence<int>::LoadSnapshot(filename, CreateCheckpointGenerator(restoredCounter));
+    EXPECT_EQ(restored->GetLength(), 100);
+    EXPECT_EQ(restored->GetMaterializedCount(), 50);
+    EXPECT_EQ(*restoredCounter, 50);
+    EXPECT_EQ(restored->Get(10), 100);
+    EXPECT_EQ(restored->Get(99), 99*99);
+    remove(filename.c_str());
+}
+
+TEST_F(LazySequenceTest, Snapshot_InvalidFile) {
+    const string filename = "test_snapshot.tmp";
+    LazySequence<double> seq = LazySequence<double>(DynamicArray<double>(3));
+    seq.SaveSnapshot(filename);
+    EXPECT_THROW(LazySequence<int>::LoadSnapshot(filename), runtime_error);
+    EXPECT_THROW(LazySequence<int>::LoadSnapshot("missing_snapshot.tmp"), runtime_error);
+
+    auto counter = make_shared<int>(0);
+    LazySequence<int> partial(CreateCheckpointGenerator(counter), Cardinal::Infinite());
+    partial.Get(5);
+    partial.SaveSnapshot(filename);
+    EXPECT_THROW(LazySequence<int>::LoadSnapshot(filename), runtime_error);
+
+    // Число элементов, при котором размер в байтах переполняется и совпадает с длиной файла
+    LazySequence<int> small(DynamicArray<int>(4));
+    small.SaveSnapshot(filename);
+    {
+        fstream patch(filename, ios::in | ios::out | ios::binary);
+        const streamoff COUNT_OFFSET = 8+4+4+8+8;
+        uint64_t count = 4+(1ULL << 62);
+        patch.seekp(COUNT_OFFSET);
+        patch.write(reinterpret_cast<const char*>(&count), sizeof(count));
+    }
+    EXPECT_THROW(LazySequence<int>::LoadSnapshot(filename), runtime_error);
+    remove(filename.c_str());
+}
+
+TEST_F(LazySequenceTest, Performance_SnapshotRestoreVsRegeneration) {
+    const string filename = "test_snapshot.tmp";
+    const int SIZE = 20000;
+
+    auto counter = make_shared<int>(0);
+    LazySequence<int> cold(CreateCheckpointGenerator(counter), Cardinal::Finite(SIZE));
+    int coldLast = cold.GetLast();
+    EXPECT_EQ(*counter, SIZE);
+    cold.SaveSnapshot(filename);
+
+    // Восстановленный кеш отдаёт все элементы без единого вызова генератора
+    auto restoredCounter = make_shared<int>(0);
+    auto restored = LazySequence<int>::LoadSnapshot(filename, CreateCheckpointGenerator(restoredCounter));
+    EXPECT_EQ(restored->GetMaterializedCount(), SIZE);
+    EXPECT_EQ(restored->GetLast(), coldLast);
+    EXPECT_EQ(restored->Get(SIZE/2), (SIZE/2)*(SIZE/2));
+    EXPECT_EQ(*restoredCounter, 0);
+    remove(filename.c_str());
+}
+
+// Тесты рекуррентных последовательностей
+TEST_F(LazySequenceTest, Recurrence_WindowedFibonacci) {
+    long long items[] = {0, 1};
+    auto fib = Recurrence<long long>::Create(
+        [](const RecurrenceWindow<long long> &window) { return window[0]+window[1]; },
+        LazySequence<long long>(items, 2)
+    );
+    long long expected[] = {0, 1, 1, 2, 3, 5, 8, 13, 21, 34, 55};
+    for (int i = 0; i < 11; i++) {
+        EXPECT_EQ(fib->Get(i), expected[i]);
+    }
+    EXPECT_EQ(fib->Get(90), 2880067194370816120LL);
+}
+
+TEST_F(LazySequenceTest, Recurrence_WindowedCheckpoint) {
+    int items[] = {1, 1, 1};
+    auto gen = Recurrence<int>::CreateGenerator(
+        [](const RecurrenceWindow<int> &window) { return window[0]+window[1]+window[2]; },
+        LazySequence<int>(items, 3)
+    );
+    for (int i = 0; i < 10; i++) gen->GetNext();
+    string state = gen->SaveState();
+    int next = gen->GetNext();
+    auto resumed = Recurrence<int>::CreateGenerator(
+        [](const RecurrenceWindow<int> &window) { return window[0]+window[1]+window[2]; },
+        LazySequence<int>(items, 3)
+    );
+    resumed->LoadState(state);
+    EXPECT_EQ(resumed->GetNext(), next);
+}
+
+TEST_F(LazySequenceTest, Recurrence_LinearJumpAhead) {
+    const long long MOD = 1000000007LL;
+    long long coeffs[] = {1, 1};
+    long long init[] = {0, 1};
+    LinearRecurrence<long long> fib(LazySequence<long long>(coeffs, 2), LazySequence<long long>(init, 2), MOD);
+
+    // Сравнение с последовательным вычислением
+    auto seq = fib.ToLazySequence();
+    auto gen = fib.CreateGenerator();
+    for (size_t i = 0; i < 500; i++) {
+        long long value = gen->GetNext();
+        EXPECT_EQ(fib.At(i), value);
+        EXPECT_EQ(seq->Get(i), value);
+    }
+
+    // F(2n) = F(n)*(2F(n+1)-F(n))
+    size_t n = 100000000000000000ULL;
+    long long fn = seq->Get(n);
+    long long fn1 = seq->Get(n+1);
+    long long f2n = seq->Get(2*n);
+    EXPECT_EQ(f2n, fn*(((2*fn1-fn)%MOD+MOD)%MOD)%MOD);
+    EXPECT_LT(seq->GetMaterializedCount(), 1000);
+
+    // Модуль больше 2^32: произведения остатков не помещаются в 64 бита
+    const long long BIG = 10000000019LL;
+    LinearRecurrence<long long> big(LazySequence<long long>(coeffs, 2), LazySequence<long long>(init, 2), BIG);
+    long long previous = 0, current = 1;
+    for (size_t i = 2; i <= 1000; i++) {
+        long long next = (previous+current) % BIG;
+        previous = current;
+        current = next;
+    }
+    EXPECT_EQ(big.At(1000), current);
+    long long negative[] = {-1, 1};
+    EXPECT_THROW(LinearRecurrence<long long>(LazySequence<long long>(negative, 2), LazySequence<long long>(init, 2), -BIG), invalid_argument);
+}
+
+TEST_F(LazySequenceTest, Recurrence_LinearHigherOrder) {
+    // Трибоначчи без модуля
+    long long coeffs[] = {1, 1, 1};
+    long long init[] = {0, 0, 1};
+    LinearRecurrence<long long> trib(LazySequence<long long>(coeffs, 3), LazySequence<long long>(init, 3));
+    long long expected[] = {0, 0, 1, 1, 2, 4, 7, 13, 24, 44, 81, 149};
+    for (int i = 0; i < 12; i++) {
+        EXPECT_EQ(trib.At(i), expected[i]);
+    }
+    // Без модуля переполнение не маскируется
+    long long window[] = {0, 0, 1};
+    for (int i = 3; i <= 60; i++) {
+        long long next = window[0]+window[1]+window[2];
+        window[0] = window[1];
+        window[1] = window[2];
+        window[2] = next;
+    }
+    EXPECT_EQ(trib.At(60), window[2]);
+    EXPECT_THROW(trib.At(100), overflow_error);
+    EXPECT_THROW(LinearRecurrence<long long>(LazySequence<long long>(coeffs, 3), LazySequence<long long>(init, 2)), invalid_argument);
+}
+
+// Тесты фильтрации с индексом совпадений
+TEST_F(LazySequenceTest, Where_SparseFilterBeyondScanLimit) {
+    LazySequence<int> seq = CreateNumberSequence(0, 100000);
+    auto calls = make_shared<size_t>(0);
+    auto filtered = seq.Where([calls](int x) { (*calls)++; return x % 5000 == 0; });
+
+    for (int i = 0; i < 20; i++) {
+        EXPECT_EQ(filtered->Get(i), i*5000);
+    }
+    EXPECT_THROW(filtered->Get(20), out_of_range);
+    size_t firstPass = *calls;
+    EXPECT_EQ(firstPass, 100000);
+
+    // Повторный проход не вызывает предикат
+    for (int i = 19; i >= 0; i--) {
+        EXPECT_EQ(filtered->Get(i), i*5000);
+    }
+    EXPECT_EQ(*calls, firstPass);
+    delete filtered;
+}
+
+TEST_F(LazySequenceTest, Where_IndexAddressableInfiniteSource) {
+    LazySequence<long long> naturals([](size_t i) { return static_cast<long long>(i); });
+    auto even = naturals.Where([](long long x) { return x % 2 == 0; });
+    EXPECT_EQ(even->Get(0), 0);
+    EXPECT_EQ(even->Get(30000), 60000);
+    EXPECT_EQ(even->Get(12345), 24690);
+    EXPECT_LT(even->GetMaterializedCount(), 10);
+    delete even;
+}
+
+TEST_F(LazySequenceTest, Where_InfiniteGeneratorSource) {
+    auto counter = make_shared<int>(0);
+    LazySequence<int> naturals(make_shared<Generator<int>>([counter]() { return (*counter)++; }));
+    auto sparse = naturals.Where([](int x) { return x % 1000 == 0; });
+    EXPECT_EQ(sparse->GetCardinal(), Cardinal::Unknown());
+    for (int i = 0; i < 6; i++) {
+        EXPECT_EQ(sparse->Get(i), i*1000);
+    }
+    EXPECT_EQ(sparse->Get(2), 2000);
+    EXPECT_EQ(naturals.GetMaterializedCount(), 0);
+    EXPECT_EQ(naturals.Get(1), 1);
+    delete sparse;
+}
+
+TEST_F(LazySequenceTest, DeltaIndex_AppendGetLowerBound) {
+    DeltaIndex index;
+    for (uint64_t i = 0; i < 1000; i++) {
+        index.Append(i*i);
+    }
+    EXPECT_EQ(index.GetCount(), 1000);
+    EXPECT_EQ(index.GetLast(), 999ULL*999ULL);
+    for (size_t i = 0; i < 1000; i += 37) {
+        EXPECT_EQ(index.Get(i), i*i);
+    }
+    EXPECT_EQ(index.LowerBound(0), 0);
+    EXPECT_EQ(index.LowerBound(50), 8);
+    EXPECT_EQ(index.LowerBound(64*64), 64);
+    EXPECT_EQ(index.LowerBound(64*64-1), 64);
+    EXPECT_EQ(index.LowerBound(999ULL*999ULL+1), 1000);
+    EXPECT_LT(index.GetMemoryUsage(), 1000*sizeof(uint64_t));
+    EXPECT_THROW(index.Get(1000), out_of_range);
+    EXPECT_THROW(index.Append(5), invalid_argument);
+}
+
+// Тесты свёртки
+TEST_F(LazySequenceTest, Fold_EarlyTermination) {
+    LazySequence<int> naturals([](size_t i) { return static_cast<int>(i); });
+    int sum = naturals.Fold<int>(
+        [](int acc, int x) { return acc+x; }, 0,
+        [](const int &acc) { return acc > 100; }
+    );
+    EXPECT_EQ(sum, 105);
+    EXPECT_THROW(naturals.Fold<int>([](int acc, int x) { return acc+x; }, 0), runtime_error);
+
+    // Неизвестная длина: свёртка до конца источника без ограничения числа элементов
+    LazySequence<int> seq = CreateNumberSequence(0, 5000);
+    auto filtered = seq.Where([](int x) { return x % 2 == 1; });
+    EXPECT_EQ(filtered->Reduce<long long>([](long long acc, int x) { return acc+x; }, 0), 2500LL*2500LL);
+    delete filtered;
+}
+
+TEST_F(LazySequenceTest, Fold_GeneratorSourceWithoutMaterialization) {
+    auto counter = make_shared<long long>(0);
+    LazySequence<long long> naturals(make_shared<Generator<long long>>([counter]() { return (*counter)++; }));
+    long long sum = naturals.Fold<long long>(
+        [](long long acc, long long x) { return acc+x; }, 0,
+        [](const long long &acc) { return acc > 200000000LL; }
+    );
+    EXPECT_EQ(sum, 20000LL*20001/2);
+    EXPECT_EQ(naturals.GetMaterializedCount(), 0);
+
+    const size_t SIZE = 200000;
+    auto finiteCounter = make_shared<long long>(0);
+    LazySequence<long long> finite(make_shared<Generator<long long>>([finiteCounter]() { return (*finiteCounter)++; }), Cardinal::Finite(SIZE));
+    EXPECT_EQ(finite.Get(9), 9);
+    size_t maxBuffered = 0;
+    EXPECT_EQ(finite.Reduce<long long>([&](long long acc, long long x) {
+        maxBuffered = max(maxBuffered, finite.GetBufferedCount());
+        return acc+x;
+    }, 0), static_cast<long long>(SIZE)*(SIZE-1)/2);
+    EXPECT_EQ(finite.GetMaterializedCount(), 10);
+    EXPECT_EQ(maxBuffered, 0);
+    // Длинный остаток прочитан самой последовательностью: кеш доступен, генератор - нет
+    EXPECT_EQ(finite.Get(9), 9);
+    EXPECT_THROW(finite.Get(10), runtime_error);
+
+    // Рекуррентная последовательность по всей истории
+    long long init[] = {0, 1};
+    ArraySequence<long long> start(init, 2);
+    LazySequence<long long> fibonacci([](DynamicArray<long long> *history) {
+        size_t count = history->GetSize();
+        return (*history)[count-1]+(*history)[count-2];
+    }, &start);
+    LazySequence<long long> copy(fibonacci);
+    EXPECT_EQ(fibonacci.Get(50), 12586269025LL);
+    EXPECT_EQ(copy.Get(40), 102334155LL);
+}
+
+TEST_F(LazySequenceTest, Reduce_DoesNotConsumeSharedGenerator) {
+    auto counter = make_shared<int>(0);
+    auto generator = make_shared<Generator<int>>(
+        [counter]() { return (*counter)++; },
+        [counter]() { return *counter < 10; }
+    );
+    LazySequence<int> seq(generator, Cardinal::Finite(10));
+    EXPECT_EQ(seq.Get(2), 2);
+    EXPECT_EQ(seq.Reduce<int>([](int acc, int x) { return acc+x; }, 0), 45);
+    EXPECT_EQ(seq.Reduce<int>([](int acc, int x) { return acc+x; }, 0), 45);
+    EXPECT_EQ(seq.Get(9), 9);
+}
+
+TEST_F(LazySequenceTest, ParallelReduce_IndexAddressableAndMaterialized) {
+    const size_t SIZE = 1000000;
+    LazySequence<long long> indexed([](size_t i) { return static_cast<long long>(i); }, Cardinal::Finite(SIZE));
+    auto add = [](long long acc, long long x) { return acc+x; };
+    long long expected = static_cast<long long>(SIZE)*(SIZE-1)/2;
+    EXPECT_EQ(indexed.ParallelReduce<long long>(add, add, 0, 4), expected);
+    EXPECT_EQ(indexed.GetMaterializedCount(), 0);
+
+    auto counter = make_shared<long long>(0);
+    auto generator = make_shared<Generator<long long>>([counter]() { return (*counter)++; });
+    LazySequence<long long> generated(generator, Cardinal::Finite(100000));
+    long long minimum = generated.ParallelReduce<long long>(
+        [](long long acc, long long x) { return min(acc, x); },
+        [](long long a, long long b) { return min(a, b); },
+        LLONG_MAX, 4
+    );
+    EXPECT_EQ(minimum, 0);
+    EXPECT_EQ(generated.ParallelReduce<long long>(add, add, 0, 3), 100000LL*99999/2);
+}
+
+// Тесты конвейеров времени компиляции
+TEST_F(LazySequenceTest, Pipeline_MapWhereTake) {
+    int items[] = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10};
+    auto pipeline = Pipeline::From(items, 10)
+        | Pipeline::Map([](int x) { return x*10; })
+        | Pipeline::Where([](int x) { return x % 20 == 0; })
+        | Pipeline::Take(3);
+    vector<int> result;
+    pipeline.ForEach([&result](int x) { result.push_back(x); });
+    EXPECT_EQ(result, vector<int>({20, 40, 60}));
+
+    auto squares = Pipeline::Range<long long>(0, 1000) | Pipeline::Skip(10) | Pipeline::Map([](long long x) { return x*x; });
+    EXPECT_EQ(squares.Count(), 990);
+    auto doubled = Pipeline::Range<int>(0, 5) | Pipeline::Map([](int x) { return x*2.5; });
+    EXPECT_DOUBLE_EQ(doubled.Sum(), 25.0);
+
+    // Граница типа: ни число элементов, ни последний шаг не переполняются
+    auto tail = Pipeline::Range<int>(numeric_limits<int>::max()-10, numeric_limits<int>::max(), 4);
+    EXPECT_EQ(tail.GetSizeHint(), Cardinal::Finite(3));
+    EXPECT_EQ(tail.Count(), 3);
+    EXPECT_EQ(Pipeline::Range<int>(numeric_limits<int>::min(), numeric_limits<int>::max(), 1 << 30).Count(), 4);
+    EXPECT_THROW(Pipeline::Range<int>(0, 10, 0), invalid_argument);
+    EXPECT_THROW(Pipeline::Range<double>(0.0, 1.0, -0.5), invalid_argument);
+}
+
+TEST_F(LazySequenceTest, Pipeline_LazySequenceBoundary) {
+    auto source = make_shared<LazySequence<int>>(CreateNumberSequence(1, 100));
+    auto lazy = (Pipeline::From(source)
+        | Pipeline::Where([](int x) { return x % 3 == 0; })
+        | Pipeline::Map([](int x) { return to_string(x); })).ToLazySequence();
+    EXPECT_EQ(lazy->Get(0), "3");
+    EXPECT_EQ(lazy->Get(32), "99");
+    EXPECT_THROW(lazy->Get(33), out_of_range);
+
+    // Источник неизвестной длины
+    auto filtered = shared_ptr<LazySequence<int>>(source->Where([](int x) { return x > 95; }));
+    EXPECT_EQ((Pipeline::From(filtered) | Pipeline::Map([](int x) { return x-95; })).Sum(), 15);
+
+    // Бесконечный генератор: Take за пределами лимита кеша, источник не запоминается
+    auto counter = make_shared<long long>(0);
+    auto naturals = make_shared<LazySequence<long long>>(make_shared<Generator<long long>>([counter]() { return (*counter)++; }));
+    EXPECT_EQ((Pipeline::From(naturals) | Pipeline::Take(20000)).Sum(), 20000LL*19999/2);
+    EXPECT_EQ(naturals->GetMaterializedCount(), 0);
+}
+
+TEST_F(LazySequenceTest, Performance_PipelineVsHandWrittenLoop) {
+    const size_t SIZE = 2000000;
+    DynamicArray<int> data(SIZE);
+    for (size_t i = 0; i < SIZE; i++) data[i] = static_cast<int>(i % 1000);
+
+    long long handSum = 0;
+    for (size_t i = 0; i < SIZE; i++) {
+        long long value = data[i]*3LL;
+        if (value % 2 == 0) handSum += value;
+    }
+
+    // Слитый конвейер - один проход: каждое преобразование вызывается ровно один раз на элемент
+    size_t mapCalls = 0, whereCalls = 0;
+    long long fusedSum = (Pipeline::From(data)
+        | Pipeline::Map([&mapCalls](int x) { mapCalls++; return x*3LL; })
+        | Pipeline::Where([&whereCalls](long long x) { whereCalls++; return x % 2 == 0; })).Sum();
+    EXPECT_EQ(mapCalls, SIZE);
+    EXPECT_EQ(whereCalls, SIZE);
+
+    LazySequence<int> lazy(data);
+    auto mapped = lazy.Map<long long>([](int x) { return x*3LL; });
+    auto filtered = mapped->Where([](long long x) { return x % 2 == 0; });
+    long long lazySum = filtered->Reduce<long long>([](long long acc, long long x) { return acc+x; }, 0);
+    delete mapped;
+    delete filtered;
+
+    EXPECT_EQ(fusedSum, handSum);
+    EXPECT_EQ(lazySum, handSum);
+}
+
+// Тесты оценки длины
+TEST_F(LazySequenceTest, Cardinal_BoundsArithmetic) {
+    Cardinal five = Cardinal::Finite(5);
+    Cardinal bounded = Cardinal::Bounded(2, 10);
+    EXPECT_EQ(five+Cardinal::Finite(3), Cardinal::Finite(8));
+    EXPECT_EQ(five+bounded, Cardinal::Bounded(7, 15));
+    EXPECT_EQ(bounded+Cardinal::Infinite(), Cardinal::Infinite());
+    EXPECT_FALSE((bounded+Cardinal::Unknown()).HasUpperBound());
+    EXPECT_EQ((bounded+Cardinal::Unknown()).GetLowerBound(), 2);
+    EXPECT_EQ(five.Filtered(), Cardinal::AtMost(5));
+    EXPECT_EQ(Cardinal::Infinite().Filtered(), Cardinal::Unknown());
+    EXPECT_EQ(Cardinal::Infinite().Clamp(4), Cardinal::Finite(4));
+    EXPECT_EQ(bounded.Clamp(4), Cardinal::Bounded(2, 4));
+    EXPECT_EQ(bounded.Skip(3), Cardinal::Bounded(0, 7));
+    EXPECT_EQ(Cardinal::Bounded(3, 3), Cardinal::Finite(3));
+    EXPECT_THROW(Cardinal::Unknown().GetUpperBound(), runtime_error);
+    EXPECT_THROW(Cardinal::Bounded(5, 1), invalid_argument);
+}
+
+TEST_F(LazySequenceTest, Cardinal_PropagationThroughOperations) {
+    LazySequence<int> seq = CreateNumberSequence(1, 10);
+    auto filtered = seq.Where([](int x) { return x > 3; });
+    EXPECT_EQ(filtered->GetCardinal(), Cardinal::AtMost(10));
+    auto concatenated = dynamic_cast<LazySequence<int>*>(filtered->Concat(&seq));
+    EXPECT_EQ(concatenated->GetCardinal(), Cardinal::Bounded(10, 20));
+    auto mapped = filtered->Map<int>([](int x) { return x*2; });
+    EXPECT_EQ(mapped->GetCardinal(), Cardinal::AtMost(10));
+    auto prepended = dynamic_cast<LazySequence<int>*>(filtered->Prepend(0));
+    EXPECT_EQ(prepended->GetCardinal(), Cardinal::Bounded(1, 11));
+    EXPECT_EQ(concatenated->Get(6), 10);
+    EXPECT_EQ(concatenated->Get(7), 1);
+
+    int items[] = {1, 2, 3, 4, 5, 6};
+    auto pipeline = (Pipeline::From(items, 6) | Pipeline::Where([](int x) { return x % 2 == 0; }) | Pipeline::Take(2)).ToLazySequence();
+    EXPECT_EQ(pipeline->GetCardinal(), Cardinal::AtMost(2));
+    delete filtered;
+    delete concatenated;
+    delete mapped;
+    delete prepended;
+}
+
+TEST_F(LazySequenceTest, Cardinal_PreallocatingConsumers) {
+    auto source = make_shared<ArraySequence<int>>();
+    for (int i = 0; i < 1000; i++) source->Append(i);
+    auto evens = dynamic_cast<ArraySequence<int>*>(source->Where([](int x) { return x % 2 == 0; }));
+    EXPECT_EQ(evens->GetLength(), 500);
+    EXPECT_EQ(evens->Get(499), 998);
+    delete evens;
+}
+
+// Тесты операторов разбиения
+TEST_F(LazySequenceTest, SkipTake_IndexAddressableSource) {
+    auto calls = make_shared<size_t>(0);
+    LazySequence<long long> squares([calls](size_t i) { (*calls)++; return static_cast<long long>(i)*i; });
+    auto skipped = squares.Skip(1000000);
+    auto page = skipped->Take(3);
+    EXPECT_EQ(page->GetCardinal(), Cardinal::Finite(3));
+    EXPECT_EQ(page->Get(0), 1000000LL*1000000);
+    EXPECT_EQ(page->Get(2), 1000002LL*1000002);
+    EXPECT_THROW(page->Get(3), out_of_range);
+    EXPECT_EQ(*calls, 3);
+
+    LazySequence<int> seq = CreateNumberSequence(1, 10);
+    auto tail = seq.Skip(7);
+    EXPECT_EQ(tail->GetLength(), 3);
+    EXPECT_EQ(tail->Get(0), 8);
+    auto empty = seq.Skip(20);
+    EXPECT_EQ(empty->GetLength(), 0);
+    auto sub = seq.GetSubsequence(2, 4);
+    EXPECT_EQ(sub->GetLength(), 3);
+    EXPECT_EQ(sub->Get(2), 5);
+    delete skipped;
+    delete page;
+    delete tail;
+    delete empty;
+    delete sub;
+}
+
+TEST_F(LazySequenceTest, SkipTake_GeneratorSourceStreams) {
+    auto counter = make_shared<int>(0);
+    auto generator = make_shared<Generator<int>>([counter]() { return (*counter)++; });
+    LazySequence<int> naturals(generator);
+    // Пропуск за пределы лимита кеша бесконечной последовательности без материализации
+    auto skipped = naturals.Skip(50000);
+    auto page = skipped->Take(4);
+    EXPECT_EQ(page->GetLength(), 4);
+    EXPECT_EQ(page->Get(3), 50003);
+    EXPECT_EQ(naturals.GetMaterializedCount(), 0);
+
+    auto finite = make_shared<int>(0);
+    auto limited = make_shared<Generator<int>>([finite]() { return (*finite)++; }, [finite]() { return *finite < 5; });
+    LazySequence<int> unknown(limited, Cardinal::Unknown());
+    auto prefix = unknown.Take(10);
+    EXPECT_EQ(prefix->GetCardinal(), Cardinal::AtMost(10));
+    EXPECT_EQ(prefix->Get(4), 4);
+    EXPECT_THROW(prefix->Get(5), out_of_range);
+    delete skipped;
+    delete page;
+    delete prefix;
+}
+
+TEST_F(LazySequenceTest, TakeWhile_StopsAtFirstMismatch) {
+    auto counter = make_shared<int>(0);
+    LazySequence<int> naturals(make_shared<Generator<int>>([counter]() { return (*counter)++; }));
+    auto small = naturals.TakeWhile([](int x) { return x*x < 50; });
+    EXPECT_EQ(small->GetCardinal(), Cardinal::Unknown());
+    EXPECT_EQ(small->Get(7), 7);
+    EXPECT_THROW(small->Get(8), out_of_range);
+    EXPECT_EQ(small->Fold<int>([](int acc, int x) { return acc+x; }, 0), 28);
+    delete small;
+}
+
+TEST_F(LazySequenceTest, SkipTake_SourceUnchangedAfterDerivedRead) {
+    auto counter = make_shared<int>(0);
+    LazySequence<int> naturals(make_shared<Generator<int>>([counter]() { return (*counter)++; }));
+    EXPECT_EQ(naturals.Get(2), 2);
+    auto skipped = naturals.Skip(10);
+    EXPECT_EQ(skipped->Get(0), 10);
+    EXPECT_EQ(naturals.Get(0), 0);
+    EXPECT_EQ(naturals.Get(1), 1);
+    EXPECT_EQ(naturals.Get(5), 5);
+    EXPECT_EQ(skipped->Get(3), 13);
+
+    // Две производные последовательности читают общий источник независимо, повторный проход видит те же элементы
+    auto windows = naturals.Window(3);
+    auto chunks = naturals.Chunk(4);
+    EXPECT_EQ((*windows->Get(20))[2], 22);
+    EXPECT_EQ((*chunks->Get(1))[0], 4);
+    EXPECT_EQ(naturals.Get(30), 30);
+    auto again = naturals.Skip(10);
+    EXPECT_EQ(again->Get(0), 10);
+    EXPECT_EQ(*counter, 31);
+    delete skipped;
+    delete windows;
+    delete chunks;
+    delete again;
+}
+
+TEST_F(LazySequenceTest, SkipTake_LaggingSourceBufferBounded) {
+    const long long SIZE = 200000;
+    auto counter = make_shared<long long>(0);
+    LazySequence<long long> naturals(make_shared<Generator<long long>>([counter]() { return (*counter)++; }), Cardinal::Finite(SIZE));
+    EXPECT_EQ(naturals.Get(4), 4);
+    auto prefix = naturals.TakeWhile([](long long) { return true; });
+    size_t maxBuffered = 0;
+    long long sum = prefix->Fold<long long>([&](long long acc, long long x) {
+        maxBuffered = max(maxBuffered, naturals.GetBufferedCount());
+        return acc+x;
+    }, 0);
+    EXPECT_EQ(sum, SIZE*(SIZE-1)/2);
+    EXPECT_LE(maxBuffered, GeneratorTape<long long>::MAX_BUFFER);
+    EXPECT_EQ(naturals.GetBufferedCount(), 0);
+    // Источник отстал сильнее допустимого: вычисленные элементы доступны, новые - нет
+    EXPECT_EQ(naturals.Get(3), 3);
+    EXPECT_THROW(naturals.Get(5), runtime_error);
+    delete prefix;
+
+    // Последовательность со своим же сдвигом: копии идут почти вровень, простаивающий источник отключается
+    auto squares = make_shared<long long>(0);
+    LazySequence<long long> source(make_shared<Generator<long long>>([squares]() { long long n = (*squares)++; return n*n; }), Cardinal::Finite(60000));
+    auto shifted = source.Skip(1);
+    auto pairs = source.Zip(shifted);
+    long long differences = 0;
+    for (size_t i = 0; i < 50000; i++) {
+        auto row = pairs->Get(i);
+        differences += row.second-row.first;
+        ASSERT_LE(source.GetBufferedCount(), GeneratorTape<long long>::MAX_BUFFER) << i;
+    }
+    EXPECT_EQ(differences, 50000LL*50000LL);
+    EXPECT_EQ(*squares, 50001);
+    delete shifted;
+    delete pairs;
+}
+
+TEST_F(LazySequenceTest, ChunkWindow_FiniteAndStreamed) {
+    LazySequence<int> seq = CreateNumberSequence(1, 10);
+    auto chunks = seq.Chunk(4);
+    EXPECT_EQ(chunks->GetLength(), 3);
+    EXPECT_EQ(chunks->Get(1)->GetSize(), 4);
+    EXPECT_EQ((*chunks->Get(1))[0], 5);
+    EXPECT_EQ(chunks->Get(2)->GetSize(), 2);
+    EXPECT_EQ((*chunks->Get(2))[1], 10);
+
+    auto windows = seq.Window(3, 2);
+    EXPECT_EQ(windows->GetLength(), 4);
+    EXPECT_EQ((*windows->Get(3))[0], 7);
+    EXPECT_EQ((*windows->Get(3))[2], 9);
+    EXPECT_THROW(seq.Window(0), invalid_argument);
+
+    // Генератор неизвестной длины: окно хранится в кольцевом буфере
+    auto counter = make_shared<int>(0);
+    LazySequence<int> unknown(make_shared<Generator<int>>([counter]() { return ++(*counter); }, [counter]() { return *counter < 7; }), Cardinal::Unknown());
+    auto sliding = unknown.Window(3, 1);
+    vector<int> firsts;
+    for (size_t i = 0; ; i++) {
+        try {
+            auto window = sliding->Get(i);
+            EXPECT_EQ((*window)[2]-(*window)[0], 2);
+            firsts.push_back((*window)[0]);
+        } catch (const out_of_range&) {
+            break;
+        }
+    }
+    EXPECT_EQ(firsts, vector<int>({1, 2, 3, 4, 5}));
+
+    auto gapCounter = make_shared<int>(0);
+    LazySequence<int> gapped(make_shared<Generator<int>>([gapCounter]() { return (*gapCounter)++; }));
+    auto sparse = gapped.Window(2, 5);
+    EXPECT_EQ((*sparse->Get(2))[0], 10);
+    EXPECT_EQ((*sparse->Get(2))[1], 11);
+    auto batches = gapped.Chunk(3);
+    EXPECT_EQ(batches->GetCardinal(), Cardinal::Infinite());
+    delete chunks;
+    delete windows;
+    delete sliding;
+    delete sparse;
+    delete batches;
+}
+
+TEST_F(LazySequenceTest, FlatMap_ConcatenatesInnerSequences) {
+    LazySequence<int> seq = CreateNumberSequence(0, 4);
+    auto repeated = seq.FlatMap<int>([](int x) -> shared_ptr<Sequence<int>> {
+        auto inner = make_shared<ArraySequence<int>>();
+        for (int i = 0; i < x; i++) inner->Append(x);
+        return inner;
+    });
+    EXPECT_EQ(repeated->Fold<int>([](int acc, int x) { return acc+x; }, 0), 1+2*2+3*3);
+    EXPECT_EQ(repeated->Get(0), 1);
+    EXPECT_EQ(repeated->Get(5), 3);
+    EXPECT_THROW(repeated->Get(6), out_of_range);
+
+    auto digits = seq.FlatMap<char>([](int x) -> shared_ptr<Sequence<char>> {
+        string text = to_string(x*11);
+        return make_shared<LazySequence<char>>(DynamicArray<char>(text.data(), text.size()));
+    });
+    EXPECT_EQ(digits->Get(0), '0');
+    EXPECT_EQ(digits->Get(5), '3');
+    delete repeated;
+    delete digits;
+}
+
+// Тесты объединения последовательностей
+TEST_F(LazySequenceTest, Zip_RandomAccessAndStreamed) {
+    LazySequence<int> numbers = CreateNumberSequence(1, 5);
+    LazySequence<string> names([](size_t i) { return "n" + to_string(i); });
+    auto zipped = numbers.Zip(&names);
+    EXPECT_EQ(zipped->GetCardinal(), Cardinal::Finite(5));
+    EXPECT_EQ(zipped->Get(4), make_pair(5, string("n4")));
+    EXPECT_EQ(zipped->GetMaterializedCount(), 5);
+
+    auto counter = make_shared<int>(0);
+    LazySequence<int> squares(make_shared<Generator<int>>([counter]() { (*counter)++; return (*counter)*(*counter); }));
+    auto sums = numbers.ZipWith<int, int>(&squares, [](int a, int b) { return a+b; });
+    EXPECT_EQ(sums->Get(2), 3+9);
+    EXPECT_THROW(sums->Get(5), out_of_range);
+    EXPECT_EQ(squares.GetMaterializedCount(), 0);
+
+    LazySequence<double> halves([](size_t i) { return i/2.0; }, Cardinal::Finite(3));
+    auto triples = numbers.Zip(&names, &halves);
+    EXPECT_EQ(triples->GetCardinal(), Cardinal::Finite(3));
+    EXPECT_EQ(get<0>(triples->Get(2)), 3);
+    EXPECT_EQ(get<1>(triples->Get(2)), "n2");
+    EXPECT_DOUBLE_EQ(get<2>(triples->Get(2)), 1.0);
+    auto cubeCounter = make_shared<int>(0);
+    LazySequence<int> cubes(make_shared<Generator<int>>([cubeCounter]() { (*cubeCounter)++; return (*cubeCounter)*(*cubeCounter)*(*cubeCounter); }));
+    auto streamed = cubes.Zip(&names, &halves);
+    EXPECT_EQ(get<0>(streamed->Get(1)), 8);
+    EXPECT_THROW(streamed->Get(3), out_of_range);
+    delete zipped;
+    delete sums;
+    delete triples;
+    delete streamed;
+}
+
+TEST_F(LazySequenceTest, Unzip_SplitsPairsLazily) {
+    auto counter = make_shared<int>(0);
+    LazySequence<pair<int, int>> pairs(
+        make_shared<Generator<pair<int, int>>>([counter]() { (*counter)++; return make_pair(*counter, -(*counter)); }, [counter]() { return *counter < 6; }),
+        Cardinal::Unknown()
+    );
+    auto parts = LazySequence<int>::Unzip<int>(&pairs);
+    EXPECT_EQ(parts.first->Get(3), 4);
+    EXPECT_EQ(parts.second->Get(0), -1);
+    EXPECT_EQ(parts.second->Get(5), -6);
+    EXPECT_THROW(parts.first->Get(6), out_of_range);
+    EXPECT_EQ(parts.first->Get(5), 6);
+
+    LazySequence<pair<int, char>> indexed([](size_t i) { return make_pair(static_cast<int>(i), static_cast<char>('a'+i % 26)); }, Cardinal::Finite(100));
+    auto split = LazySequence<int>::Unzip<char>(&indexed);
+    EXPECT_EQ(split.second->Get(27), 'b');
+    EXPECT_EQ(split.first->GetLength(), 100);
+    delete parts.first;
+    delete parts.second;
+    delete split.first;
+    delete split.second;
+}
+
+TEST_F(LazySequenceTest, MergeSorted_LoserTreeKWayMerge) {
+    LoserTree<int> tree(3);
+    tree.Set(0, 5);
+    tree.Set(2, 1);
+    tree.Build();
+    EXPECT_EQ(tree.Top(), 2);
+    tree.Replace(7);
+    EXPECT_EQ(tree.TopKey(), 5);
+    tree.Pop();
+    EXPECT_EQ(tree.TopKey(), 7);
+    tree.Pop();
+    EXPECT_TRUE(tree.IsEmpty());
+
+    LazySequence<int> evens([](size_t i) { return static_cast<int>(2*i); }, Cardinal::Finite(5));
+    LazySequence<int> odds([](size_t i) { return static_cast<int>(2*i+1); }, Cardinal::Finite(3));
+    auto counter = make_shared<int>(0);
+    LazySequence<int> threes(make_shared<Generator<int>>([counter]() { return 3*(*counter)++; }, [counter]() { return *counter < 4; }), Cardinal::Unknown());
+    LazySequence<int>* items[] = {&evens, &odds, &threes};
+    auto merged = LazySequence<int>::MergeSorted(DynamicArray<LazySequence<int>*>(items, 3));
+    EXPECT_EQ(merged->GetCardinal(), Cardinal::Bounded(8, SIZE_MAX));
+    vector<int> result;
+    merged->Fold<int>([&result](int acc, int x) { result.push_back(x); return acc; }, 0);
+    EXPECT_EQ(result, vector<int>({0, 0, 1, 2, 3, 3, 4, 5, 6, 6, 8, 9}));
+
+    // Устойчивость и пользовательский порядок
+    LazySequence<pair<int, int>> left([](size_t i) { return make_pair(static_cast<int>(10-i), 0); }, Cardinal::Finite(3));
+    LazySequence<pair<int, int>> right([](size_t i) { return make_pair(static_cast<int>(10-i), 1); }, Cardinal::Finite(3));
+    LazySequence<pair<int, int>>* sides[] = {&left, &right};
+    auto descending = LazySequence<pair<int, int>>::MergeSorted(DynamicArray<LazySequence<pair<int, int>>*>(sides, 2),
+        [](const pair<int, int> &a, const pair<int, int> &b) { return a.first > b.first; });
+    EXPECT_EQ(descending->Get(0), make_pair(10, 0));
+    EXPECT_EQ(descending->Get(1), make_pair(10, 1));
+    EXPECT_EQ(descending->Get(5), make_pair(8, 1));
+    delete merged;
+    delete descending;
+}
+
+TEST_F(LazySequenceTest, Performance_MergeSortedVsConcatSort) {
+    const size_t SOURCES = 16, SIZE = 125000;
+    vector<LazySequence<long long>> sources;
+    for (size_t s = 0; s < SOURCES; s++) {
+        sources.emplace_back([s](size_t i) { return static_cast<long long>(i*SOURCES+(s*7) % SOURCES); }, Cardinal::Finite(SIZE));
+    }
+    DynamicArray<LazySequence<long long>*> pointers(SOURCES);
+    for (size_t s = 0; s < SOURCES; s++) pointers[s] = &sources[s];
+
+    auto merged = LazySequence<long long>::MergeSorted(pointers);
+    long long previous = -1;
+    bool ordered = true;
+    size_t count = 0;
+    auto check = [&](long long acc, long long x) { ordered = ordered && previous <= x; previous = x; count++; return acc+x; };
+    long long mergedSum = merged->Fold<long long>(check, 0);
+
+    vector<long long> all;
+    for (auto &seq : sources) {
+        for (size_t i = 0; i < SIZE; i++) all.push_back(seq.Get(i));
+    }
+    sort(all.begin(), all.end());
+
+    EXPECT_TRUE(ordered);
+    EXPECT_EQ(count, SOURCES*SIZE);
+    EXPECT_EQ(previous, all.back());
+    EXPECT_EQ(mergedSum, accumulate(all.begin(), all.end(), 0LL));
+    delete merged;
+}
+
+TEST_F(LazySequenceTest, Materialize_ParallelFillOfIndexedSource) {
+    const size_t SIZE = 200000;
+    LazySequence<long long> cubes([](size_t i) { return static_cast<long long>(i)*i*i; }, Cardinal::Finite(SIZE));
+    cubes.Materialize(1000);
+    EXPECT_EQ(cubes.GetMaterializedCount(), 1000);
+    cubes.Materialize(SIZE/2, 4);
+    EXPECT_EQ(cubes.GetMaterializedCount(), SIZE/2);
+    cubes.Materialize();
+    EXPECT_EQ(cubes.GetMaterializedCount(), SIZE);
+    EXPECT_EQ(cubes.Get(SIZE-1), static_cast<long long>(SIZE-1)*(SIZE-1)*(SIZE-1));
+    EXPECT_EQ(cubes.Get(12345), 12345LL*12345*12345);
+    EXPECT_THROW(cubes.Materialize(SIZE+1), out_of_range);
+
+    // Параллельное и последовательное заполнение дают один и тот же кеш
+    LazySequence<long long> serial([](size_t i) { return static_cast<long long>(i)*i*i; }, Cardinal::Finite(SIZE));
+    serial.Materialize(SIZE, 1);
+    for (size_t i = 0; i < SIZE; i += 997) ASSERT_EQ(serial.Get(i), cubes.Get(i)) << i;
+
+    // Последовательный источник заполняется через генератор
+    auto counter = make_shared<int>(0);
+    LazySequence<int> generated(make_shared<Generator<int>>([counter]() { return (*counter)++; }), Cardinal::Finite(50));
+    generated.Materialize();
+    EXPECT_EQ(generated.GetMaterializedCount(), 50);
+    EXPECT_EQ(generated.Get(49), 49);
+
+    // Ошибка в индексаторе передаётся вызывающему
+    LazySequence<int> failing([](size_t i) -> int { if (i == 150000) throw runtime_error("сбой"); return 0; }, Cardinal::Finite(SIZE));
+    EXPECT_THROW(failing.Materialize(SIZE, 4), runtime_error);
+    EXPECT_EQ(failing.GetMaterializedCount(), 0);
+}
+
+TEST_F(LazySequenceTest, ThreadPool_WorkStealingAndNestedLoops) {
+    ThreadPool pool(3);
+    atomic<int> done(0);
+    for (int i = 0; i < 100; i++) pool.Submit([&done]() { done++; });
+    while (done < 100) {
+        if (!pool.RunPending()) this_thread::yield();
+    }
+    EXPECT_EQ(done.load(), 100);
+
+    // Вложенные параллельные циклы не блокируют общий пул
+    atomic<long long> total(0);
+    ParallelFor(8, 8, [&total](size_t, size_t from, size_t to) {
+        for (size_t i = from; i < to; i++) {
+            ParallelFor(10000, 4, [&total](size_t, size_t begin, size_t end) {
+                long long local = 0;
+                for (size_t j = begin; j < end; j++) local += j;
+                total += local;
+            });
+        }
+    });
+    EXPECT_EQ(total.load(), 8LL*10000*9999/2);
+}
+
+// Тесты частичной сортировки
+TEST_F(LazySequenceTest, TopK_StreamingBoundedMemory) {
+    auto counter = make_shared<long long>(0);
+    auto generator = make_shared<Generator<long long>>([counter]() { return ((*counter)++*7919) % 100003; }, [counter]() { return *counter < 100003; });
+    LazySequence<long long> scrambled(generator, Cardinal::Finite(100003));
+    auto largest = unique_ptr<LazySequence<long long>>(scrambled.TopK(5, [](const long long &a, const long long &b) { return a > b; }));
+    EXPECT_EQ(largest->GetLength(), 5);
+    EXPECT_EQ(largest->Get(0), 100002);
+    EXPECT_EQ(largest->Get(4), 99998);
+    EXPECT_EQ(scrambled.GetMaterializedCount(), 0);
+
+    LazySequence<int> indexed([](size_t i) { return static_cast<int>((i*37) % 101); }, Cardinal::Finite(101));
+    EXPECT_EQ(indexed.NthElement(50), 50);
+    EXPECT_THROW(indexed.NthElement(101), out_of_range);
+
+    // Адресуемый по индексу и полностью вычисленный источники - выбором, без кучи из n+1 элементов
+    const size_t SIZE = 300007;
+    LazySequence<long long> large([](size_t i) { return static_cast<long long>((i*7919) % SIZE); }, Cardinal::Finite(SIZE));
+    EXPECT_EQ(large.NthElement(SIZE/2), static_cast<long long>(SIZE/2));
+    EXPECT_EQ(large.NthElement(SIZE-1, [](const long long &a, const long long &b) { return a > b; }), 0);
+    EXPECT_EQ(large.GetMaterializedCount(), 0);
+    auto scrambledAgain = make_shared<long long>(0);
+    LazySequence<long long> cached(make_shared<Generator<long long>>([scrambledAgain]() { return ((*scrambledAgain)++*7919) % 100003; }), Cardinal::Finite(100003));
+    cached.Materialize(100003);
+    EXPECT_EQ(cached.NthElement(77777), 77777);
+    EXPECT_EQ(*scrambledAgain, 100003);
+    EXPECT_THROW(LazySequence<int>([](size_t i) { return static_cast<int>(i); }).TopK(3), runtime_error);
+
+    int items[] = {5, 1, 4, 1, 3, 9, 2};
+    LazySequence<int> seq(items, 7);
+    auto sorted = unique_ptr<LazySequence<int>>(seq.PartialSort(3));
+    vector<int> result;
+    for (size_t i = 0; i < sorted->GetLength(); i++) result.push_back(sorted->Get(i));
+    EXPECT_EQ(result, vector<int>({1, 1, 2, 5, 4, 3, 9}));
+
+    auto pending = make_shared<int>(0);
+    int values[] = {8, 6, 7, 5, 3, 0, 9};
+    LazySequence<int> unknown(make_shared<Generator<int>>([pending, values]() { return values[(*pending)++]; }, [pending]() { return *pending < 7; }), Cardinal::Unknown());
+    auto streamed = unique_ptr<LazySequence<int>>(unknown.PartialSort(2));
+    EXPECT_EQ(streamed->Get(0), 0);
+    EXPECT_EQ(streamed->Get(1), 3);
+    EXPECT_EQ(streamed->Get(2), 8);
+    EXPECT_EQ(streamed->Get(6), 9);
+    EXPECT_THROW(streamed->Get(7), out_of_range);
+}
+
+TEST_F(LazySequenceTest, TopK_ArraySequenceParallelVariants) {
+    const size_t SIZE = 300000;
+    ArraySequence<long long> array;
+    for (size_t i = 0; i < SIZE; i++) array.Append(static_cast<long long>((i*104729) % SIZE) / 3);
+    auto greater = [](const long long &a, const long long &b) { return a > b; };
+
+    auto serialTop = unique_ptr<Sequence<long long>>(array.TopK(10, greater));
+    auto parallelTop = unique_ptr<Sequence<long long>>(array.ParallelTopK(10, greater, 4));
+    ASSERT_EQ(parallelTop->GetLength(), 10);
+    for (size_t i = 0; i < 10; i++) EXPECT_EQ(serialTop->Get(i), parallelTop->Get(i));
+    EXPECT_EQ(serialTop->Get(0), (SIZE-1)/3);
+
+    for (size_t n : {size_t(0), SIZE/2, SIZE-1, size_t(12345)}) {
+        EXPECT_EQ(array.ParallelNthElement(n, less<long long>(), 4), array.NthElement(n));
+    }
+    EXPECT_THROW(array.NthElement(SIZE), out_of_range);
+
+    auto partial = unique_ptr<Sequence<long long>>(array.ParallelPartialSort(1000, less<long long>(), 4));
+    auto expected = unique_ptr<Sequence<long long>>(array.PartialSort(1000));
+    ASSERT_EQ(partial->GetLength(), SIZE);
+    for (size_t i = 0; i < 1000; i++) EXPECT_EQ(partial->Get(i), expected->Get(i));
+    long long boundary = partial->Get(999);
+    bool rest = true;
+    for (size_t i = 1000; i < SIZE; i++) rest = rest && partial->Get(i) >= boundary;
+    EXPECT_TRUE(rest);
+}
+
+TEST_F(LazySequenceTest, Performance_TopKVersusFullSort) {
+    const size_t SIZE = 2000000;
+    LazySequence<int> source([](size_t i) { return static_cast<int>((i*2654435761u) % 1000000007u); }, Cardinal::Finite(SIZE));
+
+    auto top = unique_ptr<LazySequence<int>>(source.TopK(100, [](const int &a, const int &b) { return a > b; }));
+
+    vector<int> all(SIZE);
+    for (size_t i = 0; i < SIZE; i++) all[i] = source.Get(i);
+    sort(all.begin(), all.end(), greater<int>());
+
+    ASSERT_EQ(top->GetLength(), 100);
+    for (size_t i = 0; i < 100; i++) EXPECT_EQ(top->Get(i), all[i]);
+}
+
+// Тесты хеш-группировки
+TEST_F(LazySequenceTest, HashTable_OpenAddressing) {
+    HashTable<string, int> table;
+    EXPECT_TRUE(table.Insert("a", 1).second);
+    EXPECT_FALSE(table.Insert("a", 5).second);
+    EXPECT_EQ(table.GetValue(table.Find("a")), 1);
+    EXPECT_FALSE(table.Contains("b"));
+    for (int i = 0; i < 1000; i++) table.GetOrInsert(to_string(i), 0) += i;
+    EXPECT_EQ(table.GetCount(), 1001);
+    EXPECT_LE(table.GetCount()*4, table.GetCapacity()*3);
+    EXPECT_EQ(table.GetValue(table.Find("999")), 999);
+    EXPECT_EQ(table.GetKey(1), "0");
+    table.Clear();
+    EXPECT_FALSE(table.Contains("a"));
+}
+
+TEST_F(LazySequenceTest, DistinctGroupBy_StreamingLazySequence) {
+    auto counter = make_shared<int>(0);
+    LazySequence<int> cycle(make_shared<Generator<int>>([counter]() { return ((*counter)++*7) % 10; }, [counter]() { return *counter < 1000; }), Cardinal::Unknown());
+    auto unique = unique_ptr<LazySequence<int>>(cycle.Distinct());
+    vector<int> values;
+    unique->Fold<int>([&values](int acc, int x) { values.push_back(x); return acc; }, 0);
+    EXPECT_EQ(values, vector<int>({0, 7, 4, 1, 8, 5, 2, 9, 6, 3}));
+    EXPECT_EQ(cycle.GetMaterializedCount(), 0);
+
+    LazySequence<int> numbers([](size_t i) { return static_cast<int>(i); }, Cardinal::Finite(100));
+    auto groups = unique_ptr<LazySequence<pair<int, long long>>>(numbers.GroupBy<int, long long>(
+        [](int x) { return x % 3; },
+        [](long long acc, int x) { return acc+x; },
+        0
+    ));
+    EXPECT_EQ(groups->GetCardinal(), Cardinal::Bounded(1, 100));
+    EXPECT_EQ(groups->Get(0), make_pair(0, 1683LL));
+    EXPECT_EQ(groups->Get(2), make_pair(2, 1650LL));
+    EXPECT_THROW(groups->Get(3), out_of_range);
+    LazySequence<int> infinite([](size_t i) { return static_cast<int>(i); });
+    auto identity = [](int x) { return x; };
+    auto count = [](int acc, int) { return acc+1; };
+    EXPECT_THROW((infinite.GroupBy<int, int>(identity, count, 0)), runtime_error);
+}
+
+TEST_F(LazySequenceTest, DistinctGroupBy_ParallelArraySequence) {
+    const size_t SIZE = 200000;
+    ArraySequence<int> array;
+    for (size_t i = 0; i < SIZE; i++) array.Append(static_cast<int>((i*31) % 5003));
+    auto serial = unique_ptr<Sequence<int>>(array.Distinct());
+    auto parallel = unique_ptr<Sequence<int>>(array.ParallelDistinct(4));
+    ASSERT_EQ(serial->GetLength(), 5003);
+    ASSERT_EQ(parallel->GetLength(), 5003);
+    for (size_t i = 0; i < 5003; i++) EXPECT_EQ(serial->Get(i), parallel->Get(i));
+
+    function<int(int)> key = [](int x) { return x % 10; };
+    function<long long(long long, int)> add = [](long long acc, int x) { return acc+x; };
+    function<long long(long long, long long)> combine = [](long long a, long long b) { return a+b; };
+    auto serialGroups = unique_ptr<Sequence<pair<int, long long>>>(array.GroupBy<int, long long>(key, add, 0));
+    auto parallelGroups = unique_ptr<Sequence<pair<int, long long>>>(array.ParallelGroupBy<int, long long>(key, add, combine, 0, 4));
+    ASSERT_EQ(parallelGroups->GetLength(), 10);
+    long long total = 0;
+    for (size_t i = 0; i < 10; i++) {
+        EXPECT_EQ(serialGroups->Get(i), parallelGroups->Get(i));
+        total += parallelGroups->Get(i).second;
+    }
+    EXPECT_EQ(total, array.Reduce([](int a, int b) { return a+b; }, 0));
+}
+
+TEST_F(LazySequenceTest, Performance_GroupByLowAndHighCardinality) {
+    const size_t SIZE = 2000000;
+    for (size_t cardinality : {size_t(100), size_t(1000000)}) {
+        DynamicArray<long long> keys(SIZE);
+        for (size_t i = 0; i < SIZE; i++) keys[i] = static_cast<long long>((i*2654435761u) % cardinality);
+        ArraySequence<long long> array(keys);
+
+        unordered_map<long long, long long> reference;
+        for (size_t i = 0; i < SIZE; i++) reference[keys[i]]++;
+
+        HashTable<long long, long long> table;
+        for (size_t i = 0; i < SIZE; i++) table.GetOrInsert(keys[i], 0)++;
+
+        auto groups = unique_ptr<Sequence<pair<long long, long long>>>(array.GroupBy<long long, long long>(
+            [](long long x) { return x; }, [](long long acc, long long) { return acc+1; }, 0));
+        auto parallelGroups = unique_ptr<Sequence<pair<long long, long long>>>(array.ParallelGroupBy<long long, long long>(
+            [](long long x) { return x; }, [](long long acc, long long) { return acc+1; },
+            [](long long a, long long b) { return a+b; }, 0));
+
+        EXPECT_EQ(table.GetCount(), reference.size());
+        EXPECT_EQ(groups->GetLength(), reference.size());
+        EXPECT_EQ(parallelGroups->GetLength(), reference.size());
+        long long total = 0, parallelTotal = 0;
+        for (size_t i = 0; i < groups->GetLength(); i++) {
+            ASSERT_EQ(groups->Get(i).second, reference[groups->Get(i).first]);
+            total += groups->Get(i).second;
+            parallelTotal += parallelGroups->Get(i).second;
+        }
+        EXPECT_EQ(total, SIZE);
+        EXPECT_EQ(parallelTotal, SIZE);
+    }
+}
+
+// Тесты соединений
+TEST_F(LazySequenceTest, HashJoin_StreamsProbeSide) {
+    auto lookup = make_shared<ArraySequence<pair<int, string>>>();
+    lookup->Append(make_pair(1, string("один")));
+    lookup->Append(make_pair(3, string("три")));
+    lookup->Append(make_pair(1, string("one")));
+    auto counter = make_shared<int>(0);
+    LazySequence<int> events(make_shared<Generator<int>>([counter]() { return (*counter)++ % 5; }));
+    auto joined = unique_ptr<LazySequence<pair<int, pair<int, string>>>>(events.HashJoin<pair<int, string>, int>(
+        lookup.get(), [](int x) { return x; }, [](pair<int, string> row) { return row.first; }
+    ));
+    EXPECT_EQ(joined->Get(0), make_pair(1, make_pair(1, string("один"))));
+    EXPECT_EQ(joined->Get(1), make_pair(1, make_pair(1, string("one"))));
+    EXPECT_EQ(joined->Get(2).second.second, "три");
+    EXPECT_EQ(joined->Get(3).second.second, "один");
+    EXPECT_EQ(joined->Get(20000).first % 2, 1);
+    EXPECT_EQ(events.GetMaterializedCount(), 0);
+
+    LazySequence<int> empty;
+    auto none = unique_ptr<LazySequence<pair<int, pair<int, string>>>>(empty.HashJoin<pair<int, string>, int>(
+        lookup.get(), [](int x) { return x; }, [](pair<int, string> row) { return row.first; }
+    ));
+    EXPECT_EQ(none->GetCardinal(), Cardinal::Finite(0));
+}
+
+TEST_F(LazySequenceTest, Join_InputsUnchangedAfterJoin) {
+    auto counter = make_shared<int>(0);
+    LazySequence<int> numbers(make_shared<Generator<int>>([counter]() { return (*counter)++; }, [counter]() { return *counter < 100; }),
+                              Cardinal::Finite(100));
+    auto buildCounter = make_shared<int>(0);
+    LazySequence<int> evens(make_shared<Generator<int>>([buildCounter]() { return 2*(*buildCounter)++; }, [buildCounter]() { return *buildCounter < 5; }),
+                            Cardinal::Finite(5));
+    auto hashed = unique_ptr<LazySequence<pair<int, int>>>(numbers.HashJoin<int, int>(&evens, [](int x) { return x; }, [](int x) { return x; }));
+    EXPECT_EQ(hashed->Get(0), make_pair(0, 0));
+    EXPECT_EQ(hashed->Get(1), make_pair(2, 2));
+    EXPECT_EQ(numbers.Get(0), 0);
+    EXPECT_EQ(numbers.Get(1), 1);
+    EXPECT_EQ(evens.Get(0), 0);
+    EXPECT_EQ(evens.Get(4), 8);
+
+    auto merged = unique_ptr<LazySequence<pair<int, int>>>(numbers.MergeJoin<int, int>(&evens, [](int x) { return x; }, [](int x) { return x; }));
+    EXPECT_EQ(merged->Get(4), make_pair(8, 8));
+    EXPECT_THROW(merged->Get(5), out_of_range);
+    EXPECT_EQ(numbers.Get(2), 2);
+    EXPECT_EQ(numbers.Get(99), 99);
+    EXPECT_EQ(evens.Get(3), 6);
+    EXPECT_EQ(hashed->Get(4), make_pair(8, 8));
+}
+
+TEST_F(LazySequenceTest, MergeJoin_SortedInputsWithDuplicates) {
+    int leftItems[] = {1, 2, 2, 4, 5, 7};
+    int rightItems[] = {2, 2, 3, 5, 7, 7, 8};
+    LazySequence<int> left(leftItems, 6);
+    LazySequence<int> right(rightItems, 7);
+    auto joined = unique_ptr<LazySequence<pair<int, int>>>(left.MergeJoin<int, int>(
+        &right, [](int x) { return x; }, [](int x) { return x; }
+    ));
+    vector<pair<int, int>> rows;
+    joined->Fold<int>([&rows](int acc, pair<int, int> row) { rows.push_back(row); return acc; }, 0);
+    EXPECT_EQ(rows.size(), 7);
+    EXPECT_EQ(rows[3], make_pair(2, 2));
+    EXPECT_EQ(rows[4], make_pair(5, 5));
+    EXPECT_EQ(rows[6], make_pair(7, 7));
+
+    // Убывающий порядок задаётся сравнением
+    LazySequence<int> descending([](size_t i) { return 100-static_cast<int>(i)*2; }, Cardinal::Finite(50));
+    LazySequence<int> multiples([](size_t i) { return 99-static_cast<int>(i); }, Cardinal::Finite(100));
+    auto common = unique_ptr<LazySequence<pair<int, int>>>(descending.MergeJoin<int, int>(
+        &multiples, [](int x) { return x; }, [](int x) { return x; }, [](const int &a, const int &b) { return a > b; }
+    ));
+    EXPECT_EQ(common->Get(0), make_pair(98, 98));
+    EXPECT_EQ(common->Get(48), make_pair(2, 2));
+    EXPECT_THROW(common->Get(49), out_of_range);
+}
+
+TEST_F(LazySequenceTest, Performance_HashJoinVsNestedLoop) {
+    const size_t BUILD = 2000, PROBE = 20000;
+    auto lookup = make_shared<ArraySequence<long long>>();
+    for (size_t i = 0; i < BUILD; i++) lookup->Append(static_cast<long long>(i*3));
+    LazySequence<long long> probe([](size_t i) { return static_cast<long long>((i*7919) % 9000); }, Cardinal::Finite(PROBE));
+
+    size_t nested = 0;
+    for (size_t i = 0; i < PROBE; i++) {
+        long long key = probe.Get(i);
+        for (size_t j = 0; j < BUILD; j++) nested += (lookup->Get(j) == key);
+    }
+
+    // Ключ каждой записи вычисляется один раз: BUILD+PROBE вызовов вместо BUILD*PROBE сравнений
+    size_t keyCalls = 0;
+    auto joined = unique_ptr<LazySequence<pair<long long, long long>>>(probe.HashJoin<long long, long long>(
+        lookup.get(), [&keyCalls](long long x) { keyCalls++; return x; }, [&keyCalls](long long x) { keyCalls++; return x; }
+    ));
+    size_t hashed = joined->Fold<size_t>([](size_t acc, pair<long long, long long>) { return acc+1; }, 0);
+
+    EXPECT_EQ(hashed, nested);
+    EXPECT_EQ(keyCalls, BUILD+PROBE);
+}
+
+TEST_F(LazySequenceTest, Streaming_ForwardOnlyWithoutHistory) {
+    auto counter = make_shared<int>(0);
+    LazySequence<int> numbers(make_shared<Generator<int>>([counter]() { return (*counter)++; }));
+    numbers.SetStreaming(true);
+    EXPECT_TRUE(numbers.IsStreaming());
+    long long sum = numbers.Fold<long long>([](long long acc, int x) { return acc+x; }, 0,
+        [](const long long &acc) { return acc >= 200000000LL; });
+    EXPECT_GE(sum, 200000000LL);
+    EXPECT_GT(numbers.GetMaterializedCount(), 20000);
+    size_t last = numbers.GetMaterializedCount()-1;
+    EXPECT_EQ(numbers.Get(last+5), static_cast<int>(last+5));
+    EXPECT_EQ(numbers.Get(last+5), static_cast<int>(last+5));
+    EXPECT_THROW(numbers.Get(0), runtime_error);
+    EXPECT_THROW(numbers.Materialize(10), runtime_error);
+    EXPECT_THROW(numbers.SetStreaming(false), runtime_error);
+
+    // Индексатор позволяет вернуться назад без кеша
+    LazySequence<int> squares(make_shared<Generator<int>>([]() { return 0; }), [](size_t i) { return static_cast<int>(i*i); }, Cardinal::Finite(100));
+    squares.SetStreaming(true);
+    EXPECT_EQ(squares.Get(50), 2500);
+    EXPECT_EQ(squares.Get(3), 9);
+    EXPECT_THROW(squares.Get(100), out_of_range);
+}
+
+TEST_F(LazySequenceTest, Streaming_ExtractMovesElements) {
+    auto counter = make_shared<int>(0);
+    auto words = make_shared<LazySequence<string>>(make_shared<Generator<string>>(
+        [counter]() { return string(64, static_cast<char>('a'+(*counter)++ % 26)); },
+        [counter]() { return *counter < 30000; }
+    ), Cardinal::Unknown());
+    words->SetStreaming(true);
+    size_t total = 0;
+    for (size_t i = 0; ; i++) {
+        string word;
+        try {
+            word = words->Extract(i);
+        } catch (const out_of_range&) {
+            break;
+        }
+        total += word.size();
+    }
+    EXPECT_EQ(total, 30000*64);
+    EXPECT_THROW(words->Extract(0), runtime_error);
+
+    // Операторы поверх потокового источника читают его одним проходом
+    int items[] = {5, 3, 8, 1};
+    LazySequence<int> source(make_shared<Generator<int>>([items, counter]() mutable { return items[(*counter)++ % 4]; }), Cardinal::Finite(4));
+    *counter = 0;
+    source.SetStreaming(true);
+    auto doubled = unique_ptr<LazySequence<int>>(source.Map<int>([](int x) { return x*2; }));
+    EXPECT_EQ(doubled->Get(3), 2);
+    LazySequence<int> unsorted(make_shared<Generator<int>>([items, counter]() mutable { return items[(*counter)++ % 4]; }), Cardinal::Finite(4));
+    unsorted.SetStreaming(true);
+    auto sorted = unique_ptr<LazySequence<int>>(unsorted.PartialSort(2));
+    EXPECT_EQ(sorted->Get(0), 1);
+    EXPECT_EQ(sorted->Get(3), 8);
+}
+
+// Тесты счётчиковых генераторов случайных чисел
+TEST_F(LazySequenceTest, Random_CounterBasedReproducible) {
+    // Контрольные значения Philox4x32-10 из набора Random123
+    auto zero = Philox(0, 0).Block(0);
+    EXPECT_EQ(zero[0], 0x6627e8d5u);
+    EXPECT_EQ(zero[3], 0x9b00dbd8u);
+    auto ones = Philox(UINT64_MAX, UINT32_MAX).Block(UINT64_MAX, UINT32_MAX);
+    EXPECT_EQ(ones[0], 0x408f276du);
+    EXPECT_EQ(ones[3], 0x6d5451fdu);
+
+    UniformIntDistribution<int> dice(1, 6, 42);
+    auto rolls = dice.ToLazySequence();
+    auto again = UniformIntDistribution<int>(1, 6, 42).ToLazySequence();
+    int counts[7] = {0};
+    for (size_t i = 0; i < 60000; i++) {
+        int value = rolls->Get(i);
+        ASSERT_GE(value, 1);
+        ASSERT_LE(value, 6);
+        counts[value]++;
+    }
+    for (int face = 1; face <= 6; face++) EXPECT_NEAR(counts[face], 10000, 500);
+    EXPECT_EQ(again->Get(5000000), dice.At(5000000));
+    EXPECT_EQ(rolls->Get(59999), again->Get(59999));
+    EXPECT_NE(UniformIntDistribution<int>(0, INT_MAX, 1).At(0), UniformIntDistribution<int>(0, INT_MAX, 2).At(0));
+
+    // 64-битный диапазон из 3*2^62 значений: остаток от деления дал бы первой трети половину попаданий
+    UniformIntDistribution<int64_t> wide(INT64_MIN, (INT64_C(1) << 62)-1, 5);
+    size_t firstThird = 0;
+    for (uint64_t i = 0; i < 30000; i++) {
+        if (wide.At(i) < -(INT64_C(1) << 62)) firstThird++;
+    }
+    EXPECT_NEAR(firstThird, 10000, 500);
+    EXPECT_EQ(UniformIntDistribution<int64_t>(7, 7, 5).At(3), 7);
+
+    // Блочное и параллельное заполнение совпадает с поэлементным доступом
+    NormalDistribution<double> normal(10.0, 2.0, 7);
+    auto block = normal.Generate(3, 100001);
+    double sum = 0, squares = 0;
+    for (size_t i = 0; i < block->GetSize(); i++) {
+        sum += (*block)[i];
+        squares += (*block)[i]*(*block)[i];
+    }
+    EXPECT_DOUBLE_EQ((*block)[0], normal.At(3));
+    EXPECT_DOUBLE_EQ((*block)[100000], normal.At(100003));
+    double mean = sum/block->GetSize();
+    EXPECT_NEAR(mean, 10.0, 0.05);
+    EXPECT_NEAR(sqrt(squares/block->GetSize()-mean*mean), 2.0, 0.05);
+
+    UniformRealDistribution<double> unit(0.0, 1.0, 3, 1);
+    auto stream = unit.ToStream(1000);
+    stream->Open();
+    size_t read = 0;
+    while (!stream->IsEndOfStream()) {
+        double value = stream->Read();
+        ASSERT_DOUBLE_EQ(value, unit.At(read));
+        read++;
+    }
+    EXPECT_EQ(read, 1000);
+    EXPECT_THROW(UniformIntDistribution<int>(5, 1), invalid_argument);
+}
+
+TEST_F(LazySequenceTest, Random_ZipfDistribution) {
+    ZipfDistribution<int> zipf(1000, 1.2, 11);
+    auto values = zipf.Generate(0, 200000);
+    vector<size_t> counts(1001, 0);
+    for (size_t i = 0; i < values->GetSize(); i++) {
+        int value = (*values)[i];
+        ASSERT_GE(value, 1);
+        ASSERT_LE(value, 1000);
+        counts[value]++;
+    }
+    // Частоты убывают как k^-s: f(1)/f(2) = 2^1.2
+    EXPECT_GT(counts[1], counts[2]);
+    EXPECT_GT(counts[2], counts[10]);
+    EXPECT_NEAR(static_cast<double>(counts[1])/counts[2], pow(2.0, 1.2), 0.1);
+    EXPECT_EQ(zipf.At(123456), (*values)[123456]);
+    EXPECT_THROW(ZipfDistribution<int>(0), invalid_argument);
+}
+
+TEST_F(LazySequenceTest, Performance_RandomBlockGeneration) {
+    const size_t SIZE = 4000000;
+    UniformRealDistribution<double> unit(0.0, 1.0, 2024);
+    auto sequence = unit.ToLazySequence(Cardinal::Finite(SIZE));
+
+    double serialSum = 0;
+    for (size_t i = 0; i < SIZE; i++) serialSum += unit.At(i);
+    auto block = unit.Generate(0, SIZE);
+    sequence->Materialize();
+
+    double parallelSum = 0;
+    for (size_t i = 0; i < SIZE; i++) parallelSum += (*block)[i];
+    EXPECT_DOUBLE_EQ(serialSum, parallelSum);
+    EXPECT_EQ(sequence->GetMaterializedCount(), SIZE);
+    EXPECT_DOUBLE_EQ(sequence->Get(SIZE-1), (*block)[SIZE-1]);
+    EXPECT_DOUBLE_EQ(sequence->Get(SIZE/2), unit.At(SIZE/2));
+}
+
 // Основная функция
 inline int run_test_ls() {
     int argc = 1;
@@ -7,6 +7,13 @@
 #include <sys/stat.h>
 #include <random>
 #include "../Stream.hpp"
+#include "../ColumnarStream.hpp"
+#include "../CompressedStream.hpp"
+#include "../StreamPipeline.hpp"
+#include "../TeeStream.hpp"
+#include "../StreamEncoder.hpp"
+#include "../StreamStatistics.hpp"
+#include "../ExternalSort.hpp"
 #include "../sequences/ArraySequence.hpp"
 using namespace std;
 
@@ -686,6 +693,1126 @@ TEST_F(StreamTest, ReadWriteStream_FileOperations_OverwriteMiddle) {
     EXPECT_EQ(lines[4], "500");
 }
 
+// 21. Тест: Запись последовательности с известной верхней оценкой длины
+TEST_F(StreamTest, WriteOnlyStream_WriteAllBoundedSequence) {
+    int items[] = {5, 1, 8, 3, 9, 2};
+    LazySequence<int> numbers(items, 6);
+    auto filtered = shared_ptr<LazySequence<int>>(numbers.Where([](int x) { return x > 2; }));
+
+    auto buffer = make_shared<DynamicArray<int>>(0);
+    WriteOnlyStream<int> stream(buffer);
+    stream.Open();
+    stream.Write(42);
+    EXPECT_EQ(stream.WriteAll(filtered), 5);
+    ASSERT_EQ(buffer->GetSize(), 5);
+    EXPECT_EQ(buffer->Get(0), 42);
+    EXPECT_EQ(buffer->Get(1), 5);
+    EXPECT_EQ(buffer->Get(4), 9);
+
+    auto infinite = make_shared<LazySequence<int>>([](size_t i) { return static_cast<int>(i); });
+    EXPECT_THROW(stream.WriteAll(infinite), runtime_error);
+    stream.Close();
+}
+
+// 22. Тест: Выбор k наибольших и порядковой статистики из потока
+TEST_F(StreamTest, ReadOnlyStream_TopKAndNthElement) {
+    CreateTestFile({"40", "10", "70", "20", "90", "30", "60"});
+
+    auto deserializer = make_shared<IntDeserializer>();
+    ReadOnlyStream<int> stream(testFilename, deserializer);
+    stream.Open();
+    stream.Read();
+    auto top = stream.TopK(3, [](const int &a, const int &b) { return a > b; });
+    ASSERT_EQ(top->GetSize(), 3);
+    EXPECT_EQ((*top)[0], 90);
+    EXPECT_EQ((*top)[2], 60);
+    EXPECT_TRUE(stream.IsEndOfStream());
+
+    stream.Seek(0);
+    EXPECT_EQ(stream.NthElement(3), 40);
+    stream.Seek(0);
+    EXPECT_THROW(stream.NthElement(7), out_of_range);
+    stream.Close();
+
+    // Поток над адресуемой последовательностью: выбор среди оставшихся элементов без чтения по одному
+    auto indexed = make_shared<LazySequence<int>>([](size_t i) { return static_cast<int>((i*37) % 101); }, Cardinal::Finite(101));
+    ReadOnlyStream<int> sequenceStream(indexed);
+    sequenceStream.Open();
+    EXPECT_EQ(sequenceStream.Read(), 0);
+    EXPECT_EQ(sequenceStream.NthElement(0), 1);
+    EXPECT_TRUE(sequenceStream.IsEndOfStream());
+    sequenceStream.Seek(1);
+    EXPECT_THROW(sequenceStream.NthElement(100), out_of_range);
+    // В кеше только элемент, прочитанный через Read
+    EXPECT_EQ(indexed->GetMaterializedCount(), 1);
+    sequenceStream.Close();
+}
+
+// 23. Тест: Потоковое чтение большого файла без хранения истории
+TEST_F(StreamTest, ReadOnlyStream_StreamingMode) {
+    vector<string> lines;
+    for (int i = 0; i < 25000; i++) lines.push_back(to_string(i));
+    CreateTestFile(lines);
+
+    auto deserializer = make_shared<IntDeserializer>();
+    ReadOnlyStream<int> stream(testFilename, deserializer);
+    stream.SetStreaming(true);
+    stream.Open();
+    EXPECT_FALSE(stream.IsCanGoBack());
+    EXPECT_EQ(stream.Read(), 0);
+    EXPECT_THROW(stream.Seek(0), runtime_error);
+    long long sum = 0;
+    int count = 1;
+    while (!stream.IsEndOfStream()) {
+        sum += stream.Read();
+        count++;
+    }
+    EXPECT_EQ(count, 25000);
+    EXPECT_EQ(sum, 25000LL*24999/2);
+    EXPECT_TRUE(stream.GetData()->IsStreaming());
+    stream.Close();
+
+    ReadOnlyStream<int> cached(testFilename, deserializer);
+    cached.Open();
+    cached.Seek(24999);
+    EXPECT_EQ(cached.Read(), 24999);
+    cached.Seek(12);
+    EXPECT_EQ(cached.Read(), 12);
+    cached.Close();
+}
+
+// 24. Тест: Контрольные точки и продолжение чтения
+TEST_F(StreamTest, ReadOnlyStream_CheckpointResume) {
+    vector<string> lines;
+    for (int i = 0; i < 1000; i++) lines.push_back(to_string(i*3));
+    CreateTestFile(lines);
+
+    auto deserializer = make_shared<IntDeserializer>();
+    string saved;
+    {
+        ReadOnlyStream<int> stream(testFilename, deserializer);
+        stream.SetStreaming(true);
+        stream.Open();
+        for (int i = 0; i < 700; i++) stream.Read();
+        EXPECT_EQ(stream.Peek(), 2100);
+        saved = stream.GetCheckpoint().Serialize();
+    }
+    auto checkpoint = StreamCheckpoint::Deserialize(saved);
+    EXPECT_EQ(checkpoint.record, 700);
+    ReadOnlyStream<int> resumed(testFilename, deserializer, checkpoint);
+    resumed.Open();
+    EXPECT_EQ(resumed.GetPosition(), 700);
+    EXPECT_EQ(resumed.Read(), 2100);
+    EXPECT_THROW(resumed.Seek(10), out_of_range);
+    size_t count = 1;
+    while (!resumed.IsEndOfStream()) {
+        resumed.Read();
+        count++;
+    }
+    EXPECT_EQ(count, 300);
+    resumed.Close();
+
+    // Кеширующий поток возвращается к любой прочитанной записи
+    ReadOnlyStream<int> cached(testFilename, deserializer);
+    cached.Open();
+    cached.Seek(250);
+    auto middle = cached.GetCheckpoint();
+    cached.Seek(900);
+    EXPECT_EQ(cached.Read(), 2700);
+    cached.Seek(0);
+    auto first = cached.GetCheckpoint();
+    cached.Seek(middle);
+    EXPECT_EQ(cached.Read(), 750);
+    cached.Seek(first);
+    EXPECT_EQ(cached.Read(), 0);
+    cached.Close();
+    EXPECT_THROW(StreamCheckpoint::Deserialize("мусор"), runtime_error);
+
+    // Переводы строк \r\n: смещения считаются в байтах файла, '\r' не попадает в запись
+    {
+        ofstream file(testFilename, ios::binary | ios::trunc);
+        for (int i = 0; i < 100; i++) file << "line" << i << "\r\n";
+    }
+    auto strings = make_shared<StringDeserializer>();
+    StreamCheckpoint crlfCheckpoint;
+    {
+        ReadOnlyStream<string> stream(testFilename, strings);
+        stream.SetStreaming(true);
+        stream.Open();
+        EXPECT_EQ(stream.Read(), "line0");
+        for (int i = 1; i < 40; i++) stream.Read();
+        crlfCheckpoint = stream.GetCheckpoint();
+    }
+    EXPECT_EQ(crlfCheckpoint.offset, 10*7+30*8);
+    ReadOnlyStream<string> crlfResumed(testFilename, strings, crlfCheckpoint);
+    crlfResumed.Open();
+    EXPECT_EQ(crlfResumed.Read(), "line40");
+    crlfResumed.Close();
+
+    // Генератор с сохранением состояния
+    auto counter = make_shared<int>(0);
+    auto generator = make_shared<Generator<int>>(
+        [counter]() { int n = (*counter)++; return n*n; }, []() { return true; },
+        [counter]() { return to_string(*counter); },
+        [counter](const string &state) { *counter = stoi(state); }
+    );
+    ReadOnlyStream<int> squares(make_shared<LazySequence<int>>(generator, Cardinal::Unknown()));
+    squares.SetStreaming(true);
+    squares.Open();
+    for (int i = 0; i < 5; i++) squares.Read();
+    auto position = squares.GetCheckpoint();
+    EXPECT_EQ(squares.Read(), 25);
+    EXPECT_EQ(squares.Read(), 36);
+    squares.Seek(position);
+    EXPECT_EQ(squares.Read(), 25);
+    squares.Close();
+}
+
+// 25. Тест: Отложенная асинхронная запись в файл
+TEST_F(StreamTest, WriteOnlyStream_AsyncWriteBehind) {
+    const int LINES_COUNT = 200000;
+    auto serializer = make_shared<IntSerializer>();
+    WriteOnlyStream<int> stream(testWriteFile, serializer, 4, 4096);
+    EXPECT_TRUE(stream.IsAsync());
+    stream.Open();
+    for (int i = 0; i < LINES_COUNT/2; i++) stream.Write(i);
+    stream.Flush();
+    EXPECT_EQ(ReadFileContents(testWriteFile).size(), LINES_COUNT/2);
+    for (int i = LINES_COUNT/2; i < LINES_COUNT; i++) stream.Write(i);
+    stream.Close();
+
+    auto lines = ReadFileContents(testWriteFile);
+    ASSERT_EQ(lines.size(), LINES_COUNT);
+    EXPECT_EQ(lines[0], "0");
+    EXPECT_EQ(lines[123456], "123456");
+    EXPECT_EQ(lines[LINES_COUNT-1], to_string(LINES_COUNT-1));
+
+    // Запасной путь через пул потоков пишет те же байты по тем же смещениям
+    {
+        AsyncFileWriter writer(testFilename, 2, false);
+        EXPECT_FALSE(writer.IsUsingRing());
+        for (int i = 0; i < 1000; i++) writer.Write(to_string(i) + "\n");
+        writer.Flush();
+        EXPECT_EQ(ReadFileContents(testFilename).size(), 1000);
+        writer.Write("end\n");
+        writer.Close();
+    }
+    lines = ReadFileContents(testFilename);
+    ASSERT_EQ(lines.size(), 1001);
+    EXPECT_EQ(lines[999], "999");
+    EXPECT_EQ(lines[1000], "end");
+    EXPECT_THROW(AsyncFileWriter("/nonexistent_dir/file.tmp"), runtime_error);
+
+#ifdef FILEIO_HAS_IO_URING
+    // Если ядро даёт создать кольцо, писатель обязан выбрать io_uring, а не пул потоков
+    IoUring probe;
+    if (probe.Init(2)) {
+        AsyncFileWriter writer(testFilename, 2);
+        EXPECT_TRUE(writer.IsUsingRing());
+        for (int i = 0; i < 1000; i++) writer.Write(to_string(i) + "\n");
+        writer.Close();
+        lines = ReadFileContents(testFilename);
+        ASSERT_EQ(lines.size(), 1000);
+        EXPECT_EQ(lines[999], "999");
+    }
+#endif
+}
+
+// 26. Тест: Производительность отложенной записи
+TEST_F(StreamTest, Performance_AsyncWriteBehind) {
+    const int LINES_COUNT = 300000;
+    auto serializer = make_shared<IntSerializer>();
+
+    WriteOnlyStream<int> sync(testLargeFile, serializer);
+    sync.Open();
+    for (int i = 0; i < LINES_COUNT; i++) sync.Write(i);
+    sync.Close();
+
+    WriteOnlyStream<int> async(testWriteFile, serializer, 8);
+    async.Open();
+    for (int i = 0; i < LINES_COUNT; i++) async.Write(i);
+    async.Close();
+
+    struct stat syncInfo, asyncInfo;
+    stat(testLargeFile.c_str(), &syncInfo);
+    stat(testWriteFile.c_str(), &asyncInfo);
+    EXPECT_EQ(asyncInfo.st_size, syncInfo.st_size);
+    EXPECT_EQ(ReadFileContents(testWriteFile), ReadFileContents(testLargeFile));
+}
+
+// 27. Тест: Двоичный формат записей фиксированной ширины
+TEST_F(StreamTest, BinaryStream_FixedWidthRecords) {
+    auto values = make_shared<ArraySequence<double>>();
+    for (int i = 0; i < 10000; i++) values->Append(i*0.5);
+    {
+        BinaryWriteOnlyStream<double> writer(testWriteFile);
+        writer.Open();
+        writer.Write(-1.0);
+        writer.WriteAll(values);
+        auto block = make_shared<DynamicArray<double>>(3);
+        for (int i = 0; i < 3; i++) (*block)[i] = 100.0+i;
+        EXPECT_EQ(writer.WriteBlock(block), 10004);
+        writer.Close();
+    }
+    struct stat info;
+    ASSERT_EQ(stat(testWriteFile.c_str(), &info), 0);
+    EXPECT_EQ(static_cast<size_t>(info.st_size), sizeof(BinaryStreamHeader)+10004*sizeof(double));
+
+    BinaryReadOnlyStream<double> reader(testWriteFile);
+    reader.Open();
+    EXPECT_EQ(reader.GetCount(), 10004);
+    EXPECT_DOUBLE_EQ(reader.Read(), -1.0);
+    reader.Seek(5001);
+    EXPECT_DOUBLE_EQ(reader.Peek(), 2500.0);
+    EXPECT_DOUBLE_EQ(reader.Read(), 2500.0);
+    reader.Seek(9998);
+    auto tail = reader.ReadBlock(100);
+    ASSERT_EQ(tail->GetSize(), 6);
+    EXPECT_DOUBLE_EQ((*tail)[0], 4998.5);
+    EXPECT_DOUBLE_EQ((*tail)[5], 102.0);
+    EXPECT_TRUE(reader.IsEndOfStream());
+    auto checkpoint = reader.GetCheckpoint();
+    EXPECT_EQ(checkpoint.offset, sizeof(BinaryStreamHeader)+10004*sizeof(double));
+    reader.Seek(1);
+    EXPECT_DOUBLE_EQ(reader.Read(), 0.0);
+    EXPECT_THROW(reader.Seek(10005), out_of_range);
+    reader.Close();
+
+    EXPECT_THROW(BinaryReadOnlyStream<int>{testWriteFile}, runtime_error);
+    CreateTestFile({"1", "2"});
+    EXPECT_THROW(BinaryReadOnlyStream<double>{testFilename}, runtime_error);
+}
+
+// 28. Тест: Производительность двоичного формата по сравнению с текстовым
+TEST_F(StreamTest, Performance_BinaryVersusText) {
+    const int COUNT = 300000;
+    auto values = make_shared<ArraySequence<int>>();
+    for (int i = 0; i < COUNT; i++) values->Append(static_cast<int>(i*7919LL % 1000003));
+
+    WriteOnlyStream<int> textWriter(testLargeFile, make_shared<IntSerializer>());
+    textWriter.Open();
+    textWriter.WriteAll(values);
+    textWriter.Close();
+    ReadOnlyStream<int> textReader(testLargeFile, make_shared<IntDeserializer>());
+    textReader.Open();
+    long long textSum = 0;
+    while (!textReader.IsEndOfStream()) textSum += textReader.Read();
+    textReader.Close();
+
+    BinaryWriteOnlyStream<int> binaryWriter(testWriteFile);
+    binaryWriter.Open();
+    binaryWriter.WriteAll(values);
+    binaryWriter.Close();
+    BinaryReadOnlyStream<int> binaryReader(testWriteFile);
+    binaryReader.Open();
+    long long binarySum = 0;
+    while (!binaryReader.IsEndOfStream()) {
+        auto block = binaryReader.ReadBlock(4096);
+        for (size_t i = 0; i < block->GetSize(); i++) binarySum += (*block)[i];
+    }
+    binaryReader.Close();
+
+    struct stat textInfo, binaryInfo;
+    stat(testLargeFile.c_str(), &textInfo);
+    stat(testWriteFile.c_str(), &binaryInfo);
+    EXPECT_EQ(textSum, binarySum);
+    // Двоичная запись - заголовок и ровно sizeof(int) байт на значение
+    EXPECT_EQ(binaryInfo.st_size, sizeof(BinaryStreamHeader)+COUNT*sizeof(int));
+    EXPECT_LT(binaryInfo.st_size, textInfo.st_size);
+}
+
+// 29. Тест: Колоночный формат с зонами блоков
+TEST_F(StreamTest, ColumnarStream_ZoneMapPushdown) {
+    const int COUNT = 200000;
+    {
+        ColumnarWriteOnlyStream<int> writer(testWriteFile, 4096);
+        writer.Open();
+        for (int i = 0; i < COUNT; i++) writer.Write(i*2);
+        writer.Close();
+    }
+    ColumnarReadOnlyStream<int> reader(testWriteFile);
+    reader.Open();
+    EXPECT_EQ(reader.GetRecordCount(), COUNT);
+    EXPECT_EQ(reader.GetChunkCount(), (COUNT+4095)/4096);
+    EXPECT_EQ(reader.GetChunk(1).min, 8192);
+    EXPECT_EQ(reader.GetChunk(1).max, 2*8191);
+
+    reader.Seek(150000);
+    EXPECT_EQ(reader.Read(), 300000);
+    EXPECT_EQ(reader.GetChunksLoaded(), 1);
+
+    reader.Seek(0);
+    reader.SetRange(100001, 102000);
+    vector<int> matched;
+    while (!reader.IsEndOfStream()) matched.push_back(reader.Read());
+    ASSERT_EQ(matched.size(), 1000);
+    EXPECT_EQ(matched.front(), 100002);
+    EXPECT_EQ(matched.back(), 102000);
+    EXPECT_LE(reader.GetChunksLoaded(), 3);
+
+    reader.SetRange(-10, -1);
+    reader.Seek(0);
+    EXPECT_TRUE(reader.IsEndOfStream());
+    reader.ClearRange();
+    EXPECT_EQ(reader.Peek(), 0);
+    reader.Close();
+
+    // Блоки, прошедшие проверку зоны без подходящих значений, читаются с диска один раз
+    {
+        ColumnarWriteOnlyStream<int> writer(testWriteFile, 4);
+        writer.Open();
+        for (int chunk = 0; chunk < 10; chunk++) {
+            for (int value : {0, 10, 0, 10}) writer.Write(value);
+        }
+        for (int i = 0; i < 4; i++) writer.Write(5);
+        writer.Close();
+    }
+    ColumnarReadOnlyStream<int> sparse(testWriteFile);
+    sparse.Open();
+    sparse.SetRange(5, 6);
+    size_t found = 0;
+    while (!sparse.IsEndOfStream()) {
+        EXPECT_EQ(sparse.Peek(), 5);
+        EXPECT_EQ(sparse.Read(), 5);
+        found++;
+    }
+    EXPECT_EQ(found, 4);
+    EXPECT_EQ(sparse.GetChunksLoaded(), 11);
+    sparse.Close();
+
+    EXPECT_THROW(ColumnarReadOnlyStream<double>{testWriteFile}, runtime_error);
+    CreateTestFile({"1", "2"});
+    EXPECT_THROW(ColumnarReadOnlyStream<int>{testFilename}, runtime_error);
+
+    // Повреждённые каталог и концевик отвергаются при открытии
+    auto patchNumber = [this](streamoff position, uint64_t value) {
+        fstream patch(testWriteFile, ios::in | ios::out | ios::binary);
+        patch.seekp(position);
+        patch.write(reinterpret_cast<const char*>(&value), sizeof(value));
+    };
+    auto writeSmall = [this]() {
+        ColumnarWriteOnlyStream<int> writer(testWriteFile, 4);
+        writer.Open();
+        for (int i = 0; i < 8; i++) writer.Write(i);
+        writer.Close();
+    };
+    const streamoff DIRECTORY = sizeof(BinaryStreamHeader)+8*sizeof(int);
+    writeSmall();
+    patchNumber(DIRECTORY+sizeof(uint64_t), 1);
+    EXPECT_THROW(ColumnarReadOnlyStream<int>{testWriteFile}, runtime_error);
+    writeSmall();
+    patchNumber(DIRECTORY+2*(3*sizeof(uint64_t)+2*sizeof(int))+sizeof(uint64_t), 1ULL << 60);
+    EXPECT_THROW(ColumnarReadOnlyStream<int>{testWriteFile}, runtime_error);
+
+    // NaN не входит ни в зону блока, ни в диапазон фильтра
+    const double NOT_A_NUMBER = numeric_limits<double>::quiet_NaN();
+    {
+        ColumnarWriteOnlyStream<double> writer(testWriteFile, 4);
+        writer.Open();
+        for (double value : {NOT_A_NUMBER, 1.0, 2.0, 3.0}) writer.Write(value);
+        for (int i = 0; i < 4; i++) writer.Write(NOT_A_NUMBER);
+        for (double value : {5.0, NOT_A_NUMBER, 6.0, 7.0}) writer.Write(value);
+        writer.Close();
+    }
+    ColumnarReadOnlyStream<double> withNaN(testWriteFile);
+    withNaN.Open();
+    EXPECT_EQ(withNaN.GetChunk(0).min, 1.0);
+    EXPECT_EQ(withNaN.GetChunk(0).max, 3.0);
+    EXPECT_TRUE(isnan(withNaN.GetChunk(1).min));
+    EXPECT_EQ(withNaN.GetChunk(2).min, 5.0);
+
+    withNaN.SetRange(0.0, 10.0);
+    vector<double> numbers;
+    while (!withNaN.IsEndOfStream()) numbers.push_back(withNaN.Read());
+    EXPECT_EQ(numbers, vector<double>({1.0, 2.0, 3.0, 5.0, 6.0, 7.0}));
+    EXPECT_EQ(withNaN.GetChunksLoaded(), 2);
+    EXPECT_THROW(withNaN.SetRange(NOT_A_NUMBER, 1.0), invalid_argument);
+
+    withNaN.ClearRange();
+    withNaN.Seek(0);
+    size_t total = 0;
+    while (!withNaN.IsEndOfStream()) {
+        withNaN.Read();
+        total++;
+    }
+    EXPECT_EQ(total, 12);
+    withNaN.Close();
+}
+
+// 30. Тест: Производительность запроса по диапазону с пропуском блоков
+TEST_F(StreamTest, Performance_ColumnarRangeQuery) {
+    const int COUNT = 2000000;
+    {
+        ColumnarWriteOnlyStream<double> writer(testLargeFile);
+        writer.Open();
+        for (int i = 0; i < COUNT; i++) writer.Write(i*0.001);
+        writer.Close();
+    }
+    ColumnarReadOnlyStream<double> reader(testLargeFile);
+    reader.Open();
+
+    size_t fullMatches = 0;
+    while (!reader.IsEndOfStream()) {
+        double value = reader.Read();
+        if (value >= 500.0 && value <= 520.0) fullMatches++;
+    }
+    size_t fullChunks = reader.GetChunksLoaded();
+    EXPECT_EQ(fullChunks, reader.GetChunkCount());
+
+    // С фильтром читаются только блоки, зона которых пересекает диапазон
+    size_t overlapping = 0;
+    for (size_t i = 0; i < reader.GetChunkCount(); i++) {
+        if (!(reader.GetChunk(i).max < 500.0) && !(520.0 < reader.GetChunk(i).min)) overlapping++;
+    }
+    reader.Seek(0);
+    reader.SetRange(500.0, 520.0);
+    size_t rangeMatches = 0;
+    while (!reader.IsEndOfStream()) {
+        reader.Read();
+        rangeMatches++;
+    }
+    EXPECT_EQ(reader.GetChunksLoaded()-fullChunks, overlapping);
+    EXPECT_LT(overlapping, reader.GetChunkCount());
+    reader.Close();
+
+    EXPECT_EQ(fullMatches, rangeMatches);
+}
+
+// 31. Тест: Сжатый блочный файл с индексом блоков
+TEST_F(StreamTest, CompressedStream_BlockIndexSeek) {
+    const int COUNT = 100000;
+    {
+        CompressedWriteOnlyStream<int> writer(testWriteFile, make_shared<IntSerializer>(), BlockCodec::LZ, 16384);
+        writer.Open();
+        for (int i = 0; i < COUNT; i++) writer.Write(i % 1000);
+        writer.Close();
+    }
+    {
+        WriteOnlyStream<int> writer(testLargeFile, make_shared<IntSerializer>());
+        writer.Open();
+        for (int i = 0; i < COUNT; i++) writer.Write(i % 1000);
+        writer.Close();
+    }
+    struct stat compressedInfo, textInfo;
+    stat(testWriteFile.c_str(), &compressedInfo);
+    stat(testLargeFile.c_str(), &textInfo);
+    EXPECT_LT(compressedInfo.st_size*3, textInfo.st_size);
+
+    CompressedReadOnlyStream<int> reader(testWriteFile, make_shared<IntDeserializer>());
+    reader.Open();
+    EXPECT_EQ(reader.GetRecordCount(), COUNT);
+    EXPECT_GT(reader.GetBlockCount(), 5);
+    reader.Seek(77777);
+    EXPECT_EQ(reader.Peek(), 777);
+    EXPECT_EQ(reader.Read(), 777);
+    EXPECT_EQ(reader.GetBlocksDecoded(), 1);
+    reader.Seek(77000);
+    EXPECT_EQ(reader.Read(), 0);
+    reader.Seek(COUNT);
+    EXPECT_TRUE(reader.IsEndOfStream());
+    EXPECT_THROW(reader.Seek(COUNT+1), out_of_range);
+    reader.Close();
+
+    CompressedReadOnlyStream<int> parallel(testWriteFile, make_shared<IntDeserializer>(), 4);
+    parallel.Open();
+    for (int i = 0; i < COUNT; i++) {
+        ASSERT_EQ(parallel.Read(), i % 1000);
+    }
+    EXPECT_TRUE(parallel.IsEndOfStream());
+    EXPECT_EQ(parallel.GetBlocksDecoded(), parallel.GetBlockCount());
+    parallel.Seek(10);
+    EXPECT_EQ(parallel.Read(), 10);
+    parallel.Close();
+
+    EXPECT_THROW(CompressedReadOnlyStream<int>(testLargeFile, make_shared<IntDeserializer>()), runtime_error);
+}
+
+// 32. Тест: Производительность чтения сжатого файла с распаковкой заранее
+TEST_F(StreamTest, Performance_CompressedReadAhead) {
+    const int COUNT = 1000000;
+    {
+        CompressedWriteOnlyStream<int> writer(testLargeFile, make_shared<IntSerializer>());
+        writer.Open();
+        for (int i = 0; i < COUNT; i++) writer.Write(i / 3);
+        writer.Close();
+    }
+    auto sum = [&](size_t readAhead) {
+        CompressedReadOnlyStream<int> reader(testLargeFile, make_shared<IntDeserializer>(), readAhead);
+        reader.Open();
+        long long total = 0;
+        size_t count = 0;
+        while (!reader.IsEndOfStream()) {
+            total += reader.Read();
+            count++;
+        }
+        reader.Close();
+        EXPECT_EQ(count, COUNT);
+        return total;
+    };
+    long long expected = 0;
+    for (int i = 0; i < COUNT; i++) expected += i / 3;
+    EXPECT_EQ(sum(0), expected);
+    EXPECT_EQ(sum(GetDefaultThreadCount()), expected);
+}
+
+// 33. Тест: Параллельный разбор файла чисел
+TEST_F(StreamTest, ParallelParseFile_PreservesOrder) {
+    CreateTestFile({"5", " -12\r", "", "+7", "  42  ", "2147483647"});
+    auto small = ParallelParseFile<int>(testFilename, 4);
+    ASSERT_EQ(small->GetLength(), 5);
+    EXPECT_EQ(small->Get(0), 5);
+    EXPECT_EQ(small->Get(1), -12);
+    EXPECT_EQ(small->Get(2), 7);
+    EXPECT_EQ(small->Get(3), 42);
+    EXPECT_EQ(small->Get(4), 2147483647);
+
+    CreateLargeTestFile(300000);
+    auto parsed = ParallelParseFile<int>(testLargeFile, 8);
+    ASSERT_EQ(parsed->GetLength(), 300000);
+    for (int i = 0; i < 300000; i++) {
+        ASSERT_EQ((*parsed)[i], i);
+    }
+    auto doubles = ParallelParseFile<double>(testLargeFile, 3);
+    EXPECT_DOUBLE_EQ(doubles->Get(299999), 299999.0);
+
+    CreateTestFile({"1", "two", "3"});
+    EXPECT_THROW(ParallelParseFile<int>(testFilename), runtime_error);
+    CreateTestFile({});
+    EXPECT_EQ(ParallelParseFile<int>(testFilename)->GetLength(), 0);
+}
+
+// 34. Тест: Производительность параллельного разбора по сравнению с потоковым чтением
+TEST_F(StreamTest, Performance_ParallelParseFile) {
+    const int COUNT = 500000;
+    CreateLargeTestFile(COUNT);
+
+    ReadOnlyStream<int> stream(testLargeFile, make_shared<IntDeserializer>());
+    stream.Open();
+    long long streamSum = 0;
+    while (!stream.IsEndOfStream()) streamSum += stream.Read();
+    stream.Close();
+
+    auto parsed = ParallelParseFile<int>(testLargeFile);
+    long long parsedSum = 0;
+    for (size_t i = 0; i < parsed->GetLength(); i++) parsedSum += (*parsed)[i];
+
+    EXPECT_EQ(parsed->GetLength(), COUNT);
+    EXPECT_EQ(streamSum, parsedSum);
+    EXPECT_EQ(parsedSum, static_cast<long long>(COUNT)*(COUNT-1)/2);
+}
+
+// 35. Тест: Индекс строк в отдельном файле
+TEST_F(StreamTest, ReadOnlyStream_PersistedLineIndex) {
+    const string indexFile = testLargeFile+".lidx";
+    remove_if_exists(indexFile);
+    CreateLargeTestFile(50000);
+    {
+        ReadOnlyStream<int> stream(testLargeFile, make_shared<IntDeserializer>());
+        stream.UseLineIndex();
+        stream.Open();
+        EXPECT_FALSE(stream.IsLineIndexed());
+        int count = 0;
+        while (!stream.IsEndOfStream()) {
+            ASSERT_EQ(stream.Read(), count);
+            count++;
+        }
+        EXPECT_EQ(count, 50000);
+        stream.Close();
+    }
+    ASSERT_TRUE(fileExists(indexFile));
+    struct stat indexInfo;
+    stat(indexFile.c_str(), &indexInfo);
+    EXPECT_LT(indexInfo.st_size, 50000*3);
+
+    ReadOnlyStream<int> stream(testLargeFile, make_shared<IntDeserializer>());
+    stream.UseLineIndex();
+    stream.Open();
+    EXPECT_TRUE(stream.IsLineIndexed());
+    stream.Seek(43210);
+    EXPECT_EQ(stream.Peek(), 43210);
+    EXPECT_EQ(stream.Read(), 43210);
+    EXPECT_EQ(stream.Read(), 43211);
+    EXPECT_EQ(stream.GetData()->GetMaterializedCount(), 0);
+    stream.Seek(7);
+    EXPECT_EQ(stream.Read(), 7);
+    StreamCheckpoint checkpoint = stream.GetCheckpoint();
+    stream.Seek(49999);
+    EXPECT_EQ(stream.Read(), 49999);
+    EXPECT_TRUE(stream.IsEndOfStream());
+    EXPECT_THROW(stream.Seek(50001), out_of_range);
+    stream.Seek(checkpoint);
+    EXPECT_EQ(stream.Read(), 8);
+    stream.Close();
+
+    // Изменённый файл (другой размер) - индекс устарел и строится заново
+    CreateLargeTestFile(100);
+    ReadOnlyStream<int> changed(testLargeFile, make_shared<IntDeserializer>());
+    changed.UseLineIndex();
+    changed.Open();
+    EXPECT_FALSE(changed.IsLineIndexed());
+    changed.Seek(99);
+    EXPECT_EQ(changed.Read(), 99);
+    changed.Close();
+
+    // Индекс файла с переводами строк \r\n: смещения в байтах, '\r' отрезается при чтении по смещению
+    {
+        ofstream file(testLargeFile, ios::binary | ios::trunc);
+        for (int i = 0; i < 1000; i++) file << "row" << i << "\r\n";
+    }
+    remove_if_exists(indexFile);
+    for (bool expectIndexed : {false, true}) {
+        ReadOnlyStream<string> rows(testLargeFile, make_shared<StringDeserializer>());
+        rows.UseLineIndex();
+        rows.Open();
+        EXPECT_EQ(rows.IsLineIndexed(), expectIndexed);
+        size_t count = 0;
+        while (!rows.IsEndOfStream()) {
+            ASSERT_EQ(rows.Read(), "row" + to_string(count));
+            count++;
+        }
+        EXPECT_EQ(count, 1000);
+        rows.Seek(500);
+        EXPECT_EQ(rows.Read(), "row500");
+        rows.Close();
+    }
+    remove_if_exists(indexFile);
+
+    // Повреждённое представление индекса отвергается до первого обращения к нему
+    DeltaIndex offsets;
+    for (uint64_t i = 0; i < 200; i++) offsets.Append(i*i);
+    string image = offsets.Serialize();
+    DeltaIndex restored = DeltaIndex::Deserialize(image.data(), image.size());
+    EXPECT_EQ(restored.Get(199), 199u*199u);
+    const size_t HEADER = 4*sizeof(uint64_t), BLOCKS = 4;
+    auto corrupt = [&](size_t position, uint64_t value) {
+        string broken = image;
+        memcpy(&broken[position], &value, sizeof(value));
+        return broken;
+    };
+    string shuffled = corrupt(HEADER+BLOCKS*sizeof(uint64_t)+sizeof(uint64_t), image.size());
+    EXPECT_THROW(DeltaIndex::Deserialize(shuffled.data(), shuffled.size()), runtime_error);
+    string wrapped = corrupt(3*sizeof(uint64_t), UINT64_MAX-HEADER);
+    EXPECT_THROW(DeltaIndex::Deserialize(wrapped.data(), wrapped.size()), runtime_error);
+    string unordered = corrupt(HEADER+sizeof(uint64_t), 0);
+    EXPECT_THROW(DeltaIndex::Deserialize(unordered.data(), unordered.size()), runtime_error);
+}
+
+// 36. Тест: Блочное чтение и запись через буфер вызывающего
+TEST_F(StreamTest, BlockOperations_CallerBuffer) {
+    const int COUNT = 10000;
+    vector<int> source(COUNT);
+    for (int i = 0; i < COUNT; i++) source[i] = i*3;
+    vector<int> buffer(4096);
+
+    ReadOnlyStream<int> memory(make_shared<LazySequence<int>>(source.data(), source.size()));
+    memory.Open();
+    memory.Seek(100);
+    EXPECT_EQ(memory.ReadBlock(buffer.data(), 50), 50);
+    EXPECT_EQ(buffer[0], 300);
+    EXPECT_EQ(buffer[49], 447);
+    EXPECT_EQ(memory.GetPosition(), 150);
+    memory.Seek(COUNT-10);
+    EXPECT_EQ(memory.ReadBlock(buffer.data(), 100), 10);
+    EXPECT_TRUE(memory.IsEndOfStream());
+
+    {
+        WriteOnlyStream<int> writer(testWriteFile, make_shared<IntSerializer>());
+        writer.Open();
+        EXPECT_EQ(writer.WriteBlock(source.data(), 6000), 6000);
+        EXPECT_EQ(writer.WriteAll(make_shared<ArraySequence<int>>(source.data()+6000, COUNT-6000)), COUNT);
+        writer.Close();
+    }
+    ReadOnlyStream<int> file(testWriteFile, make_shared<IntDeserializer>());
+    file.Open();
+    vector<int> restored;
+    size_t got;
+    while ((got = file.ReadBlock(buffer.data(), buffer.size())) > 0) restored.insert(restored.end(), buffer.begin(), buffer.begin()+got);
+    EXPECT_EQ(restored, source);
+    file.Seek(1234);
+    auto block = file.ReadBlock(3);
+    ASSERT_EQ(block->GetSize(), 3);
+    EXPECT_EQ((*block)[2], 1236*3);
+    file.Close();
+
+    auto array = make_shared<DynamicArray<int>>(0);
+    WriteOnlyStream<int> arrayWriter(array);
+    arrayWriter.Open();
+    arrayWriter.WriteBlock(source.data(), 10);
+    arrayWriter.WriteBlock(source.data()+10, 5);
+    ASSERT_EQ(arrayWriter.GetBuffer()->GetSize(), 15);
+    EXPECT_EQ((*arrayWriter.GetBuffer())[14], 42);
+
+    {
+        ColumnarWriteOnlyStream<int> writer(testLargeFile, 1000);
+        writer.Open();
+        writer.WriteBlock(source.data(), COUNT);
+        writer.Close();
+    }
+    ColumnarReadOnlyStream<int> columns(testLargeFile);
+    columns.Open();
+    EXPECT_EQ(columns.GetChunkCount(), 10);
+    columns.Seek(990);
+    EXPECT_EQ(columns.ReadBlock(buffer.data(), 20), 20);
+    EXPECT_EQ(buffer[19], 1009*3);
+    columns.SetRange(30, 60);
+    columns.Seek(0);
+    EXPECT_EQ(columns.ReadBlock(buffer.data(), buffer.size()), 11);
+    columns.Close();
+
+    {
+        CompressedWriteOnlyStream<int> writer(testLargeFile, make_shared<IntSerializer>(), BlockCodec::LZ, 4096);
+        writer.Open();
+        writer.WriteBlock(source.data(), COUNT);
+        writer.Close();
+    }
+    CompressedReadOnlyStream<int> compressed(testLargeFile, make_shared<IntDeserializer>());
+    compressed.Open();
+    restored.clear();
+    while ((got = compressed.ReadBlock(buffer.data(), 777)) > 0) restored.insert(restored.end(), buffer.begin(), buffer.begin()+got);
+    EXPECT_EQ(restored, source);
+    compressed.Close();
+}
+
+// 37. Тест: Производительность блочного чтения по сравнению с поэлементным
+TEST_F(StreamTest, Performance_BlockReadVersusElementwise) {
+    const int COUNT = 2000000;
+    vector<int> source(COUNT);
+    for (int i = 0; i < COUNT; i++) source[i] = i;
+    auto sequence = make_shared<LazySequence<int>>(source.data(), source.size());
+
+    ReadOnlyStream<int> elementwise(sequence);
+    elementwise.Open();
+    long long elementSum = 0;
+    while (!elementwise.IsEndOfStream()) elementSum += elementwise.Read();
+
+    // Каждый вызов ReadBlock заполняет буфер целиком, кроме последнего
+    ReadOnlyStream<int> blocks(sequence);
+    blocks.Open();
+    vector<int> buffer(4096);
+    long long blockSum = 0;
+    size_t got, calls = 0;
+    while ((got = blocks.ReadBlock(buffer.data(), buffer.size())) > 0) {
+        for (size_t i = 0; i < got; i++) blockSum += buffer[i];
+        calls++;
+    }
+
+    EXPECT_EQ(calls, (COUNT+buffer.size()-1)/buffer.size());
+    EXPECT_EQ(elementSum, blockSum);
+    EXPECT_EQ(blockSum, static_cast<long long>(COUNT)*(COUNT-1)/2);
+}
+
+// 38. Тест: Многопоточный конвейер потоков
+TEST_F(StreamTest, StreamPipeline_StagesErrorsAndCancel) {
+    const int COUNT = 20000;
+    vector<int> source(COUNT);
+    for (int i = 0; i < COUNT; i++) source[i] = i;
+    auto input = make_shared<ReadOnlyStream<int>>(make_shared<LazySequence<int>>(source.data(), source.size()));
+    input->Open();
+    auto output = make_shared<WriteOnlyStream<string>>(make_shared<DynamicArray<string>>(0));
+    output->Open();
+
+    auto pipeline = StreamPipeline<int>::From(input, 256, 2)
+        .Map([](const int &value) { return value*0.5; }, "half")
+        .Where([](const double &value) { return value >= 100; })
+        .Map([](const double &value) { return to_string(static_cast<long long>(value*2)); }, "format");
+    EXPECT_EQ(pipeline.Run(output), COUNT-200);
+    auto buffer = output->GetBuffer();
+    ASSERT_EQ(buffer->GetSize(), COUNT-200);
+    EXPECT_EQ((*buffer)[0], "200");
+    EXPECT_EQ((*buffer)[COUNT-201], to_string(COUNT-1));
+    auto statistics = pipeline.GetStatistics();
+    ASSERT_EQ(statistics.size(), 5);
+    EXPECT_EQ(statistics[0].name, "source");
+    EXPECT_EQ(statistics[0].items, COUNT);
+    EXPECT_EQ(statistics[1].name, "half");
+    EXPECT_EQ(statistics[3].items, COUNT-200);
+    EXPECT_EQ(statistics[4].name, "sink");
+    EXPECT_EQ(statistics[4].items, COUNT-200);
+    EXPECT_THROW(pipeline.Run(output), runtime_error);
+
+    // Ошибка стадии останавливает конвейер и передаётся вызывающему
+    input->Seek(0);
+    auto failing = StreamPipeline<int>::From(input, 64, 2)
+        .Map([](const int &value) {
+            if (value == 5000) throw invalid_argument("плохое значение");
+            return value;
+        });
+    auto sink = make_shared<WriteOnlyStream<int>>(make_shared<DynamicArray<int>>(0));
+    sink->Open();
+    EXPECT_THROW(failing.Run(sink), invalid_argument);
+    EXPECT_TRUE(failing.IsCancelled());
+
+    // Отмена из другого потока
+    input->Seek(0);
+    auto slow = StreamPipeline<int>::From(input, 1, 2)
+        .Map([](const int &value) {
+            this_thread::sleep_for(chrono::milliseconds(1));
+            return value;
+        });
+    auto slowSink = make_shared<WriteOnlyStream<int>>(make_shared<DynamicArray<int>>(0));
+    slowSink->Open();
+    bool cancelled = false;
+    thread runner([&]() {
+        try {
+            slow.Run(slowSink);
+        } catch (const runtime_error&) {
+            cancelled = true;
+        }
+    });
+    while (slow.GetStatistics()[1].items < 20) this_thread::yield();
+    slow.Cancel();
+    runner.join();
+    EXPECT_TRUE(cancelled);
+    EXPECT_LT(slowSink->GetBuffer()->GetSize(), COUNT);
+}
+
+// 39. Тест: Производительность конвейера из трёх стадий по сравнению с однопоточным проходом
+TEST_F(StreamTest, Performance_StreamPipeline) {
+    const int COUNT = 300000;
+    vector<int> source(COUNT);
+    for (int i = 0; i < COUNT; i++) source[i] = i;
+    auto work = [](int value) {
+        unsigned hash = static_cast<unsigned>(value);
+        for (int round = 0; round < 200; round++) hash = hash*2654435761u+round;
+        return static_cast<int>(hash >> 1);
+    };
+
+    ReadOnlyStream<int> sequentialInput(make_shared<LazySequence<int>>(source.data(), source.size()));
+    sequentialInput.Open();
+    WriteOnlyStream<int> sequentialOutput(make_shared<DynamicArray<int>>(0));
+    sequentialOutput.Open();
+    vector<int> batch(4096);
+    size_t got;
+    while ((got = sequentialInput.ReadBlock(batch.data(), batch.size())) > 0) {
+        for (size_t i = 0; i < got; i++) batch[i] = work(work(work(batch[i])));
+        sequentialOutput.WriteBlock(batch.data(), got);
+    }
+
+    auto input = make_shared<ReadOnlyStream<int>>(make_shared<LazySequence<int>>(source.data(), source.size()));
+    input->Open();
+    auto output = make_shared<WriteOnlyStream<int>>(make_shared<DynamicArray<int>>(0));
+    output->Open();
+    auto pipeline = StreamPipeline<int>::From(input).Map(work, "first").Map(work, "second").Map(work, "third");
+    EXPECT_EQ(pipeline.Run(output), COUNT);
+
+    ASSERT_EQ(output->GetBuffer()->GetSize(), COUNT);
+    for (int i = 0; i < COUNT; i += 997) ASSERT_EQ((*output->GetBuffer())[i], (*sequentialOutput.GetBuffer())[i]) << i;
+    // Каждая стадия обработала все элементы пакетами по DEFAULT_BATCH_SIZE
+    const size_t batches = (COUNT+StreamPipeline<int>::DEFAULT_BATCH_SIZE-1)/StreamPipeline<int>::DEFAULT_BATCH_SIZE;
+    for (const auto &stage : pipeline.GetStatistics()) {
+        EXPECT_EQ(stage.items, COUNT) << stage.name;
+        EXPECT_EQ(stage.batches, batches) << stage.name;
+    }
+}
+
+// 40. Тест: Разветвление одного прохода по потоку на несколько приёмников
+TEST_F(StreamTest, TeeStreamFanOut) {
+    const int COUNT = 10000;
+    vector<int> source(COUNT);
+    for (int i = 0; i < COUNT; i++) source[i] = i%7;
+
+    for (bool threaded : {false, true}) {
+        remove_if_exists(testWriteFile);
+        auto statistics = make_shared<StreamStatistics<int>>();
+        auto buffer = make_shared<WriteOnlyStream<int>>(make_shared<DynamicArray<int>>(0));
+        auto file = make_shared<WriteOnlyStream<int>>(testWriteFile, make_shared<IntSerializer>());
+        TeeStream<int> tee({file, make_shared<StatisticsWriteOnlyStream<int>>(statistics), buffer}, threaded, 1, 512);
+        EXPECT_EQ(tee.GetConsumerCount(), 3);
+        EXPECT_EQ(tee.IsThreaded(), threaded);
+        tee.Open();
+        auto input = make_shared<ReadOnlyStream<int>>(make_shared<LazySequence<int>>(source.data(), source.size()));
+        input->Open();
+        EXPECT_EQ(tee.Pump(input), COUNT);
+        tee.Close();
+
+        ASSERT_EQ(buffer->GetBuffer()->GetSize(), COUNT);
+        EXPECT_EQ(buffer->GetBuffer()->Get(COUNT-1), source[COUNT-1]);
+        EXPECT_EQ(statistics->GetCount(), COUNT);
+        EXPECT_EQ(statistics->GetMax(), 6);
+        ReadOnlyStream<int> written(testWriteFile, make_shared<IntDeserializer>());
+        written.Open();
+        size_t lines = 0;
+        int last = -1;
+        while (!written.IsEndOfStream()) {
+            last = written.Read();
+            lines++;
+        }
+        EXPECT_EQ(lines, COUNT);
+        EXPECT_EQ(last, source[COUNT-1]);
+    }
+
+    // RLE-кодирование как ветвь разветвителя совпадает с StreamEncoder::RLEEncode
+    string text = "AAABBBBCCD";
+    auto encoded = make_shared<WriteOnlyStream<string>>(make_shared<DynamicArray<string>>(0));
+    auto copy = make_shared<WriteOnlyStream<char>>(make_shared<DynamicArray<char>>(0));
+    TeeStream<char> textTee({make_shared<RLEWriteOnlyStream>(encoded), copy}, true);
+    textTee.Open();
+    textTee.WriteBlock(text.data(), text.size());
+    textTee.Close();
+    ASSERT_EQ(encoded->GetBuffer()->GetSize(), 4);
+    EXPECT_EQ(encoded->GetBuffer()->Get(1), "4B");
+    EXPECT_EQ(encoded->GetBuffer()->Get(3), "1D");
+    EXPECT_EQ(copy->GetBuffer()->GetSize(), text.size());
+
+    // Ошибка одного приёмника передаётся в вызывающий поток
+    class FailingStream: public WritableStream<int> {
+        public:
+            FailingStream(): Stream<int>() {}
+            void Open() override { this->isOpen = true; }
+            void Close() override { this->isOpen = false; }
+            size_t Write(const int&) override { throw runtime_error("приёмник недоступен"); }
+            using WritableStream<int>::WriteBlock;
+            size_t WriteBlock(const int*, size_t) override { throw runtime_error("приёмник недоступен"); }
+            size_t WriteAll(shared_ptr<Sequence<int>>) override { throw runtime_error("приёмник недоступен"); }
+    };
+    auto survivor = make_shared<WriteOnlyStream<int>>(make_shared<DynamicArray<int>>(0));
+    TeeStream<int> failing({survivor, make_shared<FailingStream>()}, true, 1, 16);
+    failing.Open();
+    EXPECT_THROW({
+        for (int i = 0; i < COUNT; i++) failing.Write(i);
+        failing.Close();
+    }, runtime_error);
+    EXPECT_THROW(TeeStream<int>(vector<shared_ptr<WritableStream<int>>>{}), invalid_argument);
+}
+
+// 41. Тест: Производительность разветвителя по сравнению с отдельным проходом для каждого приёмника
+TEST_F(StreamTest, Performance_TeeStream) {
+    const int COUNT = 500000;
+    vector<int64_t> source(COUNT);
+    for (int i = 0; i < COUNT; i++) source[i] = static_cast<int64_t>(i)*7919 % 1000;
+
+    auto separateStatistics = make_shared<StreamStatistics<int64_t>>();
+    for (int pass = 0; pass < 2; pass++) {
+        ReadOnlyStream<int64_t> input(make_shared<LazySequence<int64_t>>(source.data(), source.size()));
+        input.Open();
+        shared_ptr<WritableStream<int64_t>> sink;
+        if (pass == 0) sink = make_shared<StatisticsWriteOnlyStream<int64_t>>(separateStatistics);
+        else sink = make_shared<WriteOnlyStream<int64_t>>(make_shared<DynamicArray<int64_t>>(0));
+        sink->Open();
+        vector<int64_t> batch(4096);
+        size_t got;
+        while ((got = input.ReadBlock(batch.data(), batch.size())) > 0) sink->WriteBlock(batch.data(), got);
+        sink->Close();
+    }
+
+    auto statistics = make_shared<StreamStatistics<int64_t>>();
+    auto buffer = make_shared<WriteOnlyStream<int64_t>>(make_shared<DynamicArray<int64_t>>(0));
+    TeeStream<int64_t> tee({make_shared<StatisticsWriteOnlyStream<int64_t>>(statistics), buffer}, true);
+    tee.Open();
+    auto input = make_shared<ReadOnlyStream<int64_t>>(make_shared<LazySequence<int64_t>>(source.data(), source.size()));
+    input->Open();
+    EXPECT_EQ(tee.Pump(input), COUNT);
+    tee.Close();
+
+    EXPECT_EQ(statistics->GetCount(), COUNT);
+    EXPECT_EQ(statistics->GetSum(), separateStatistics->GetSum());
+    EXPECT_EQ(buffer->GetBuffer()->GetSize(), COUNT);
+    EXPECT_EQ((*buffer->GetBuffer())[COUNT-1], source[COUNT-1]);
+}
+
+// 42. Тест: Внешняя сортировка с сериями во временных файлах и многопроходным слиянием
+TEST_F(StreamTest, ExternalSortStream) {
+    const int COUNT = 50000;
+    mt19937_64 generator(42);
+    vector<int64_t> source(COUNT);
+    for (auto &value : source) value = static_cast<int64_t>(generator() % 1000000)-500000;
+    vector<int64_t> expected = source;
+    sort(expected.begin(), expected.end());
+
+    // 8 КБ памяти - серии по 512 элементов, при fanIn 4 нужно несколько проходов слияния
+    ExternalSorter<int64_t> sorter(8192, ".", 4, std::less<int64_t>(), 4);
+    auto input = make_shared<ReadOnlyStream<int64_t>>(make_shared<LazySequence<int64_t>>(source.data(), source.size()));
+    input->Open();
+    auto output = make_shared<WriteOnlyStream<int64_t>>(make_shared<DynamicArray<int64_t>>(0));
+    output->Open();
+    EXPECT_EQ(sorter.Sort(input, output), COUNT);
+    ASSERT_EQ(output->GetBuffer()->GetSize(), COUNT);
+    for (int i = 0; i < COUNT; i++) ASSERT_EQ((*output->GetBuffer())[i], expected[i]) << i;
+    EXPECT_EQ(sorter.GetStatistics().items, COUNT);
+    EXPECT_GT(sorter.GetStatistics().runs, 16);
+    EXPECT_GT(sorter.GetStatistics().mergePasses, 1);
+
+    // Весь поток помещается в память: сортировка без временных файлов, параллельно по блокам
+    ExternalSorter<int64_t> inMemory(1 << 20, ".", ExternalSorter<int64_t>::DEFAULT_FAN_IN,
+                                     [](const int64_t &a, const int64_t &b) { return a > b; }, 4);
+    input->Seek(0);
+    auto descending = make_shared<WriteOnlyStream<int64_t>>(make_shared<DynamicArray<int64_t>>(0));
+    descending->Open();
+    inMemory.Sort(input, descending);
+    ASSERT_EQ(descending->GetBuffer()->GetSize(), COUNT);
+    EXPECT_EQ((*descending->GetBuffer())[0], expected[COUNT-1]);
+    EXPECT_EQ((*descending->GetBuffer())[COUNT-1], expected[0]);
+    EXPECT_EQ(inMemory.GetStatistics().runs, 1);
+    EXPECT_EQ(inMemory.GetStatistics().mergePasses, 0);
+
+    // Двоичный файл в двоичный файл; пустой поток
+    remove_if_exists(testWriteFile);
+    {
+        auto fileOutput = make_shared<BinaryWriteOnlyStream<int64_t>>(testWriteFile);
+        fileOutput->Open();
+        input->Seek(0);
+        sorter.Sort(input, fileOutput);
+    }
+    BinaryReadOnlyStream<int64_t> sorted(testWriteFile);
+    sorted.Open();
+    ASSERT_EQ(sorted.GetCount(), COUNT);
+    sorted.Seek(COUNT/2);
+    EXPECT_EQ(sorted.Read(), expected[COUNT/2]);
+    auto empty = make_shared<ReadOnlyStream<int64_t>>(make_shared<LazySequence<int64_t>>(make_shared<DynamicArray<int64_t>>(0)));
+    empty->Open();
+    EXPECT_EQ(sorter.Sort(empty, output), 0);
+    EXPECT_THROW(ExternalSorter<int64_t>(8192, ".", 1), invalid_argument);
+    input->Seek(0);
+    EXPECT_THROW(ExternalSorter<int64_t>(8192, "./нет_такого_каталога").Sort(input, output), runtime_error);
+
+    // Текстовый файл читается один раз в потоковом режиме, без кеша прочитанных записей
+    vector<string> lines;
+    for (int i = 0; i < COUNT; i++) lines.push_back(to_string(source[i]));
+    CreateTestFile(lines);
+    auto textInput = make_shared<ReadOnlyStream<int>>(testFilename, make_shared<IntDeserializer>());
+    textInput->Open();
+    auto textOutput = make_shared<WriteOnlyStream<int>>(make_shared<DynamicArray<int>>(0));
+    textOutput->Open();
+    EXPECT_EQ(ExternalSorter<int>(8192, ".", 4).Sort(textInput, textOutput), COUNT);
+    EXPECT_TRUE(textInput->GetData()->IsStreaming());
+    EXPECT_FALSE(textInput->IsCanGoBack());
+    ASSERT_EQ(textOutput->GetBuffer()->GetSize(), COUNT);
+    for (int i = 0; i < COUNT; i += 997) ASSERT_EQ((*textOutput->GetBuffer())[i], expected[i]) << i;
+}
+
+// 43. Тест: Производительность внешней сортировки по сравнению с сортировкой в памяти
+TEST_F(StreamTest, Performance_ExternalSort) {
+    const int COUNT = 1000000;
+    mt19937_64 generator(7);
+    vector<int64_t> source(COUNT);
+    for (auto &value : source) value = static_cast<int64_t>(generator());
+
+    vector<int64_t> expected = source;
+    sort(expected.begin(), expected.end());
+
+    ExternalSorter<int64_t> sorter(1 << 20);
+    auto input = make_shared<ReadOnlyStream<int64_t>>(make_shared<LazySequence<int64_t>>(source.data(), source.size()));
+    input->Open();
+    remove_if_exists(testWriteFile);
+    {
+        auto output = make_shared<BinaryWriteOnlyStream<int64_t>>(testWriteFile);
+        output->Open();
+        EXPECT_EQ(sorter.Sort(input, output), COUNT);
+    }
+
+    BinaryReadOnlyStream<int64_t> sorted(testWriteFile);
+    sorted.Open();
+    ASSERT_EQ(sorted.GetCount(), COUNT);
+    sorted.Seek(COUNT-1);
+    EXPECT_EQ(sorted.Read(), expected[COUNT-1]);
+    sorted.Seek(COUNT/3);
+    EXPECT_EQ(sorted.Read(), expected[COUNT/3]);
+    // 1 МБ памяти - серии по 64К элементов, все серии сливаются за один проход
+    const auto &statistics = sorter.GetStatistics();
+    EXPECT_EQ(statistics.runs, (COUNT+65535)/65536);
+    EXPECT_EQ(statistics.mergePasses, 1);
+}
+
 // Основная функция
 inline int run_test_rws() {
     int argc = 1;
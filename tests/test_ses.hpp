@@ -4,6 +4,7 @@
 #include <gtest/gtest.h>
 #include <sstream>
 #include <chrono>
+#include <random>
 #include "StreamEncoder.hpp"
 #include "StreamStatistics.hpp"
 using namespace std;
@@ -214,6 +215,28 @@ TEST_F(StreamEncoderTest, StreamEncoderLargeCount) {
     EXPECT_EQ(buffer->Get(0), "1000Z");
 }
 
+TEST_F(StreamEncoderTest, BlockCodecsRoundtrip) {
+    string runs = string(1000, 'a') + "bc" + string(300, 'd') + "e";
+    string text;
+    for (int i = 0; i < 2000; i++) text += to_string(i % 97) + "\n";
+    mt19937 rng(7);
+    string noise;
+    for (int i = 0; i < 5000; i++) noise += static_cast<char>(rng() & 0xFF);
+
+    for (BlockCodec codec : {BlockCodec::None, BlockCodec::RLE, BlockCodec::LZ}) {
+        for (const string &data : {string(), string("x"), string("xyz"), runs, text, noise}) {
+            string encoded = StreamEncoder::EncodeBlock(codec, data);
+            EXPECT_EQ(StreamEncoder::DecodeBlock(codec, encoded.data(), encoded.size(), data.size()), data);
+        }
+    }
+    EXPECT_LT(StreamEncoder::RLEEncodeBlock(runs).size(), 30u);
+    EXPECT_LT(StreamEncoder::LZEncodeBlock(text).size(), text.size()/4);
+
+    string encoded = StreamEncoder::LZEncodeBlock(text);
+    EXPECT_THROW(StreamEncoder::LZDecodeBlock(encoded.data(), encoded.size()/2, text.size()), runtime_error);
+    EXPECT_THROW(StreamEncoder::RLEDecodeBlock("\x05" "ab", 3, 6), runtime_error);
+}
+
 // Тесты для StreamStatistics
 class StreamStatisticsTest: public ::testing::Test {
     protected:
@@ -473,6 +496,54 @@ TEST_F(StreamStatisticsTest, StreamStatisticsLargeDataset) {
     EXPECT_LT(duration.count(), 1000);
 }
 
+TEST_F(StreamStatisticsTest, StatisticsFromFilteredSequence) {
+    // 64-битные элементы: сумма квадратов 30000 чисел не помещается в int
+    auto indexed = make_shared<LazySequence<long long>>([](size_t i) { return static_cast<long long>(i); }, Cardinal::Finite(30000));
+    auto filtered = shared_ptr<LazySequence<long long>>(indexed->Where([](long long x) { return x % 3 == 0; }));
+
+    StreamStatistics<long long> stats;
+    stats.CollectFromSequence(filtered);
+    EXPECT_EQ(stats.GetCount(), 10000);
+    EXPECT_EQ(stats.GetMax(), 29997);
+
+    // Источник известной длины вычисляется заранее параллельно
+    StreamStatistics<long long> full;
+    full.CollectFromSequence(indexed);
+    EXPECT_EQ(indexed->GetMaterializedCount(), 30000);
+    EXPECT_EQ(full.GetSum(), 30000LL*29999/2);
+
+    auto infinite = make_shared<LazySequence<long long>>([](size_t i) { return static_cast<long long>(i); });
+    StreamStatistics<long long> limited;
+    EXPECT_THROW(limited.CollectFromSequence(infinite), invalid_argument);
+}
+
+TEST_F(StreamStatisticsTest, StatisticsPropagateGeneratorErrors) {
+    auto counter = make_shared<int>(0);
+    auto failing = make_shared<LazySequence<int>>(make_shared<Generator<int>>([counter]() {
+        if (*counter == 5) throw runtime_error("ошибка источника");
+        return (*counter)++;
+    }), Cardinal::Finite(10));
+    StreamStatistics<int> stats;
+    EXPECT_THROW(stats.CollectFromSequence(failing), runtime_error);
+
+    // Бесконечный генератор: maxElements больше лимита кеша
+    // Генератор следит, сколько элементов последовательность держит в общей ленте
+    auto natural = make_shared<int>(0);
+    auto buffered = make_shared<size_t>(0);
+    auto probe = make_shared<LazySequence<int>*>(nullptr);
+    auto naturals = make_shared<LazySequence<int>>(make_shared<Generator<int>>([natural, buffered, probe]() {
+        *buffered = max(*buffered, (*probe)->GetBufferedCount());
+        return (*natural)++ % 100;
+    }));
+    *probe = naturals.get();
+    StreamStatistics<int> limited;
+    limited.CollectFromSequence(naturals, 20000);
+    EXPECT_EQ(limited.GetCount(), 20000);
+    EXPECT_EQ(limited.GetMax(), 99);
+    EXPECT_EQ(naturals->GetMaterializedCount(), 0);
+    EXPECT_EQ(*buffered, 0);
+}
+
 // Финальный тест
 TEST(FinalTest, CompleteWorkflow) {
     string text = "AAAABBBCCCDDDDEEEEE";